@@ -0,0 +1,321 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <hkl/gff.hpp>
+#include <hkl/parallel.hpp>
+#include <hkl/region.hpp>
+
+namespace HKL::GFF {
+
+using std::string;
+using std::vector;
+
+// Restricts AnnotationStore queries to some types and sources; empty lists
+// accept everything.
+struct AnnotationFilter {
+  vector<string> types{};
+  vector<string> sources{};
+};
+
+class AnnotationSnapshot;
+
+// In-memory annotation indexed for overlap queries. Records are grouped by
+// seqid and each group is sorted by start and augmented into an implicit
+// interval tree (the layout of cgranges): the sorted array itself is a
+// binary tree in which every node stores the largest end of its subtree, so
+// the index needs no pointers and a query visits O(log n + hits) entries.
+class AnnotationStore {
+ public:
+  using Filter = AnnotationFilter;
+
+ private:
+  // Writes and maps the index below as it is laid out in memory.
+  friend class AnnotationSnapshot;
+
+  struct Interval {
+    int first{0};
+    int last{0};
+    int max{0};
+    uint32_t record{0};
+  };
+
+  struct Contig {
+    vector<Interval> intervals{};
+    int root_level{-1};
+  };
+
+  // Codes of a Filter resolved against the store's dictionaries; an empty
+  // result set means the filter cannot match.
+  struct Codes {
+    bool any_type{true}, any_source{true};
+    vector<uint32_t> types{}, sources{};
+  };
+
+  static constexpr uint32_t unknown{UINT32_MAX};
+
+  vector<GFFRecord> records{};
+  vector<uint32_t> types{}, sources{};
+  vector<string> type_names{}, source_names{};
+  std::unordered_map<string, Contig> contigs{};
+
+  static uint32_t encode(const opt_str &value, vector<string> &names,
+                         std::unordered_map<string, uint32_t> &index) {
+    const auto key = value.value_or(".");
+    const auto [item, inserted] =
+        index.try_emplace(key, static_cast<uint32_t>(names.size()));
+    if (inserted) names.push_back(key);
+    return item->second;
+  }
+
+  static vector<uint32_t> lookup(const vector<string> &wanted,
+                                 const vector<string> &names) {
+    vector<uint32_t> result;
+    for (const auto &name : wanted) {
+      const auto found = std::find(names.begin(), names.end(), name);
+      if (found != names.end())
+        result.push_back(static_cast<uint32_t>(found - names.begin()));
+    }
+    return result;
+  }
+
+  // Computes the subtree maxima bottom-up and returns the level of the root.
+  static int index(vector<Interval> &intervals) {
+    const auto size = static_cast<int64_t>(intervals.size());
+    if (!size) return -1;
+
+    int64_t last_i{0};
+    int last{0};
+    for (int64_t i = 0; i < size; i += 2) {
+      last_i = i;
+      last = intervals[i].max = intervals[i].last;
+    }
+
+    int level{1};
+    for (; int64_t{1} << level <= size; ++level) {
+      const int64_t x = int64_t{1} << (level - 1);
+      const int64_t step = x << 2;
+      for (int64_t i = (x << 1) - 1; i < size; i += step) {
+        const auto left = intervals[i - x].max;
+        const auto right = i + x < size ? intervals[i + x].max : last;
+        intervals[i].max = std::max({intervals[i].last, left, right});
+      }
+      last_i = (last_i >> level) & 1 ? last_i - x : last_i + x;
+      if (last_i < size && intervals[last_i].max > last)
+        last = intervals[last_i].max;
+    }
+    return level - 1;
+  }
+
+  static bool accepts(uint32_t type, uint32_t source, const Codes &codes) {
+    if (!codes.any_type &&
+        std::find(codes.types.begin(), codes.types.end(), type) ==
+            codes.types.end())
+      return false;
+    if (!codes.any_source &&
+        std::find(codes.sources.begin(), codes.sources.end(), source) ==
+            codes.sources.end())
+      return false;
+    return true;
+  }
+
+  static Codes resolve(const Filter &filter, const vector<string> &type_names,
+                       const vector<string> &source_names) {
+    Codes codes;
+    codes.any_type = filter.types.empty();
+    codes.any_source = filter.sources.empty();
+    codes.types = lookup(filter.types, type_names);
+    codes.sources = lookup(filter.sources, source_names);
+    return codes;
+  }
+
+  Codes resolve(const Filter &filter) const {
+    return resolve(filter, type_names, source_names);
+  }
+
+  static bool matches_nothing(const Codes &codes) noexcept {
+    return (!codes.any_type && codes.types.empty()) ||
+           (!codes.any_source && codes.sources.empty());
+  }
+
+  // Calls report(interval) for the intervals of an index built by index()
+  // that start at or before `last` in a subtree reaching `first`; the caller
+  // still tests the end of each.
+  template <class Report>
+  static void search(const Interval *intervals, int64_t size, int root,
+                     int first, int last, Report &&report) {
+    if (root < 0) return;
+
+    struct Node {
+      int64_t x;
+      int level;
+      bool left_done;
+    };
+    Node stack[64];
+    int top{0};
+    stack[top++] = {(int64_t{1} << root) - 1, root, false};
+
+    while (top) {
+      const auto node = stack[--top];
+      if (node.level <= 3) {
+        // Small subtree: scan it linearly.
+        const int64_t i0 = node.x >> node.level << node.level;
+        const int64_t i1 =
+            std::min(i0 + (int64_t{1} << (node.level + 1)) - 1, size);
+        for (auto i = i0; i < i1 && intervals[i].first <= last; ++i)
+          report(intervals[i]);
+      } else if (!node.left_done) {
+        const int64_t left = node.x - (int64_t{1} << (node.level - 1));
+        stack[top++] = {node.x, node.level, true};
+        if (left >= size || intervals[left].max >= first)
+          stack[top++] = {left, node.level - 1, false};
+      } else if (node.x < size && intervals[node.x].first <= last) {
+        report(intervals[node.x]);
+        stack[top++] = {node.x + (int64_t{1} << (node.level - 1)),
+                        node.level - 1, false};
+      }
+    }
+  }
+
+  template <class Output>
+  Output overlap(const Region &loc, Output out, const Codes &codes) const {
+    if (matches_nothing(codes)) return out;
+
+    const auto found = contigs.find(loc.getChrom());
+    if (found == contigs.end()) return out;
+
+    const auto &intervals = found->second.intervals;
+    const int first{loc.getFirst()}, last{loc.getLast()};
+    const auto strand = loc.getStrand();
+
+    search(intervals.data(), static_cast<int64_t>(intervals.size()),
+           found->second.root_level, first, last,
+           [&](const Interval &interval) {
+             const auto record = interval.record;
+             if (first > interval.last ||
+                 !accepts(types[record], sources[record], codes))
+               return;
+             if (strand && records[record].getStrand() != strand) return;
+             *out++ = record;
+           });
+    return out;
+  }
+
+  void build() {
+    if (records.size() >= unknown) throw runerror{"Too many GFF records"};
+
+    std::unordered_map<string, uint32_t> type_index, source_index;
+    types.reserve(records.size());
+    sources.reserve(records.size());
+
+    for (uint32_t record = 0; record < records.size(); ++record) {
+      const auto &item = records[record];
+      types.push_back(encode(item.getType(), type_names, type_index));
+      sources.push_back(encode(item.getSource(), source_names, source_index));
+      auto &contig = contigs[item.getSeqID().value_or(".")];
+      contig.intervals.push_back(
+          {item.getStart(), item.getEnd(), item.getEnd(), record});
+    }
+
+    for (auto &[seqid, contig] : contigs) {
+      std::sort(contig.intervals.begin(), contig.intervals.end(),
+                [](const Interval &left, const Interval &right) {
+                  if (left.first != right.first)
+                    return left.first < right.first;
+                  return left.record < right.record;
+                });
+      contig.root_level = index(contig.intervals);
+    }
+  }
+
+ public:
+  AnnotationStore() = default;
+
+  explicit AnnotationStore(vector<GFFRecord> records)
+      : records{std::move(records)} {
+    build();
+  }
+
+  explicit AnnotationStore(GFFReader &reader) {
+    while (auto item = reader()) {
+      if (auto record = std::get_if<GFFRecord>(&(*item)))
+        records.push_back(std::move(*record));
+    }
+    build();
+  }
+
+  explicit AnnotationStore(const string &file_name) {
+    GFFReader reader{file_name};
+    *this = AnnotationStore(reader);
+  }
+
+  size_t size() const noexcept { return records.size(); }
+  const vector<GFFRecord> &getRecords() const noexcept { return records; }
+  const GFFRecord &getRecord(size_t record) const { return records.at(record); }
+
+  Region getRegion(size_t record) const {
+    const auto &item = records.at(record);
+    const auto strand = item.getStrand().value_or(0);
+    return Region(item.getSeqID().value_or("."), item.getStart(),
+                  item.getEnd(), strand == '+' || strand == '-' ? strand : 0);
+  }
+
+  vector<string> getSeqIDs() const {
+    vector<string> result;
+    for (const auto &[seqid, contig] : contigs) result.push_back(seqid);
+    std::sort(result.begin(), result.end());
+    return result;
+  }
+
+  // Writes indices of records overlapping `loc` (on its strand, when it has
+  // one) to `out`, in no particular order.
+  template <class Output>
+  Output overlap(const Region &loc, Output out,
+                 const Filter &filter = {}) const {
+    return overlap(loc, out, resolve(filter));
+  }
+
+  // Indices of overlapping records in file order.
+  vector<size_t> query(const Region &loc, const Filter &filter = {}) const {
+    vector<size_t> result;
+    overlap(loc, std::back_inserter(result), filter);
+    std::sort(result.begin(), result.end());
+    return result;
+  }
+
+  // Accepts thousands separators, as in "chr7:55,019,017-55,211,628".
+  vector<size_t> query(string loc, const Filter &filter = {}) const {
+    loc.erase(std::remove(loc.begin(), loc.end(), ','), loc.end());
+    return query(Region(loc), filter);
+  }
+
+  vector<vector<size_t>> query(const vector<Region> &locs,
+                               const Filter &filter = {},
+                               size_t threads = 0) const {
+    const auto codes = resolve(filter);
+    vector<vector<size_t>> result(locs.size());
+    Parallel::parallel_for(
+        locs.size(),
+        [&](size_t index) {
+          auto &hits = result[index];
+          overlap(locs[index], std::back_inserter(hits), codes);
+          std::sort(hits.begin(), hits.end());
+        },
+        threads);
+    return result;
+  }
+
+  vector<GFFRecord> getRecords(const vector<size_t> &indices) const {
+    vector<GFFRecord> result;
+    result.reserve(indices.size());
+    for (const auto index : indices) result.push_back(records.at(index));
+    return result;
+  }
+};
+
+}  // namespace HKL::GFF
@@ -0,0 +1,341 @@
+#pragma once
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace HKL::BGZF {
+
+using std::string;
+using std::string_view;
+using runerror = std::runtime_error;
+
+// Blocked GZIP as written by bgzip: a series of independent gzip members of at
+// most 64 KiB, each carrying its compressed size in a "BC" extra field. A
+// position in the uncompressed stream is addressed by a virtual offset, the
+// file offset of its block shifted left by 16 bits plus the offset within the
+// uncompressed block, so readers can seek without decompressing what precedes.
+using voffset_t = uint64_t;
+
+inline constexpr voffset_t make_voffset(uint64_t block, size_t within) {
+  return block << 16 | static_cast<voffset_t>(within);
+}
+inline constexpr uint64_t block_address(voffset_t offset) {
+  return offset >> 16;
+}
+inline constexpr size_t block_offset(voffset_t offset) {
+  return static_cast<size_t>(offset & 0xFFFF);
+}
+
+inline constexpr size_t header_size{18};
+inline constexpr size_t footer_size{8};
+inline constexpr size_t max_block_size{size_t{1} << 16};
+// Uncompressed bytes per block, as bgzip uses, which leaves room for input
+// that does not compress.
+inline constexpr size_t block_data_size{0xff00};
+
+inline constexpr std::array<unsigned char, 28> eof_block{
+    0x1f, 0x8b, 0x08, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff,
+    0x06, 0x00, 0x42, 0x43, 0x02, 0x00, 0x1b, 0x00, 0x03, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
+
+inline uint16_t read_u16(const unsigned char *data) {
+  return static_cast<uint16_t>(data[0] | data[1] << 8);
+}
+inline uint32_t read_u32(const unsigned char *data) {
+  return static_cast<uint32_t>(data[0]) | static_cast<uint32_t>(data[1]) << 8 |
+         static_cast<uint32_t>(data[2]) << 16 |
+         static_cast<uint32_t>(data[3]) << 24;
+}
+inline void write_u16(unsigned char *data, uint16_t value) {
+  data[0] = static_cast<unsigned char>(value);
+  data[1] = static_cast<unsigned char>(value >> 8);
+}
+inline void write_u32(unsigned char *data, uint32_t value) {
+  for (int byte = 0; byte < 4; ++byte)
+    data[byte] = static_cast<unsigned char>(value >> (8 * byte));
+}
+
+// Total size of the block starting with `header`, or 0 when it is not a BGZF
+// block.
+inline size_t parse_header(const unsigned char *header) {
+  if (header[0] != 0x1f || header[1] != 0x8b || header[2] != 8 ||
+      !(header[3] & 4))
+    return 0;
+  const auto extra = read_u16(header + 10);
+  if (extra != 6 || header[12] != 'B' || header[13] != 'C' ||
+      read_u16(header + 14) != 2)
+    return 0;
+  return static_cast<size_t>(read_u16(header + 16)) + 1;
+}
+
+inline bool is_bgzf(std::istream &stream) {
+  unsigned char header[header_size];
+  const auto position = stream.tellg();
+  stream.read(reinterpret_cast<char *>(header), header_size);
+  const auto result =
+      stream.gcount() == static_cast<std::streamsize>(header_size) &&
+      parse_header(header) != 0;
+  stream.clear();
+  stream.seekg(position);
+  return result;
+}
+
+inline bool is_bgzf(const string &file_name) {
+  std::ifstream stream{file_name, std::ios::binary};
+  return stream && is_bgzf(stream);
+}
+
+// Compresses into BGZF blocks. tell() gives the virtual offset of the next
+// byte written, which is what an index records for each line.
+class Writer {
+ private:
+  std::unique_ptr<std::ofstream> file{nullptr};
+  std::ostream *stream{nullptr};
+  string buffer{};
+  uint64_t address{0};
+  int level{Z_DEFAULT_COMPRESSION};
+  bool finished{false};
+
+  void deflateBlock() {
+    unsigned char block[max_block_size];
+    z_stream zs{};
+    if (deflateInit2(&zs, level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) !=
+        Z_OK)
+      throw runerror{"Cannot initialize BGZF compression"};
+
+    zs.next_in = reinterpret_cast<Bytef *>(buffer.data());
+    zs.avail_in = static_cast<uInt>(buffer.size());
+    zs.next_out = block + header_size;
+    zs.avail_out =
+        static_cast<uInt>(max_block_size - header_size - footer_size);
+    const auto status = deflate(&zs, Z_FINISH);
+    const auto compressed = zs.total_out;
+    deflateEnd(&zs);
+    // Input is limited to block_data_size, which always fits.
+    if (status != Z_STREAM_END)
+      throw runerror{"BGZF block does not fit after compression"};
+
+    const auto size = header_size + compressed + footer_size;
+    std::copy(eof_block.begin(), eof_block.begin() + header_size, block);
+    write_u16(block + 16, static_cast<uint16_t>(size - 1));
+
+    const auto crc =
+        crc32(crc32(0L, Z_NULL, 0),
+              reinterpret_cast<const Bytef *>(buffer.data()),
+              static_cast<uInt>(buffer.size()));
+    write_u32(block + header_size + compressed, static_cast<uint32_t>(crc));
+    write_u32(block + header_size + compressed + 4,
+              static_cast<uint32_t>(buffer.size()));
+
+    stream->write(reinterpret_cast<const char *>(block),
+                  static_cast<std::streamsize>(size));
+    if (!*stream) throw runerror{"Cannot write BGZF block"};
+    address += size;
+    buffer.clear();
+  }
+
+ public:
+  explicit Writer(const string &file_name, int level = Z_DEFAULT_COMPRESSION)
+      : file{std::make_unique<std::ofstream>(file_name, std::ios::binary)},
+        stream{file.get()},
+        level{level} {
+    if (!*file) throw runerror{"Cannot write file '" + file_name + "'"};
+    buffer.reserve(block_data_size);
+  }
+  explicit Writer(std::ostream &stream, int level = Z_DEFAULT_COMPRESSION)
+      : stream{&stream}, level{level} {
+    buffer.reserve(block_data_size);
+  }
+  Writer(const Writer &) = delete;
+  Writer &operator=(const Writer &) = delete;
+  ~Writer() {
+    try {
+      close();
+    } catch (...) {
+    }
+  }
+
+  voffset_t tell() const noexcept {
+    return make_voffset(address, buffer.size());
+  }
+
+  void write(string_view data) {
+    while (!data.empty()) {
+      const auto size = std::min(data.size(), block_data_size - buffer.size());
+      buffer.append(data.substr(0, size));
+      data.remove_prefix(size);
+      if (buffer.size() == block_data_size) deflateBlock();
+    }
+  }
+
+  // Ends the current block so the next write starts a new one.
+  void flush() {
+    if (!buffer.empty()) deflateBlock();
+    stream->flush();
+  }
+
+  // Writes the pending block and the empty end-of-file marker.
+  void close() {
+    if (finished) return;
+    finished = true;
+    if (!buffer.empty()) deflateBlock();
+    stream->write(reinterpret_cast<const char *>(eof_block.data()),
+                  eof_block.size());
+    stream->flush();
+    address += eof_block.size();
+  }
+};
+
+// Decompresses BGZF one block at a time and reads lines. seek() jumps to a
+// virtual offset; tell() returns the offset of the next unread byte.
+class Reader {
+ private:
+  std::unique_ptr<std::ifstream> file{nullptr};
+  std::istream *stream{nullptr};
+  string block{};
+  size_t position{0};
+  uint64_t address{0}, next_address{0};
+  bool eof{false};
+
+  // Loads the block at `next_address`; false at the end of the file.
+  bool loadBlock() {
+    unsigned char compressed[max_block_size];
+    address = next_address;
+    block.clear();
+    position = 0;
+
+    stream->read(reinterpret_cast<char *>(compressed), header_size);
+    if (stream->gcount() == 0) {
+      eof = true;
+      return false;
+    }
+    if (stream->gcount() != static_cast<std::streamsize>(header_size))
+      throw runerror{"Truncated BGZF block header"};
+
+    const auto size = parse_header(compressed);
+    if (!size) throw runerror{"Input is not BGZF compressed"};
+    stream->read(reinterpret_cast<char *>(compressed + header_size),
+                 static_cast<std::streamsize>(size - header_size));
+    if (stream->gcount() != static_cast<std::streamsize>(size - header_size))
+      throw runerror{"Truncated BGZF block"};
+    next_address = address + size;
+
+    const auto length = read_u32(compressed + size - 4);
+    block.resize(length);
+    if (length) {
+      z_stream zs{};
+      if (inflateInit2(&zs, -15) != Z_OK)
+        throw runerror{"Cannot initialize BGZF decompression"};
+      zs.next_in = compressed + header_size;
+      zs.avail_in = static_cast<uInt>(size - header_size - footer_size);
+      zs.next_out = reinterpret_cast<Bytef *>(block.data());
+      zs.avail_out = static_cast<uInt>(length);
+      const auto status = inflate(&zs, Z_FINISH);
+      inflateEnd(&zs);
+      if (status != Z_STREAM_END || zs.total_out != length)
+        throw runerror{"Corrupted BGZF block"};
+      const auto crc =
+          crc32(crc32(0L, Z_NULL, 0),
+                reinterpret_cast<const Bytef *>(block.data()), length);
+      if (crc != read_u32(compressed + size - 8))
+        throw runerror{"BGZF block checksum mismatch"};
+    }
+    return true;
+  }
+
+  // Makes `position` point at unread data unless the stream is exhausted.
+  bool ensure() {
+    while (position == block.size())
+      if (eof || !loadBlock()) return false;
+    return true;
+  }
+
+ public:
+  explicit Reader(const string &file_name)
+      : file{std::make_unique<std::ifstream>(file_name, std::ios::binary)},
+        stream{file.get()} {
+    if (!*file) throw runerror{"Cannot read file '" + file_name + "'"};
+  }
+  explicit Reader(std::istream &stream) : stream{&stream} {}
+
+  voffset_t tell() const noexcept {
+    return position == block.size() ? make_voffset(next_address, 0)
+                                    : make_voffset(address, position);
+  }
+
+  void seek(voffset_t offset) {
+    const auto target = block_address(offset);
+    if (target != address || block.empty()) {
+      stream->clear();
+      stream->seekg(static_cast<std::streamoff>(target));
+      if (!*stream) throw runerror{"Cannot seek in BGZF file"};
+      next_address = target;
+      eof = false;
+      loadBlock();
+    }
+    if (block_offset(offset) > block.size())
+      throw runerror{"Virtual offset outside of BGZF block"};
+    position = block_offset(offset);
+  }
+
+  // Reads up to `size` bytes into `data`; returns the number read.
+  size_t read(char *data, size_t size) {
+    size_t done{0};
+    while (done < size && ensure()) {
+      const auto chunk = std::min(size - done, block.size() - position);
+      std::memcpy(data + done, block.data() + position, chunk);
+      position += chunk;
+      done += chunk;
+    }
+    return done;
+  }
+
+  // Next line without its '\n' (and '\r'), which may span several blocks.
+  bool getline(string &line) {
+    line.clear();
+    if (!ensure()) return false;
+    while (ensure()) {
+      const char *begin = block.data() + position;
+      const auto end = static_cast<const char *>(
+          std::memchr(begin, '\n', block.size() - position));
+      if (end) {
+        line.append(begin, end);
+        position += static_cast<size_t>(end - begin) + 1;
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        return true;
+      }
+      line.append(begin, block.size() - position);
+      position = block.size();
+    }
+    if (!line.empty() && line.back() == '\r') line.pop_back();
+    return true;
+  }
+};
+
+// Copies `input` into a BGZF file. Blocks are cut at line boundaries where a
+// line fits, so most records can be reached without touching two blocks.
+inline void compress(std::istream &input, const string &file_name,
+                     int level = Z_DEFAULT_COMPRESSION) {
+  Writer writer{file_name, level};
+  string line;
+  while (std::getline(input, line)) {
+    line.push_back('\n');
+    const auto used = block_offset(writer.tell());
+    if (used && used + line.size() > block_data_size) writer.flush();
+    writer.write(line);
+  }
+  writer.close();
+}
+
+}  // namespace HKL::BGZF
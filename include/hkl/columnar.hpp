@@ -0,0 +1,482 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <hkl/gff.hpp>
+
+namespace HKL::Columnar {
+
+using std::optional;
+using std::string;
+using std::string_view;
+using std::vector;
+using runerror = std::runtime_error;
+
+// Flattened GFF table stored column by column.
+//
+// File layout, all integers little-endian and every section 8-byte aligned:
+//   header:     magic "HKLCOL\0\0", u32 version, u32 byte order mark,
+//               u32 column count, then per column u8 type, u32 name length
+//               and the name, padded to 8 bytes
+//   chunks:     u64 rows, then per column a validity bitmap (bit set = value
+//               present) and the values: u32 dictionary codes, i32 or f64;
+//               string columns follow with the dictionary of the chunk, u64
+//               count, u64 offsets[count + 1] and the bytes
+//   footer:     u64 rows, u64 chunk rows, u64 chunk count, u64 chunk
+//               offsets, then u64 footer offset and the magic again
+// All chunks but the last hold exactly `chunk rows` rows, so a row is found
+// without searching. Dictionaries are per chunk, so a writer holds the
+// distinct values of one chunk only, however many a column has.
+enum class ColumnType : uint8_t { String = 0, Int32 = 1, Float64 = 2 };
+
+struct Column {
+  string name{};
+  ColumnType type{ColumnType::String};
+};
+
+constexpr char magic[8]{'H', 'K', 'L', 'C', 'O', 'L', '\0', '\0'};
+constexpr uint32_t version{2};
+constexpr uint32_t byte_order{0x01020304};
+
+inline size_t width(ColumnType type) noexcept {
+  return type == ColumnType::Float64 ? 8 : 4;
+}
+
+inline size_t padded(size_t size) noexcept { return (size + 7) & ~size_t{7}; }
+
+// Columns written for a GFF record: the eight fixed fields followed by one
+// string column per attribute key.
+inline vector<Column> gff_columns(const vector<string> &keys) {
+  vector<Column> columns{{"seqid", ColumnType::String},
+                         {"source", ColumnType::String},
+                         {"type", ColumnType::String},
+                         {"start", ColumnType::Int32},
+                         {"end", ColumnType::Int32},
+                         {"score", ColumnType::Float64},
+                         {"strand", ColumnType::String},
+                         {"phase", ColumnType::Int32}};
+  for (const auto &key : keys) columns.push_back({key, ColumnType::String});
+  return columns;
+}
+
+// Streams GFF records into the columnar layout. Rows are buffered one chunk
+// at a time; string values are dictionary-encoded within the chunk.
+// Absent attributes are null, attributes without a value are empty strings.
+class ColumnarWriter {
+ private:
+  struct Buffer {
+    vector<uint8_t> valid{};
+    vector<uint32_t> codes{};
+    vector<int32_t> ints{};
+    vector<double> doubles{};
+    std::unordered_map<string, uint32_t> index{};
+    vector<string> dictionary{};
+  };
+
+  std::ostream &stream;
+  vector<Column> columns{};
+  vector<string> keys{};
+  vector<Buffer> buffers{};
+  size_t chunk_rows{0};
+  size_t pending{0};
+  uint64_t rows{0};
+  uint64_t offset{0};
+  vector<uint64_t> chunk_offsets{};
+  bool finished{false};
+
+  void put(const void *data, size_t size) {
+    stream.write(static_cast<const char *>(data),
+                 static_cast<std::streamsize>(size));
+    offset += size;
+  }
+
+  template <class T>
+  void put(T value) {
+    put(&value, sizeof(T));
+  }
+
+  void pad() {
+    static constexpr char zeros[8]{};
+    put(zeros, padded(offset) - offset);
+  }
+
+  void setValid(Buffer &buffer, bool valid) {
+    if (pending % 8 == 0) buffer.valid.push_back(0);
+    if (valid) buffer.valid.back() |= uint8_t(1u << (pending % 8));
+  }
+
+  void putString(size_t column, const optional<string> &value) {
+    auto &buffer = buffers[column];
+    setValid(buffer, value.has_value());
+    if (!value) {
+      buffer.codes.push_back(0);
+      return;
+    }
+    const auto code = static_cast<uint32_t>(buffer.dictionary.size());
+    const auto [item, inserted] = buffer.index.try_emplace(*value, code);
+    if (inserted) buffer.dictionary.push_back(*value);
+    buffer.codes.push_back(item->second);
+  }
+
+  void putInt(size_t column, optional<int32_t> value) {
+    auto &buffer = buffers[column];
+    setValid(buffer, value.has_value());
+    buffer.ints.push_back(value.value_or(0));
+  }
+
+  void putDouble(size_t column, optional<double> value) {
+    auto &buffer = buffers[column];
+    setValid(buffer, value.has_value());
+    buffer.doubles.push_back(value.value_or(0.0));
+  }
+
+  void putDictionary(const vector<string> &dictionary) {
+    put(uint64_t{dictionary.size()});
+    uint64_t position{0};
+    put(position);
+    for (const auto &value : dictionary) put(position += value.size());
+    for (const auto &value : dictionary) put(value.data(), value.size());
+  }
+
+  void writeChunk() {
+    if (!pending) return;
+    chunk_offsets.push_back(offset);
+    put(uint64_t{pending});
+    for (size_t column = 0; column < columns.size(); ++column) {
+      auto &buffer = buffers[column];
+      put(buffer.valid.data(), buffer.valid.size());
+      pad();
+      switch (columns[column].type) {
+        case ColumnType::String:
+          put(buffer.codes.data(), buffer.codes.size() * sizeof(uint32_t));
+          pad();
+          putDictionary(buffer.dictionary);
+          buffer.index.clear();
+          buffer.dictionary.clear();
+          break;
+        case ColumnType::Int32:
+          put(buffer.ints.data(), buffer.ints.size() * sizeof(int32_t));
+          break;
+        case ColumnType::Float64:
+          put(buffer.doubles.data(), buffer.doubles.size() * sizeof(double));
+          break;
+      }
+      pad();
+      buffer.valid.clear();
+      buffer.codes.clear();
+      buffer.ints.clear();
+      buffer.doubles.clear();
+    }
+    pending = 0;
+  }
+
+ public:
+  static constexpr size_t default_chunk_rows{size_t{1} << 16};
+
+  ColumnarWriter(std::ostream &stream, const vector<string> &keys,
+                 size_t chunk_rows = default_chunk_rows)
+      : stream{stream},
+        columns{gff_columns(keys)},
+        keys{keys},
+        buffers(columns.size()),
+        chunk_rows{std::max<size_t>(chunk_rows, 1)} {
+    put(magic, sizeof(magic));
+    put(version);
+    put(byte_order);
+    put(static_cast<uint32_t>(columns.size()));
+    for (const auto &column : columns) {
+      put(static_cast<uint8_t>(column.type));
+      put(static_cast<uint32_t>(column.name.size()));
+      put(column.name.data(), column.name.size());
+    }
+    pad();
+  }
+
+  ColumnarWriter(const ColumnarWriter &) = delete;
+  ColumnarWriter &operator=(const ColumnarWriter &) = delete;
+
+  const vector<Column> &getColumns() const noexcept { return columns; }
+
+  void write(const GFF::GFFRecord &record) {
+    if (finished) throw runerror{"ColumnarWriter is already finished"};
+
+    putString(0, record.getSeqID());
+    putString(1, record.getSource());
+    putString(2, record.getType());
+    putInt(3, record.getStart());
+    putInt(4, record.getEnd());
+    putDouble(5, record.getScore());
+    const auto strand = record.getStrand();
+    putString(6, strand ? optional<string>(string(1, *strand)) : std::nullopt);
+    putInt(7, record.getPhase());
+    for (size_t key = 0; key < keys.size(); ++key) {
+      const auto value = record.get(keys[key]);
+      putString(8 + key, value ? optional<string>((*value).value_or(""))
+                               : std::nullopt);
+    }
+
+    ++rows;
+    if (++pending == chunk_rows) writeChunk();
+  }
+
+  // Writes the last chunk and the footer. Nothing can be written afterwards.
+  void finish() {
+    if (finished) return;
+    writeChunk();
+
+    const auto footer = offset;
+    put(rows);
+    put(uint64_t{chunk_rows});
+    put(uint64_t{chunk_offsets.size()});
+    put(chunk_offsets.data(), chunk_offsets.size() * sizeof(uint64_t));
+    put(footer);
+    put(magic, sizeof(magic));
+    stream.flush();
+    finished = true;
+  }
+
+  uint64_t getRows() const noexcept { return rows; }
+};
+
+// Read-only view of a columnar file mapped into memory. Values are read in
+// place; nothing is parsed beyond the header and footer.
+class ColumnarFile {
+ private:
+  struct Dictionary {
+    uint64_t count{0};
+    const uint64_t *offsets{nullptr};
+    const char *bytes{nullptr};
+  };
+
+  struct Slice {
+    const uint8_t *valid{nullptr};
+    const uint8_t *values{nullptr};
+    Dictionary dictionary{};
+  };
+
+  const uint8_t *data{nullptr};
+  size_t length{0};
+  vector<Column> columns{};
+  uint64_t rows{0};
+  uint64_t chunk_rows{0};
+  vector<uint64_t> chunk_sizes{};
+  vector<vector<Slice>> chunks{};
+
+  template <class T>
+  T read(size_t &pos) const {
+    if (pos + sizeof(T) > length) throw runerror{"Columnar file is truncated"};
+    T value;
+    std::memcpy(&value, data + pos, sizeof(T));
+    pos += sizeof(T);
+    return value;
+  }
+
+  void check(size_t pos, size_t size) const {
+    if (pos > length || size > length - pos)
+      throw runerror{"Columnar file is truncated"};
+  }
+
+  void parse() {
+    if (length < 16 || std::memcmp(data, magic, sizeof(magic)) ||
+        std::memcmp(data + length - 8, magic, sizeof(magic)))
+      throw runerror{"Not a columnar GFF file"};
+
+    size_t pos{sizeof(magic)};
+    if (read<uint32_t>(pos) != version)
+      throw runerror{"Unsupported columnar file version"};
+    if (read<uint32_t>(pos) != byte_order)
+      throw runerror{"Columnar file has a different byte order"};
+
+    columns.resize(read<uint32_t>(pos));
+    for (auto &column : columns) {
+      const auto type = read<uint8_t>(pos);
+      if (type > static_cast<uint8_t>(ColumnType::Float64))
+        throw runerror{"Unknown column type " + std::to_string(type)};
+      column.type = static_cast<ColumnType>(type);
+      const auto size = read<uint32_t>(pos);
+      check(pos, size);
+      column.name.assign(reinterpret_cast<const char *>(data + pos), size);
+      pos += size;
+    }
+
+    size_t footer = length - 16;
+    footer = read<uint64_t>(footer);
+    rows = read<uint64_t>(footer);
+    chunk_rows = read<uint64_t>(footer);
+    const auto chunk_count = read<uint64_t>(footer);
+
+    chunk_sizes.reserve(chunk_count);
+    chunks.reserve(chunk_count);
+    uint64_t total{0};
+    for (uint64_t chunk = 0; chunk < chunk_count; ++chunk) {
+      size_t chunk_pos = read<uint64_t>(footer);
+      const auto size = read<uint64_t>(chunk_pos);
+      if (size > chunk_rows) throw runerror{"Columnar chunk is too large"};
+      chunk_sizes.push_back(size);
+      total += size;
+
+      auto &slices = chunks.emplace_back(columns.size());
+      for (size_t column = 0; column < columns.size(); ++column) {
+        const auto valid_size = padded((size + 7) / 8);
+        const auto values_size = padded(size * width(columns[column].type));
+        check(chunk_pos, valid_size + values_size);
+        slices[column].valid = data + chunk_pos;
+        slices[column].values = data + chunk_pos + valid_size;
+        chunk_pos += valid_size + values_size;
+        if (columns[column].type == ColumnType::String)
+          chunk_pos = parseDictionary(chunk_pos, slices[column].dictionary);
+      }
+    }
+    if (total != rows) throw runerror{"Columnar row count does not match"};
+  }
+
+  // Maps the dictionary at `pos`, returning the position after it. Offsets
+  // are checked against the bytes when a value is read.
+  size_t parseDictionary(size_t pos, Dictionary &dictionary) const {
+    dictionary.count = read<uint64_t>(pos);
+    if (dictionary.count >= length / sizeof(uint64_t))
+      throw runerror{"Columnar file is truncated"};
+    const auto offsets_size = (dictionary.count + 1) * sizeof(uint64_t);
+    check(pos, offsets_size);
+    dictionary.offsets = reinterpret_cast<const uint64_t *>(data + pos);
+    dictionary.bytes =
+        reinterpret_cast<const char *>(data + pos + offsets_size);
+    const auto bytes_size = dictionary.offsets[dictionary.count];
+    check(pos + offsets_size, bytes_size);
+    return pos + padded(offsets_size + bytes_size);
+  }
+
+  const Slice &slice(size_t column, size_t row) const {
+    if (row >= rows) throw std::out_of_range{"Row out of range"};
+    return chunks[row / chunk_rows].at(column);
+  }
+
+  template <class T>
+  T value(size_t column, size_t row) const {
+    T result;
+    std::memcpy(&result,
+                slice(column, row).values + (row % chunk_rows) * sizeof(T),
+                sizeof(T));
+    return result;
+  }
+
+  void expect(size_t column, ColumnType type) const {
+    if (columns.at(column).type != type)
+      throw runerror{"Column '" + columns[column].name + "' has another type"};
+  }
+
+ public:
+  ColumnarFile() = delete;
+  ColumnarFile(const ColumnarFile &) = delete;
+  ColumnarFile &operator=(const ColumnarFile &) = delete;
+
+  explicit ColumnarFile(const string &file_name) {
+    const auto fd = open(file_name.c_str(), O_RDONLY);
+    if (fd == -1) throw runerror{"Cannot open file '" + file_name + "'"};
+
+    struct stat info {};
+    if (fstat(fd, &info) == -1 || info.st_size == 0) {
+      close(fd);
+      throw runerror{"Not a columnar GFF file"};
+    }
+    length = static_cast<size_t>(info.st_size);
+
+    auto mapped = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED)
+      throw runerror{"Cannot map file '" + file_name + "'"};
+    data = static_cast<const uint8_t *>(mapped);
+
+    try {
+      parse();
+    } catch (...) {
+      munmap(const_cast<uint8_t *>(data), length);
+      throw;
+    }
+  }
+
+  ~ColumnarFile() {
+    if (data) munmap(const_cast<uint8_t *>(data), length);
+  }
+
+  size_t getRows() const noexcept { return rows; }
+  size_t getChunkRows() const noexcept { return chunk_rows; }
+  size_t getChunks() const noexcept { return chunks.size(); }
+  size_t getChunkSize(size_t chunk) const { return chunk_sizes.at(chunk); }
+  size_t size() const noexcept { return columns.size(); }
+  const vector<Column> &getColumns() const noexcept { return columns; }
+
+  optional<size_t> findColumn(const string &name) const {
+    for (size_t column = 0; column < columns.size(); ++column)
+      if (columns[column].name == name) return column;
+    return std::nullopt;
+  }
+
+  bool isNull(size_t column, size_t row) const {
+    const auto pos = row % chunk_rows;
+    return !(slice(column, row).valid[pos / 8] & (1u << (pos % 8)));
+  }
+
+  int32_t getInt(size_t column, size_t row) const {
+    expect(column, ColumnType::Int32);
+    return value<int32_t>(column, row);
+  }
+
+  double getDouble(size_t column, size_t row) const {
+    expect(column, ColumnType::Float64);
+    return value<double>(column, row);
+  }
+
+  // Code of the value in the dictionary of the row's chunk.
+  uint32_t getCode(size_t column, size_t row) const {
+    expect(column, ColumnType::String);
+    return value<uint32_t>(column, row);
+  }
+
+  size_t getDictionarySize(size_t chunk, size_t column) const {
+    expect(column, ColumnType::String);
+    return chunks.at(chunk)[column].dictionary.count;
+  }
+
+  string_view getDictionary(size_t chunk, size_t column, size_t code) const {
+    expect(column, ColumnType::String);
+    const auto &dictionary = chunks.at(chunk)[column].dictionary;
+    if (code >= dictionary.count) throw std::out_of_range{"Unknown code"};
+    const auto first = dictionary.offsets[code];
+    const auto last = dictionary.offsets[code + 1];
+    if (first > last || last > dictionary.offsets[dictionary.count])
+      throw runerror{"Columnar dictionary is corrupt"};
+    return string_view(dictionary.bytes + first, last - first);
+  }
+
+  optional<string_view> getString(size_t column, size_t row) const {
+    if (isNull(column, row)) return std::nullopt;
+    return getDictionary(row / chunk_rows, column, getCode(column, row));
+  }
+
+  // Raw chunk buffers: the validity bitmap and getChunkSize() values of the
+  // column's fixed width, both 8-byte aligned.
+  const uint8_t *getChunkValid(size_t chunk, size_t column) const {
+    return chunks.at(chunk).at(column).valid;
+  }
+
+  const void *getChunkValues(size_t chunk, size_t column) const {
+    return chunks.at(chunk).at(column).values;
+  }
+};
+
+}  // namespace HKL::Columnar
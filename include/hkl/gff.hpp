@@ -1,16 +1,32 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <charconv>
+#include <cstring>
+#include <fstream>
+#include <future>
 #include <iostream>
+#include <memory>
 #include <optional>
 #include <stdexcept>
 #include <string>
+#include <string_view>
+#include <thread>
 #include <variant>
+#include <vector>
 
 #include <agizmo/files.hpp>
 #include <agizmo/printable.hpp>
 #include <agizmo/strings.hpp>
 
+#include <hkl/metrics.hpp>
+#include <hkl/parallel.hpp>
+#include <hkl/percent.hpp>
 #include <hkl/region.hpp>
+#include <hkl/regionseq.hpp>
+#include <hkl/stringpool.hpp>
 
 // uncomment to disable assert()
 // #define NDEBUG
@@ -20,13 +36,16 @@ namespace HKL::GFF {
 
 using namespace AGizmo;
 
+using std::array;
 using std::cerr;
+using std::move;
 using std::nullopt;
 using std::optional;
 using std::ostream;
 using runerror = std::runtime_error;
 using std::stod;
 using std::string;
+using std::string_view;
 using std::to_string;
 using std::variant;
 
@@ -35,112 +54,323 @@ using opt_double = optional<double>;
 using opt_char = optional<char>;
 using opt_int = optional<int>;
 
+// A value built on first use from const code. Threads racing to build it
+// each build one and publish it with compare-exchange; the first published
+// is kept and the others discarded, so const readers need no lock. Copies
+// copy the value when it is built.
+template <class T>
+class LazyValue {
+ private:
+  mutable std::atomic<T *> value{nullptr};
+
+ public:
+  LazyValue() = default;
+  LazyValue(const LazyValue &other) {
+    if (const auto built = other.get()) value.store(new T(*built));
+  }
+  LazyValue(LazyValue &&other) noexcept
+      : value{other.value.exchange(nullptr)} {}
+  LazyValue &operator=(LazyValue other) noexcept {
+    delete value.exchange(other.value.exchange(nullptr));
+    return *this;
+  }
+  ~LazyValue() { delete value.load(); }
+
+  T *get() const noexcept { return value.load(std::memory_order_acquire); }
+
+  template <class Build>
+  T &get(Build &&build) const {
+    if (const auto built = get()) return *built;
+    auto made = std::make_unique<T>(build());
+    T *expected{nullptr};
+    if (value.compare_exchange_strong(expected, made.get(),
+                                      std::memory_order_acq_rel,
+                                      std::memory_order_acquire))
+      return *made.release();
+    return *expected;
+  }
+};
+
 class GFFRecord {
  private:
   //  string temp{};
 
-  opt_str seqid{};
-  opt_str source{};
-  opt_str type{};
+  // seqid, source and type are interned in a pool shared with every record
+  // of the same reader, or in default_pool() when built without one;
+  // StringPool::none stands for a missing value. Attribute keys stay in the
+  // text of column 9.
+  std::shared_ptr<StringPool> pool{default_pool()};
+  StringPool::id_t seqid{StringPool::none};
+  StringPool::id_t source{StringPool::none};
+  StringPool::id_t type{StringPool::none};
   int range_start{0};
   int range_end{0};
   size_t length{0};
   opt_double score{};
   opt_char strand{};
   opt_int phase{};
-  Printable::PrintableStrMap attr{};
+  // Column 9 is kept verbatim and parsed into `attr` on first use of the
+  // whole map; single-key lookups scan the raw text instead. On both paths a
+  // key given more than once keeps its first value. Const records may be
+  // read from several threads, which LazyValue makes safe.
+  string attr_raw{};
+  LazyValue<Printable::PrintableStrMap> attr{};
+
+  Printable::PrintableStrMap parse_attributes() const {
+    Printable::PrintableStrMap parsed;
+    string_view attributes{attr_raw};
+    while (!attributes.empty()) {
+      const auto sep = attributes.find(';');
+      const auto item = attributes.substr(0, sep);
+      attributes.remove_prefix(sep == string_view::npos ? attributes.size()
+                                                        : sep + 1);
+      const auto equal = item.find('=');
+      const string key{item.substr(0, equal)};
+      if (key.empty() || parsed.has(key)) continue;
+      auto &value = parsed[key];
+      if (equal == string_view::npos) continue;
+      if (const auto raw = item.substr(equal + 1);
+          raw.find(',') == string_view::npos)
+        value = gff3_str_clean(raw);
+      else
+        value = string(raw);
+    }
+    return parsed;
+  }
 
- public:
-  static constexpr char gff3_escape[]{"\t\n\r%;=&,"};
+  Printable::PrintableStrMap &attributes() const {
+    return attr.get([this] { return parse_attributes(); });
+  }
 
-  static string gff3_str_escape(const string &input) {
-    sstream message;
-    size_t last{0}, pos{input.find_first_of(gff3_escape)};
+  // The record's pool; a record moved from has none and uses the default.
+  StringPool &strings() const { return pool ? *pool : *default_pool(); }
 
-    if (pos == string::npos) return input;
+  StringPool::id_t intern(string_view field) const {
+    if (field == ".") return StringPool::none;
+    if (field.find('%') == string_view::npos) return strings().intern(field);
+    return strings().intern(gff3_str_clean(field));
+  }
 
-    do {
-      message << input.substr(last, pos - last);
-      if (pos == string::npos) break;
-      message << "%" << std::hex << std::uppercase << int(input.at(pos));
-      last = pos + 1;
-      pos = input.find_first_of(gff3_escape, last);
-    } while (true);
+  opt_str lookup(StringPool::id_t id) const {
+    if (id == StringPool::none) return nullopt;
+    return strings()[id];
+  }
 
-    return message.str();
+  const string &lookup(StringPool::id_t id, const string &missing) const {
+    return id == StringPool::none ? missing : strings()[id];
+  }
+
+ public:
+  static constexpr const char *gff3_escape{Percent::reserved_chars};
+
+  static string gff3_str_escape(string_view input) {
+    return Percent::encoded(input);
   }
 
   static string gff3_str_clean(string input) {
-    size_t pos = input.find('%');
-    while (pos != string::npos) {
-      auto ele = char(stoi(input.substr(pos + 1, 2), nullptr, 16));
-      input.replace(pos, 3, 1, ele);
-      pos = input.find('%', pos + 1);
+    return Percent::decoded(move(input));
+  }
+
+  using fields_t = array<string_view, 9>;
+
+  // Splits a line into its nine tab-separated columns without copying.
+  // Returns false when the number of columns differs from nine.
+  static bool split_fields(string_view line, fields_t &fields) noexcept {
+    size_t column{0}, first{0};
+    for (auto pos = line.find('\t'); pos != string_view::npos;
+         pos = line.find('\t', first)) {
+      if (column == fields.size() - 1) return false;
+      fields[column++] = line.substr(first, pos - first);
+      first = pos + 1;
     }
-    return input;
+    fields[column++] = line.substr(first);
+    return column == fields.size();
   }
 
-  GFFRecord() = default;
-  GFFRecord(const string &line) {
-    const auto splitted = StringDecompose::str_split(line, "\t");
+  // As split_fields(), throwing on a line without exactly nine columns.
+  static fields_t split_line(string_view line) {
+    fields_t fields;
+    if (!split_fields(line, fields))
+      throw runerror{"GFF record does not have 9 columns - " + string(line)};
+    return fields;
+  }
 
-    assert(splitted.size() == 9);
+  static opt_int parse_int(string_view value) noexcept {
+    int result{0};
+    const auto last = value.data() + value.size();
+    if (const auto [ptr, error] = std::from_chars(value.data(), last, result);
+        error != std::errc() || ptr != last)
+      return nullopt;
+    return result;
+  }
 
-    auto item = splitted.begin();
+  static string gff3_str_clean(string_view input) {
+    string result;
+    Percent::decode_append(input, result);
+    return result;
+  }
 
-    if (const auto &seqid = *item; seqid != ".")
-      this->seqid = gff3_str_clean(seqid);
+  // Pool of the records built without one, shared by all of them. It only
+  // grows by distinct seqid, source and type values and keys interned by
+  // getKeyIndices().
+  static const std::shared_ptr<StringPool> &default_pool() {
+    static const auto pool = std::make_shared<StringPool>();
+    return pool;
+  }
 
-    if (const auto &source = *(++item); source != ".")
-      this->source = gff3_str_clean(source);
+  GFFRecord() = default;
+  GFFRecord(const string &line, std::shared_ptr<StringPool> pool = nullptr)
+      : GFFRecord(split_line(line), move(pool)) {}
+  GFFRecord(const fields_t &fields, std::shared_ptr<StringPool> pool = nullptr)
+      : pool{pool ? move(pool) : default_pool()} {
+    auto item = fields.begin();
 
-    if (const auto &type = *(++item); type != ".")
-      this->type = gff3_str_clean(type);
+    this->seqid = intern(*item);
+    this->source = intern(*(++item));
+    this->type = intern(*(++item));
 
-    if (const auto &start = StringFormat::str_to_int(*(++item)))
+    if (const auto &start = parse_int(*(++item)))
       this->range_start = *start;
     else
-      throw runerror{"Start field, 4th column, is malformed - " + *item};
+      throw runerror{"Start field, 4th column, is malformed - " +
+                     string(*item)};
 
-    if (const auto &end = StringFormat::str_to_int(*(++item)))
+    if (const auto &end = parse_int(*(++item)))
       this->range_end = *end;
     else
-      throw runerror{"Start field, 5th column, is malformed - " + *item};
+      throw runerror{"Start field, 5th column, is malformed - " +
+                     string(*item)};
 
     length = static_cast<size_t>(range_end - range_start + 1);
 
-    if (const auto &score = *(++item); score != ".") this->score = stod(score);
+    if (const auto &score = *(++item); score != ".")
+      this->score = stod(string(score));
 
     if (const auto &strand = *(++item); strand != ".") {
       if (strand == "-" || strand == "+")
         this->strand = strand.at(0);
       else
-        throw runerror{"Strand field, 6th column, is malformed - " + *item};
+        throw runerror{"Strand field, 6th column, is malformed - " +
+                       string(*item)};
     }
 
     if (const auto &phase = *(++item); phase != ".") {
-      if (const auto int_phase = StringFormat::str_to_int(phase))
+      if (const auto int_phase = parse_int(phase))
         this->phase = *int_phase;
       else
-        throw runerror{"Phase field, 8th column, is malformed - " + *item};
+        throw runerror{"Phase field, 8th column, is malformed - " +
+                       string(*item)};
     }
 
-    attr = Printable::PrintableStrMap(splitted.at(8), ';', '=');
-    for (const auto &key : attr.get_keys()) {
-      if (auto &value = attr[key]; value.has_value())
-        if ((*value).find(',') == string::npos)
-          attr[key] = gff3_str_clean(*value);
+    attr_raw = *(++item);
+  }
+
+  // Finds `key` in a raw attribute column with a single scan, returning its
+  // first value undecoded. The outer optional is empty when the key is
+  // absent, the inner one when the key has no value.
+  static optional<optional<string_view>> find_raw(string_view attributes,
+                                                  string_view key) {
+    while (!attributes.empty()) {
+      const auto sep = attributes.find(';');
+      const auto item = attributes.substr(0, sep);
+      const auto equal = item.find('=');
+      if (item.substr(0, equal) == key) {
+        if (equal == string_view::npos) return optional<string_view>{};
+        return item.substr(equal + 1);
+      }
+      if (sep == string_view::npos) break;
+      attributes.remove_prefix(sep + 1);
+    }
+    return nullopt;
+  }
+
+  // As find_raw(), with single values decoded. Values holding lists (',')
+  // are returned without decoding.
+  static optional<opt_str> scan_attribute(string_view attributes,
+                                          string_view key) {
+    const auto found = find_raw(attributes, key);
+    if (!found) return nullopt;
+    if (!*found) return opt_str{};
+    const auto value = **found;
+    if (value.find(',') != string_view::npos) return string(value);
+    return gff3_str_clean(value);
+  }
+
+  // Moves seqid, source and type to `target`. `ids` maps IDs of the current
+  // pool to those of `target` and is filled as values are met, so records
+  // moved from one pool translate each distinct value once.
+  void rebind(const std::shared_ptr<StringPool> &target,
+              vector<StringPool::id_t> &ids) {
+    if (pool == target) return;
+    for (const auto id : {&seqid, &source, &type}) {
+      if (*id == StringPool::none) continue;
+      if (*id >= ids.size()) ids.resize(*id + 1, StringPool::none);
+      auto &mapped = ids[*id];
+      if (mapped == StringPool::none) mapped = target->intern(strings()[*id]);
+      *id = mapped;
     }
+    pool = target;
   }
 
-  auto &getKeys() { return attr.get_keys(); }
+  // Writes IDs of the keys of a raw attribute column, in column order, to
+  // `out`, interning them into `pool`.
+  template <class Output>
+  static Output scan_keys(string_view attributes, StringPool &pool,
+                          Output out) {
+    while (!attributes.empty()) {
+      const auto sep = attributes.find(';');
+      const auto item = attributes.substr(0, sep);
+      if (const auto key = item.substr(0, item.find('=')); !key.empty())
+        *out++ = pool.intern(key);
+      if (sep == string_view::npos) break;
+      attributes.remove_prefix(sep + 1);
+    }
+    return out;
+  }
 
-  auto size() const { return attr.size(); }
-  auto isEmpty() const { return attr.isEmpty(); }
+  // Writes IDs of the attribute keys, in column order, to `out` without
+  // building the attribute map. Keys are interned into the record's pool
+  // here, on request, for callers discovering the keys of a file.
+  template <class Output>
+  Output getKeyIndices(Output out) const {
+    if (const auto parsed = attr.get()) {
+      for (auto key = parsed->keys_cbegin(); key != parsed->keys_cend(); ++key)
+        *out++ = strings().intern(*key);
+      return out;
+    }
+    return scan_keys(attr_raw, strings(), out);
+  }
 
-  opt_str getSeqID() const { return seqid; }
-  opt_str getType() const { return type; }
-  opt_str getSource() const { return source; }
+  // Parses all attributes now; later lookups go through the parsed map.
+  void materialize() const { attributes(); }
+
+  // Whether the parsed value of `key` is a list kept with its raw commas,
+  // rather than a single value whose decoded text has a comma, as "a%2Cb"
+  // has. The raw column decides while the value is the one read from it.
+  bool isList(const string &key) const {
+    const auto value = attributes().get(key);
+    if (!value || !*value || (**value).find(',') == string::npos) return false;
+    if (const auto raw = find_raw(attr_raw, key);
+        raw && *raw && (**raw).find(',') == string_view::npos)
+      return gff3_str_clean(**raw) != **value;
+    return true;
+  }
+  bool isMaterialized() const noexcept { return attr.get(); }
+  const string &getRawAttributes() const noexcept { return attr_raw; }
+
+  auto &getKeys() { return attributes().get_keys(); }
+
+  auto size() const { return attributes().size(); }
+  auto isEmpty() const { return attributes().isEmpty(); }
+
+  opt_str getSeqID() const { return lookup(seqid); }
+  opt_str getType() const { return lookup(type); }
+  opt_str getSource() const { return lookup(source); }
+  // Interned IDs, comparable with getPool()->find() results.
+  StringPool::id_t getSeqIDIndex() const noexcept { return seqid; }
+  StringPool::id_t getTypeIndex() const noexcept { return type; }
+  StringPool::id_t getSourceIndex() const noexcept { return source; }
+  const std::shared_ptr<StringPool> &getPool() const noexcept { return pool; }
   int getStart() const { return range_start; }
   int getEnd() const { return range_end; }
   size_t getLength() const { return length; }
@@ -151,101 +381,309 @@ class GFFRecord {
   bool isRecord() const noexcept { return true; }
   bool isComment() const noexcept { return false; }
 
-  auto begin() const noexcept { return attr.begin(); }
-  auto end() const noexcept { return attr.end(); }
+  auto begin() const { return attributes().begin(); }
+  auto end() const { return attributes().end(); }
 
-  auto keys_begin() noexcept { return attr.keys_begin(); }
-  auto keys_end() noexcept { return attr.keys_end(); }
-  auto keys_cbegin() const noexcept { return attr.keys_cbegin(); }
-  auto keys_cend() const noexcept { return attr.keys_cend(); }
+  auto keys_begin() { return attributes().keys_begin(); }
+  auto keys_end() { return attributes().keys_end(); }
+  auto keys_cbegin() const { return attributes().keys_cbegin(); }
+  auto keys_cend() const { return attributes().keys_cend(); }
 
-  auto &operator[](const string &key) { return attr[key]; }
-  auto at(string key) const { return attr.at(key); }
-  optional<opt_str> get(const string &key) const noexcept {
-    return attr.get(key);
+  auto &operator[](const string &key) { return attributes()[key]; }
+  opt_str at(string key) const {
+    if (const auto parsed = attr.get()) return parsed->at(key);
+    if (auto value = scan_attribute(attr_raw, key)) return *value;
+    throw std::out_of_range{"Attribute '" + key + "' not found"};
+  }
+  optional<opt_str> get(const string &key) const {
+    if (const auto parsed = attr.get()) return parsed->get(key);
+    return scan_attribute(attr_raw, key);
   }
   string get(const string &key, const string &value,
              const string &empty = "") const {
-    return attr.get(key, value, empty);
+    if (const auto parsed = attr.get()) return parsed->get(key, value, empty);
+    if (const auto found = scan_attribute(attr_raw, key))
+      return (*found).value_or(empty);
+    return value;
   }
 
-  bool has(const string &key) const { return attr.has(key); }
+  bool has(const string &key) const {
+    if (const auto parsed = attr.get()) return parsed->has(key);
+    return scan_attribute(attr_raw, key).has_value();
+  }
 
-  string str() const {
-    sstream output;
-    output << gff3_str_escape(seqid.value_or(".")) << '\t'
-           << gff3_str_escape(source.value_or(".")) << '\t'
-           << gff3_str_escape(type.value_or(".")) << '\t' << range_start << "\t"
-           << range_end << "\t";
-    if (const auto &score = this->score) {
-      if (*score != 1.0)
-        output << StringFormat::str_double(*score, 3, 0);
-      else
-        output << 1;
-    } else
-      output << ".";
+  template <class Int>
+  static void append_int(string &out, Int value) {
+    char digits[24];
+    const auto result = std::to_chars(digits, digits + sizeof(digits), value);
+    out.append(digits, result.ptr);
+  }
 
-    output << "\t" << strand.value_or('.') << "\t";
+  // Three decimals, except exactly 1 which is written as "1".
+  static void append_score(string &out, double score) {
+    if (score == 1.0) {
+      out.push_back('1');
+      return;
+    }
+    char digits[352];
+    const auto result = std::to_chars(digits, digits + sizeof(digits), score,
+                                      std::chars_format::fixed, 3);
+    out.append(digits, result.ptr);
+  }
 
-    if (const auto &phase = this->phase)
-      output << *phase;
+  // Appends the record as a GFF3 line without the newline. Attributes are
+  // copied from the raw column unless the record was materialized.
+  void appendGFF(string &out) const {
+    const string dot{"."};
+    Percent::encode_append(lookup(seqid, dot), out);
+    out.push_back('\t');
+    Percent::encode_append(lookup(source, dot), out);
+    out.push_back('\t');
+    Percent::encode_append(lookup(type, dot), out);
+    out.push_back('\t');
+    append_int(out, range_start);
+    out.push_back('\t');
+    append_int(out, range_end);
+    out.push_back('\t');
+    if (score)
+      append_score(out, *score);
     else
-      output << ".";
-
-    output << "\t"
-           << attr.join_fields(attr.keys_cbegin(), attr.keys_cend(), ';', '=',
-                               [](const string &ele) {
-                                 if (ele.find(',') == string::npos)
-                                   return gff3_str_escape(ele);
-                                 else
-                                   return ele;
-                               });
+      out.push_back('.');
+    out.push_back('\t');
+    out.push_back(strand.value_or('.'));
+    out.push_back('\t');
+    if (phase)
+      append_int(out, *phase);
+    else
+      out.push_back('.');
+    out.push_back('\t');
 
-    return output.str();
+    const auto parsed = attr.get();
+    if (!parsed) {
+      out.append(attr_raw);
+      return;
+    }
+    for (auto key = parsed->keys_cbegin(); key != parsed->keys_cend(); ++key) {
+      if (key != parsed->keys_cbegin()) out.push_back(';');
+      out.append(*key);
+      const auto value = parsed->get(*key);
+      if (!value || !*value) continue;
+      out.push_back('=');
+      if (isList(*key))
+        out.append(**value);
+      else
+        Percent::encode_append(**value, out);
+    }
   }
 
-  string strFields(const string &missing = ".",
-                   const string &sep = "\t") const {
-    sstream output;
-    output << seqid.value_or(missing) << sep << source.value_or(missing) << sep
-           << type.value_or(missing) << sep << range_start << "\t" << range_end
-           << "\t";
-    if (const auto &score = this->score) {
-      if (*score != 1.0)
-        output << StringFormat::str_double(*score, 3, 0);
+  // Appends the eight fixed columns, unescaped, with `missing` for absent
+  // values.
+  void appendFields(string &out, string_view missing = ".",
+                    string_view sep = "\t") const {
+    const auto field = [&](StringPool::id_t id) {
+      if (id == StringPool::none)
+        out.append(missing);
       else
-        output << 1;
-    } else
-      output << missing;
-
-    if (strand.has_value())
-      output << sep << *strand << sep;
+        out.append(strings()[id]);
+      out.append(sep);
+    };
+    field(seqid);
+    field(source);
+    field(type);
+    append_int(out, range_start);
+    out.append(sep);
+    append_int(out, range_end);
+    out.append(sep);
+    if (score)
+      append_score(out, *score);
     else
-      output << sep << missing << sep;
-
-    if (const auto &phase = this->phase)
-      output << *phase;
+      out.append(missing);
+    out.append(sep);
+    if (strand)
+      out.push_back(*strand);
+    else
+      out.append(missing);
+    out.append(sep);
+    if (phase)
+      append_int(out, *phase);
     else
-      output << missing;
+      out.append(missing);
+  }
 
-    return output.str();
+  // Appends `sep` and the value of each key, as get(key, missing, empty).
+  template <class It>
+  void appendAttributes(string &out, It begin, It end,
+                        const string &missing = ".", string_view sep = "\t",
+                        const string &empty = "true") const {
+    for (auto key = begin; key != end; ++key) {
+      out.append(sep);
+      out.append(get(*key, missing, empty));
+    }
+  }
+
+  string str() const {
+    string output;
+    appendGFF(output);
+    return output;
+  }
+
+  string strFields(const string &missing = ".",
+                   const string &sep = "\t") const {
+    string output;
+    appendFields(output, missing, sep);
+    return output;
   }
 
   template <class It>
   string strAttributes(It begin, It end, const string &missing = ".",
                        const string &sep = "\t",
                        const string &empty = "true") const {
-    sstream output;
+    string output;
+    appendAttributes(output, begin, end, missing, sep, empty);
+    return output;
+  }
 
-    for (auto key = begin; key != end; ++key) {
-      output << sep << get(*key, missing, empty);
+  friend std::ostream &operator<<(ostream &stream, const GFFRecord &item) {
+    return stream << item.str();
+  }
+};
+
+// Non-owning record whose fields point into a line buffer, typically the
+// block buffer of GFFViewReader. Fields are returned raw or percent-decoded
+// on access; nothing is parsed or allocated up front. Use toRecord() to keep
+// a record beyond the lifetime of the buffer.
+class GFFRecordView {
+ private:
+  GFFRecord::fields_t fields{};
+
+  static opt_str decode(string_view field) {
+    if (field == ".") return nullopt;
+    return GFFRecord::gff3_str_clean(field);
+  }
+
+ public:
+  GFFRecordView() = default;
+  GFFRecordView(string_view line) {
+    if (!GFFRecord::split_fields(line, fields))
+      throw runerror{"GFF record does not have 9 columns - " + string(line)};
+  }
+
+  string_view getRaw(size_t column) const { return fields.at(column); }
+
+  // The whole line the fields were split from.
+  string_view getLine() const noexcept {
+    const auto first = fields.front().data();
+    const auto last = fields.back().data() + fields.back().size();
+    return string_view(first, static_cast<size_t>(last - first));
+  }
+  const GFFRecord::fields_t &getFields() const noexcept { return fields; }
+
+  string_view getRawSeqID() const noexcept { return fields[0]; }
+  string_view getRawSource() const noexcept { return fields[1]; }
+  string_view getRawType() const noexcept { return fields[2]; }
+  string_view getRawAttributes() const noexcept { return fields[8]; }
+
+  opt_str getSeqID() const { return decode(fields[0]); }
+  opt_str getSource() const { return decode(fields[1]); }
+  opt_str getType() const { return decode(fields[2]); }
+  opt_int getStart() const { return GFFRecord::parse_int(fields[3]); }
+  opt_int getEnd() const { return GFFRecord::parse_int(fields[4]); }
+  opt_double getScore() const {
+    if (fields[5] == ".") return nullopt;
+    return stod(string(fields[5]));
+  }
+  opt_char getStrand() const {
+    if (fields[6] == "+" || fields[6] == "-") return fields[6][0];
+    return nullopt;
+  }
+  opt_int getPhase() const { return GFFRecord::parse_int(fields[7]); }
+
+  // See GFFRecord::scan_attribute().
+  optional<opt_str> get(string_view key) const {
+    return GFFRecord::scan_attribute(fields[8], key);
+  }
+
+  bool has(string_view key) const { return get(key).has_value(); }
+
+  GFFRecord toRecord(std::shared_ptr<StringPool> pool = nullptr) const {
+    return GFFRecord(fields, move(pool));
+  }
+};
+
+// Selection applied by the readers to the raw columns of a line, before a
+// GFFRecord is built, so rejected lines cost a split and a few comparisons.
+// Empty lists and zero values accept everything. Attribute tests run last and
+// scan the raw attribute column without building the attribute map.
+struct GFFFilter {
+  vector<string> seqids{};
+  vector<string> types{};
+  vector<string> sources{};
+  // Records overlapping [first, last]; 0 leaves that side open.
+  int first{0};
+  int last{0};
+  // '+', '-' or '.'; 0 for any.
+  char strand{0};
+  // key=value tests, all of which must hold. A value matches one item of a
+  // list attribute; no value only requires the key to be present.
+  vector<std::pair<string, opt_str>> attributes{};
+  bool comments{true};
+
+  bool isEmpty() const noexcept {
+    return seqids.empty() && types.empty() && sources.empty() && !first &&
+           !last && !strand && attributes.empty() && comments;
+  }
+
+  static bool matches(const vector<string> &wanted, string_view field) {
+    if (wanted.empty()) return true;
+    if (Percent::needs_decoding(field)) {
+      const auto decoded = GFFRecord::gff3_str_clean(field);
+      return std::find(wanted.begin(), wanted.end(), decoded) != wanted.end();
     }
+    return std::find(wanted.begin(), wanted.end(), field) != wanted.end();
+  }
 
-    return output.str();
+  static bool matches(string_view attributes, const string &key,
+                      const opt_str &value) {
+    const auto found = GFFRecord::find_raw(attributes, key);
+    if (!found) return false;
+    if (!value) return true;
+    if (!*found) return false;
+
+    // Items are split on the raw commas and each decoded once, so an
+    // encoded comma stays part of its item.
+    auto items = **found;
+    while (true) {
+      const auto comma = items.find(',');
+      const auto item = items.substr(0, comma);
+      if (Percent::needs_decoding(item) ? GFFRecord::gff3_str_clean(item) ==
+                                              *value
+                                        : item == *value)
+        return true;
+      if (comma == string_view::npos) return false;
+      items.remove_prefix(comma + 1);
+    }
   }
 
-  friend std::ostream &operator<<(ostream &stream, const GFFRecord &item) {
-    return stream << item.str();
+  // Malformed coordinates are accepted so the record constructor reports
+  // them.
+  bool accepts(const GFFRecord::fields_t &fields) const {
+    if (!matches(seqids, fields[0]) || !matches(sources, fields[1]) ||
+        !matches(types, fields[2]))
+      return false;
+    if (strand && (fields[6].size() != 1 || fields[6].front() != strand))
+      return false;
+    if (first) {
+      if (const auto end = GFFRecord::parse_int(fields[4]); end && *end < first)
+        return false;
+    }
+    if (last) {
+      if (const auto start = GFFRecord::parse_int(fields[3]);
+          start && *start > last)
+        return false;
+    }
+    for (const auto &[key, value] : attributes)
+      if (!matches(fields[8], key, value)) return false;
+    return true;
   }
 };
 
@@ -306,34 +744,455 @@ class GFFComment {
 
 using gff_variant = variant<GFFComment, GFFRecord>;
 
+// True for the line opening the sequences that end a GFF3 file: a ##FASTA
+// directive or, when a file lacks one, the first FASTA header.
+inline bool is_fasta_start(string_view line) noexcept {
+  return !line.empty() && (line[0] == '>' || line.rfind("##FASTA", 0) == 0);
+}
+
+// Offset of the first line of `data` opening a FASTA section, or npos;
+// `data` starts at the beginning of a line.
+inline size_t find_fasta(string_view data) noexcept {
+  if (is_fasta_start(data)) return 0;
+  auto found = string_view::npos;
+  for (const auto marker : {string_view{"\n##FASTA"}, string_view{"\n>"}}) {
+    const auto pos = data.substr(0, found).find(marker);
+    if (pos != string_view::npos) found = pos + 1;
+  }
+  return found;
+}
+
+// Annotation is read up to the FASTA section, whose sequences then come from
+// readSeq() on the same pass over the input.
 class GFFReader {
  private:
   Files::FileReader reader;
+  std::unique_ptr<FASTAReader> fasta{nullptr};
+  std::shared_ptr<StringPool> pool{std::make_shared<StringPool>()};
+  GFFFilter filter{};
+  bool filtered{false};
+  Metrics *metrics{nullptr};
+
+  optional<string> read(const string &skip) {
+    if (!metrics) return reader(skip);
+    const Metrics::Scope scope{metrics, Metrics::Stage::Read};
+    auto line = reader(skip);
+    if (line) metrics->addRead((*line).size() + 1);
+    return line;
+  }
 
-  gff_variant process(const string &line) const {
-    if (line.find_first_of('#') == 0)
-      return GFFComment{line};
-    else
-      return GFFRecord{line};
+  template <class Input>
+  GFFRecord parse(const Input &input) {
+    if (!metrics) return GFFRecord{input, pool};
+    const auto start = Metrics::clock::now();
+    GFFRecord record{input, pool};
+    metrics->addRecord(Metrics::clock::now() - start);
+    return record;
   }
 
  public:
   GFFReader() = delete;
+  // The FASTA reader points to `reader`, so neither can be moved.
+  GFFReader(const GFFReader &) = delete;
+  GFFReader &operator=(const GFFReader &) = delete;
   GFFReader(const string &file_name) : reader{file_name} {}
   GFFReader(std::istream &stream) : reader{stream} {}
+  GFFReader(const string &file_name, GFFFilter filter) : reader{file_name} {
+    setFilter(move(filter));
+  }
+  GFFReader(std::istream &stream, GFFFilter filter) : reader{stream} {
+    setFilter(move(filter));
+  }
+
+  // Lines rejected by `filter` are skipped without building records.
+  void setFilter(GFFFilter filter) {
+    this->filter = move(filter);
+    filtered = !this->filter.isEmpty();
+  }
+  const GFFFilter &getFilter() const noexcept { return filter; }
+
+  // Times reading and parsing of every line into `metrics`, or stops when
+  // null.
+  void setMetrics(Metrics *metrics) noexcept { this->metrics = metrics; }
+
+  // Pool interning seqid, source, type and attribute keys of the records
+  // produced by this reader.
+  const std::shared_ptr<StringPool> &getPool() const noexcept { return pool; }
 
   optional<gff_variant> getItem(const string &skip = {}) {
     return (*this)(skip);
   }
 
+  // True once the annotation has ended at a FASTA section.
+  bool hasFASTA() const noexcept { return fasta != nullptr; }
+
   optional<gff_variant> operator()(const string &skip = {}) {
-    if (const auto line = reader(skip)) {
-      if ((*line).empty())
-        return (*this)(skip);
-      else
-        return process(*line);
-    } else
-      return nullopt;
+    if (fasta) return nullopt;
+    while (const auto line = read(skip)) {
+      if ((*line).empty()) continue;
+      if (is_fasta_start(*line)) {
+        fasta = std::make_unique<FASTAReader>(
+            reader, (*line)[0] == '>' ? *line : string{});
+        return nullopt;
+      }
+      if ((*line)[0] == '#') {
+        if (filtered && !filter.comments) continue;
+        return GFFComment{*line};
+      }
+      if (!filtered) return parse(*line);
+
+      const auto fields = GFFRecord::split_line(*line);
+      if (filter.accepts(fields)) return parse(fields);
+    }
+    return nullopt;
+  }
+
+  // Next sequence of the FASTA section, skipping the annotation left unread;
+  // nothing when the input has no such section.
+  optional<RegionSeq> readSeq(bool upper = false) {
+    while ((*this)()) continue;
+    if (!fasta) return nullopt;
+    return fasta->readSeq(upper);
+  }
+
+  vector<RegionSeq> readSequences(bool upper = false) {
+    vector<RegionSeq> result;
+    while (auto seq = readSeq(upper)) result.push_back(move(*seq));
+    return result;
+  }
+};
+
+using gff_view_variant = variant<GFFComment, GFFRecordView>;
+
+// Reads input in large blocks into a buffer it owns and hands out records as
+// GFFRecordView pointing into that buffer, so parsing a line allocates
+// nothing. A returned view is valid only until the next call; promote it with
+// toRecord() to keep it.
+class GFFViewReader {
+ private:
+  std::unique_ptr<std::ifstream> file{nullptr};
+  std::istream *stream{nullptr};
+  string buffer{};
+  size_t first{0}, filled{0};
+  bool eof{false}, fasta{false};
+  std::shared_ptr<StringPool> pool{std::make_shared<StringPool>()};
+  GFFFilter filter{};
+  bool filtered{false};
+  Metrics *metrics{nullptr};
+
+  void refill() {
+    if (first) {
+      std::memmove(buffer.data(), buffer.data() + first, filled - first);
+      filled -= first;
+      first = 0;
+    }
+    if (filled == buffer.size()) buffer.resize(buffer.size() * 2);
+
+    const Metrics::Scope scope{metrics, Metrics::Stage::Read};
+    stream->read(buffer.data() + filled,
+                 static_cast<std::streamsize>(buffer.size() - filled));
+    const auto count = static_cast<size_t>(stream->gcount());
+    if (metrics) metrics->addRead(count);
+    filled += count;
+    if (!count) eof = true;
+  }
+
+ public:
+  static constexpr size_t default_block{size_t{1} << 22};
+
+  GFFViewReader() = delete;
+  GFFViewReader(const string &file_name, size_t block = default_block)
+      : file{std::make_unique<std::ifstream>(file_name, std::ios::binary)},
+        stream{file.get()},
+        buffer(std::max<size_t>(block, 1), '\0') {
+    if (!*file) throw runerror{"Cannot open file '" + file_name + "'"};
+  }
+  GFFViewReader(std::istream &stream, size_t block = default_block)
+      : stream{&stream}, buffer(std::max<size_t>(block, 1), '\0') {}
+
+  const std::shared_ptr<StringPool> &getPool() const noexcept { return pool; }
+
+  void setFilter(GFFFilter filter) {
+    this->filter = move(filter);
+    filtered = !this->filter.isEmpty();
+  }
+
+  // Times the block reads into `metrics`; views are not timed as records.
+  void setMetrics(Metrics *metrics) noexcept { this->metrics = metrics; }
+
+  // Promotes a view to a record sharing this reader's string pool.
+  GFFRecord promote(const GFFRecordView &view) const {
+    return view.toRecord(pool);
+  }
+
+  optional<string_view> getLine() {
+    while (true) {
+      const auto begin = buffer.data() + first;
+      if (const auto end = static_cast<const char *>(
+              std::memchr(begin, '\n', filled - first))) {
+        first += static_cast<size_t>(end - begin) + 1;
+        return string_view(begin, static_cast<size_t>(end - begin));
+      }
+      if (eof) {
+        if (first == filled) return nullopt;
+        const string_view line(begin, filled - first);
+        first = filled;
+        return line;
+      }
+      refill();
+    }
+  }
+
+  // Stops at the FASTA section, leaving its sequences to getLine().
+  optional<gff_view_variant> operator()() {
+    if (fasta) return nullopt;
+    while (const auto line = getLine()) {
+      if ((*line).empty()) continue;
+      if (is_fasta_start(*line)) {
+        fasta = true;
+        if ((*line)[0] == '>')
+          first = static_cast<size_t>(line->data() - buffer.data());
+        return nullopt;
+      }
+      if ((*line)[0] == '#') {
+        if (filtered && !filter.comments) continue;
+        return GFFComment{string(*line)};
+      }
+      GFFRecordView view{*line};
+      if (!filtered || filter.accepts(view.getFields())) return view;
+    }
+    return nullopt;
+  }
+};
+
+// Reads a GFF with a pipeline: one thread reads large blocks and cuts them
+// at line boundaries, a pool of workers parses blocks into batches of
+// gff_variant, and the consumer receives the batches in file order. At most
+// `depth` blocks are in flight, which bounds memory. The sequence of items is
+// the same as produced by GFFReader, including where parsing errors are
+// raised: the records before a malformed line are handed over first, the
+// error is thrown when the consumer reaches the line, and reading goes on
+// after it.
+//
+// Each worker interns into a pool of its own, so workers never wait on each
+// other; the consumer moves records to the reader's pool through a table per
+// worker, which looks up each distinct value once.
+class GFFParallelReader {
+ public:
+  using batch_t = vector<gff_variant>;
+
+ private:
+  struct Parsed {
+    batch_t batch{};
+    // Malformed lines, by the position in `batch` they would have taken.
+    vector<std::pair<size_t, std::exception_ptr>> errors{};
+    size_t worker{0};
+  };
+
+  struct Task {
+    string data;
+    std::promise<Parsed> result;
+  };
+
+  std::unique_ptr<std::ifstream> file{nullptr};
+  std::istream *stream{nullptr};
+  std::shared_ptr<StringPool> pool{std::make_shared<StringPool>()};
+  vector<std::shared_ptr<StringPool>> pools{};
+  vector<vector<StringPool::id_t>> ids{};
+  size_t block{size_t{1} << 22};
+  Parallel::BoundedQueue<Task> tasks;
+  Parallel::BoundedQueue<std::future<Parsed>> results;
+  vector<std::thread> threads{};
+  // The parsed block being handed over, up to its next error.
+  Parsed held{};
+  size_t held_pos{0}, held_error{0};
+  batch_t current{};
+  size_t current_pos{0};
+  const GFFFilter filter{};
+  const bool filtered{false};
+
+  Parsed parse(const string &data, size_t worker) const {
+    Parsed parsed{{}, {}, worker};
+    auto &batch = parsed.batch;
+    string_view rest{data};
+    while (!rest.empty()) {
+      const auto end = rest.find('\n');
+      const auto line = rest.substr(0, end);
+      rest.remove_prefix(end == string_view::npos ? rest.size() : end + 1);
+
+      if (line.empty()) continue;
+      try {
+        if (line[0] == '#') {
+          if (!filtered || filter.comments)
+            batch.emplace_back(GFFComment{string(line)});
+          continue;
+        }
+        const auto fields = GFFRecord::split_line(line);
+        if (!filtered || filter.accepts(fields))
+          batch.emplace_back(GFFRecord{fields, pools[worker]});
+      } catch (const std::exception &) {
+        parsed.errors.emplace_back(batch.size(), std::current_exception());
+      }
+    }
+    return parsed;
+  }
+
+  bool submit(string data) {
+    Task task{move(data), {}};
+    if (!results.push(task.result.get_future())) return false;
+    return tasks.push(move(task));
+  }
+
+  void read() {
+    try {
+      string carry;
+      while (true) {
+        string data{move(carry)};
+        const auto offset = data.size();
+        data.resize(offset + block);
+        stream->read(data.data() + offset, static_cast<std::streamsize>(block));
+        data.resize(offset + static_cast<size_t>(stream->gcount()));
+
+        if (data.size() == offset) {
+          if (const auto fasta = find_fasta(data); fasta != string::npos)
+            data.resize(fasta);
+          if (!data.empty()) submit(move(data));
+          break;
+        }
+
+        const auto last = data.rfind('\n');
+        if (last == string::npos || last < offset) {
+          carry = move(data);
+          continue;
+        }
+        carry = data.substr(last + 1);
+        data.resize(last + 1);
+        // Nothing after the annotation is read.
+        if (const auto fasta = find_fasta(data); fasta != string::npos) {
+          data.resize(fasta);
+          if (!data.empty()) submit(move(data));
+          break;
+        }
+        if (!submit(move(data))) break;
+      }
+    } catch (...) {
+      std::promise<Parsed> failure;
+      failure.set_exception(std::current_exception());
+      results.push(failure.get_future());
+    }
+    tasks.close();
+    results.close();
+  }
+
+  void work(size_t worker) {
+    while (auto task = tasks.pop()) {
+      try {
+        task->result.set_value(parse(task->data, worker));
+      } catch (...) {
+        task->result.set_exception(std::current_exception());
+      }
+    }
+  }
+
+  void start(size_t workers) {
+    for (size_t i = 0; i < workers; ++i)
+      pools.push_back(std::make_shared<StringPool>());
+    ids.resize(workers);
+    threads.emplace_back(&GFFParallelReader::read, this);
+    for (size_t i = 0; i < workers; ++i)
+      threads.emplace_back(&GFFParallelReader::work, this, i);
+  }
+
+  // Items of `held` from the current position up to `last`.
+  batch_t take(size_t last) {
+    batch_t batch;
+    if (held_pos == 0 && last == held.batch.size())
+      batch = move(held.batch);
+    else
+      batch.assign(std::make_move_iterator(held.batch.begin() + held_pos),
+                   std::make_move_iterator(held.batch.begin() + last));
+    held_pos = last;
+    return batch;
+  }
+
+ public:
+  static constexpr size_t default_block{size_t{1} << 22};
+
+  GFFParallelReader() = delete;
+  GFFParallelReader(const GFFParallelReader &) = delete;
+  GFFParallelReader &operator=(const GFFParallelReader &) = delete;
+
+  // `threads` is the number of parsing workers (0 means all hardware
+  // threads); `depth` the number of blocks allowed in flight. Workers apply
+  // `filter` before building records.
+  GFFParallelReader(const string &file_name, size_t threads = 0,
+                    size_t block = default_block, size_t depth = 0,
+                    GFFFilter filter = {})
+      : file{std::make_unique<std::ifstream>(file_name, std::ios::binary)},
+        stream{file.get()},
+        block{std::max<size_t>(block, 1)},
+        tasks{Parallel::resolve_threads(threads)},
+        results{depth ? depth : 2 * Parallel::resolve_threads(threads)},
+        filter{move(filter)},
+        filtered{!this->filter.isEmpty()} {
+    if (!*file) throw runerror{"Cannot open file '" + file_name + "'"};
+    start(Parallel::resolve_threads(threads));
+  }
+
+  GFFParallelReader(std::istream &stream, size_t threads = 0,
+                    size_t block = default_block, size_t depth = 0,
+                    GFFFilter filter = {})
+      : stream{&stream},
+        block{std::max<size_t>(block, 1)},
+        tasks{Parallel::resolve_threads(threads)},
+        results{depth ? depth : 2 * Parallel::resolve_threads(threads)},
+        filter{move(filter)},
+        filtered{!this->filter.isEmpty()} {
+    start(Parallel::resolve_threads(threads));
+  }
+
+  ~GFFParallelReader() {
+    tasks.close();
+    results.close();
+    for (auto &thread : threads) thread.join();
+  }
+
+  const std::shared_ptr<StringPool> &getPool() const noexcept { return pool; }
+
+  // Next batch in file order; nothing once the input is exhausted. A batch
+  // ends before a malformed line, whose error the next call throws.
+  optional<batch_t> getBatch() {
+    while (true) {
+      if (held_error < held.errors.size()) {
+        const auto &[pos, error] = held.errors[held_error];
+        if (held_pos == pos) {
+          ++held_error;
+          std::rethrow_exception(error);
+        }
+        return take(pos);
+      }
+      if (held_pos < held.batch.size()) return take(held.batch.size());
+
+      auto result = results.pop();
+      if (!result) return nullopt;
+      held = result->get();
+      held_pos = held_error = 0;
+      for (auto &item : held.batch)
+        if (const auto record = std::get_if<GFFRecord>(&item))
+          record->rebind(pool, ids[held.worker]);
+    }
+  }
+
+  optional<gff_variant> getItem() { return (*this)(); }
+
+  optional<gff_variant> operator()() {
+    while (current_pos == current.size()) {
+      auto batch = getBatch();
+      if (!batch) return nullopt;
+      current = move(*batch);
+      current_pos = 0;
+    }
+    return move(current[current_pos++]);
   }
 };
 
@@ -0,0 +1,282 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include <hkl/gff.hpp>
+#include <hkl/parallel.hpp>
+#include <hkl/region.hpp>
+
+namespace HKL::GFF {
+
+using std::string;
+using std::vector;
+
+// Features of a GFF connected through their ID and Parent attributes. Records
+// are kept in file order in one array and both directions of the hierarchy
+// are stored as CSR adjacency lists (offsets into one flat array of node
+// indices), so traversal touches contiguous memory.
+// Parents may appear after their children and a feature may list several
+// parents. Parent IDs that are not defined in the input are reported by
+// getMissingParents() and leave the child as a root.
+class GFFFeatureGraph {
+ public:
+  using node_t = uint32_t;
+  static constexpr node_t none{std::numeric_limits<node_t>::max()};
+
+  // Contiguous run of node indices.
+  class Nodes {
+   private:
+    const node_t *first{nullptr}, *last{nullptr};
+
+   public:
+    Nodes(const node_t *first, const node_t *last) : first{first}, last{last} {}
+
+    const node_t *begin() const noexcept { return first; }
+    const node_t *end() const noexcept { return last; }
+    size_t size() const noexcept { return static_cast<size_t>(last - first); }
+    bool empty() const noexcept { return first == last; }
+    node_t operator[](size_t index) const { return first[index]; }
+  };
+
+  struct GeneSummary {
+    node_t gene{none};
+    Region span{};
+    size_t transcripts{0};
+    // Distinct exon loci over all transcripts.
+    size_t exons{0};
+    // Bases covered by CDS in any transcript.
+    size_t cds_length{0};
+  };
+
+  // IDs listed in a Parent value, percent-decoded.
+  static vector<string> split_parents(const string &value) {
+    vector<string> result;
+    size_t first{0};
+    while (true) {
+      const auto comma = value.find(',', first);
+      const auto item = value.substr(first, comma - first);
+      if (!item.empty()) result.push_back(GFFRecord::gff3_str_clean(item));
+      if (comma == string::npos) break;
+      first = comma + 1;
+    }
+    return result;
+  }
+
+ private:
+  vector<GFFRecord> records{};
+  std::unordered_map<string, node_t> ids{};
+  vector<node_t> child_offsets{0}, children{};
+  vector<node_t> parent_offsets{0}, parents{};
+  vector<node_t> roots{};
+  vector<string> missing_parents{};
+
+  static void to_csr(vector<std::pair<node_t, node_t>> &edges, size_t nodes,
+                     vector<node_t> &offsets, vector<node_t> &targets) {
+    offsets.assign(nodes + 1, 0);
+    for (const auto &edge : edges) ++offsets[edge.first + 1];
+    for (size_t node = 0; node < nodes; ++node)
+      offsets[node + 1] += offsets[node];
+
+    // Stable counting sort keeps children in file order.
+    targets.resize(edges.size());
+    auto next = offsets;
+    for (const auto &edge : edges) targets[next[edge.first]++] = edge.second;
+  }
+
+  void build() {
+    if (records.size() >= none) throw runerror{"Too many GFF records"};
+    const auto size = static_cast<node_t>(records.size());
+
+    for (node_t node = 0; node < size; ++node) {
+      if (const auto id = records[node].get("ID"); id && *id)
+        ids.try_emplace(**id, node);
+    }
+
+    vector<std::pair<node_t, node_t>> down, up;
+    std::unordered_set<string> missing;
+    for (node_t node = 0; node < size; ++node) {
+      const auto value = records[node].get("Parent");
+      if (!value || !*value) continue;
+      for (const auto &parent : split_parents(**value)) {
+        if (const auto found = ids.find(parent); found != ids.end()) {
+          down.emplace_back(found->second, node);
+          up.emplace_back(node, found->second);
+        } else if (missing.insert(parent).second)
+          missing_parents.push_back(parent);
+      }
+    }
+
+    to_csr(down, size, child_offsets, children);
+    to_csr(up, size, parent_offsets, parents);
+
+    for (node_t node = 0; node < size; ++node)
+      if (getParents(node).empty()) roots.push_back(node);
+  }
+
+  // Compares interned IDs when the record shares the pool of `type`, as all
+  // records of one reader do, and strings otherwise.
+  struct TypeMatch {
+    const StringPool *pool{nullptr};
+    std::optional<StringPool::id_t> id{};
+    string type{};
+
+    TypeMatch(const vector<GFFRecord> &records, const string &type)
+        : type{type} {
+      if (records.empty()) return;
+      pool = records.front().getPool().get();
+      id = pool->find(type);
+    }
+
+    bool operator()(const GFFRecord &record) const {
+      const auto index = record.getTypeIndex();
+      if (record.getPool().get() == pool) return id && index == *id;
+      return index != StringPool::none && (*record.getPool())[index] == type;
+    }
+  };
+
+ public:
+  GFFFeatureGraph() = default;
+
+  explicit GFFFeatureGraph(vector<GFFRecord> records)
+      : records{std::move(records)} {
+    build();
+  }
+
+  explicit GFFFeatureGraph(GFFReader &reader) {
+    while (auto item = reader()) {
+      if (auto record = std::get_if<GFFRecord>(&(*item)))
+        records.push_back(std::move(*record));
+    }
+    build();
+  }
+
+  explicit GFFFeatureGraph(const string &file_name) {
+    GFFReader reader{file_name};
+    *this = GFFFeatureGraph(reader);
+  }
+
+  size_t size() const noexcept { return records.size(); }
+  const vector<GFFRecord> &getRecords() const noexcept { return records; }
+  const GFFRecord &getRecord(node_t node) const { return records.at(node); }
+  const vector<node_t> &getRoots() const noexcept { return roots; }
+  const vector<string> &getMissingParents() const noexcept {
+    return missing_parents;
+  }
+
+  std::optional<node_t> find(const string &id) const {
+    if (const auto found = ids.find(id); found != ids.end())
+      return found->second;
+    return std::nullopt;
+  }
+
+  Nodes getChildren(node_t node) const {
+    return Nodes(children.data() + child_offsets.at(node),
+                 children.data() + child_offsets.at(node + 1));
+  }
+
+  Nodes getParents(node_t node) const {
+    return Nodes(parents.data() + parent_offsets.at(node),
+                 parents.data() + parent_offsets.at(node + 1));
+  }
+
+  // Calls func(node) for `node` and every descendant, pre-order. A feature
+  // reachable through several parents is visited once.
+  template <class Func>
+  void visit(node_t node, Func func) const {
+    std::unordered_set<node_t> seen{node};
+    vector<node_t> stack{node};
+    while (!stack.empty()) {
+      const auto current = stack.back();
+      stack.pop_back();
+      func(current);
+      const auto next = getChildren(current);
+      for (auto child = next.end(); child != next.begin();) {
+        --child;
+        if (seen.insert(*child).second) stack.push_back(*child);
+      }
+    }
+  }
+
+  vector<node_t> getSubtree(node_t node) const {
+    vector<node_t> result;
+    visit(node, [&result](node_t current) { result.push_back(current); });
+    return result;
+  }
+
+  vector<GFFRecord> getSubtreeRecords(node_t node) const {
+    vector<GFFRecord> result;
+    visit(node, [&](node_t current) { result.push_back(records[current]); });
+    return result;
+  }
+
+  GeneSummary summarize(node_t gene, const string &exon_type = "exon",
+                        const string &cds_type = "CDS") const {
+    const TypeMatch is_exon{records, exon_type}, is_cds{records, cds_type};
+    const auto &record = getRecord(gene);
+
+    GeneSummary result{gene};
+    result.transcripts = getChildren(gene).size();
+
+    int first{record.getStart()}, last{record.getEnd()};
+    vector<std::pair<int, int>> exons, coding;
+    visit(gene, [&](node_t node) {
+      const auto &feature = records[node];
+      first = std::min(first, feature.getStart());
+      last = std::max(last, feature.getEnd());
+      if (is_exon(feature))
+        exons.emplace_back(feature.getStart(), feature.getEnd());
+      else if (is_cds(feature))
+        coding.emplace_back(feature.getStart(), feature.getEnd());
+    });
+
+    std::sort(exons.begin(), exons.end());
+    result.exons = static_cast<size_t>(
+        std::unique(exons.begin(), exons.end()) - exons.begin());
+
+    std::sort(coding.begin(), coding.end());
+    int covered{std::numeric_limits<int>::min()};
+    for (const auto &[start, end] : coding) {
+      const auto from = std::max(start, covered + 1);
+      if (end >= from) result.cds_length += static_cast<size_t>(end - from + 1);
+      covered = std::max(covered, end);
+    }
+
+    const auto strand = record.getStrand().value_or(0);
+    result.span = Region(record.getSeqID().value_or(""), first, last,
+                         strand == '+' || strand == '-' ? strand : char{0});
+    return result;
+  }
+
+  // Summaries of every feature whose type is one of `gene_types`, in file
+  // order, computed in parallel.
+  vector<GeneSummary> summarize(
+      const vector<string> &gene_types = {"gene", "ncRNA_gene", "pseudogene"},
+      size_t threads = 0) const {
+    vector<TypeMatch> types;
+    for (const auto &type : gene_types) types.emplace_back(records, type);
+
+    vector<node_t> genes;
+    for (node_t node = 0; node < records.size(); ++node)
+      if (std::any_of(types.begin(), types.end(),
+                      [&](const auto &match) { return match(records[node]); }))
+        genes.push_back(node);
+
+    vector<GeneSummary> result(genes.size());
+    Parallel::parallel_for(
+        genes.size(),
+        [&](size_t index) { result[index] = summarize(genes[index]); },
+        threads);
+    return result;
+  }
+};
+
+}  // namespace HKL::GFF
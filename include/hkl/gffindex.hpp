@@ -0,0 +1,50 @@
+#pragma once
+
+#include <agizmo/args.hpp>
+#include <hkl/bgzf.hpp>
+#include <hkl/tabix.hpp>
+
+#include <optional>
+#include <string>
+
+using namespace AGizmo;
+
+namespace HKL {
+
+namespace GFF {
+
+using std::optional;
+using std::string;
+
+class IndexParameters {
+private:
+  string input{};
+  optional<string> output{};
+  bool csi{false};
+  int min_shift{Tabix::Index::tbi_min_shift};
+  int level{-1};
+  bool force{false};
+
+public:
+  IndexParameters() = default;
+  bool parse(int argc, char *argv[]);
+
+  auto getInput() const { return input; }
+  auto getOutput() const { return output; }
+  auto isCSI() const { return csi; }
+  auto getMinShift() const { return min_shift; }
+  // zlib compression level, -1 for its default.
+  auto getLevel() const { return level; }
+  auto isForced() const { return force; }
+};
+
+// BGZF copy of `input` when it is not compressed yet; returns the file to
+// index. An existing <input>.gz is only replaced with `force`.
+string ensure_bgzf(const string &input, int level = -1, bool force = false);
+
+// Builds the index of a BGZF-compressed GFF and returns its file name.
+string index_gff(const string &file_name, const IndexParameters &args);
+
+} // namespace GFF
+
+} // namespace HKL
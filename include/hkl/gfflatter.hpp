@@ -1,7 +1,11 @@
 #pragma once
 
 #include <agizmo/args.hpp>
+#include <hkl/columnar.hpp>
 #include <hkl/gff.hpp>
+#include <hkl/gffwriter.hpp>
+#include <hkl/gtf.hpp>
+#include <hkl/metrics.hpp>
 
 #include <iostream>
 #include <optional>
@@ -19,7 +23,20 @@ using std::optional;
 using std::string;
 using std::vector;
 
-enum class Formats { TSV = 0, JSON = 1 };
+enum class Formats { TSV = 0, JSON = 1, Columnar = 2, GTF = 3 };
+
+inline string extension(Formats format) {
+  switch (format) {
+  case Formats::JSON:
+    return ".ndjson";
+  case Formats::Columnar:
+    return ".hklc";
+  case Formats::GTF:
+    return ".gtf";
+  default:
+    return ".tsv";
+  }
+}
 
 class Parameters {
 private:
@@ -30,6 +47,11 @@ private:
   string missing{"."};
   string empty{"true"};
   bool comments{false};
+  size_t memory{size_t{1024} << 20};
+  bool split{false};
+  size_t threads{0};
+  bool stats{false};
+  size_t stats_interval{0};
 
 public:
   Parameters() = default;
@@ -44,11 +66,68 @@ public:
   auto getOutput() const { return output; }
   auto getMissing() const { return missing; }
   auto getEmpty() const { return empty; }
+  bool hasKeys() const { return !keys.empty(); }
+  auto getKeys() const { return keys; }
+  // Memory budget in bytes, 0 meaning unlimited.
+  auto getMemory() const { return memory; }
+  auto isSplit() const { return split; }
+  auto getThreads() const { return threads; }
+  auto hasStats() const { return stats; }
+  // Seconds between progress reports, 0 for only the final summary.
+  auto getStatsInterval() const { return stats_interval; }
 };
 
+// With an empty `keys` list the attribute columns are discovered first, which
+// requires holding all records. Otherwise each record is written as soon as it
+// is read.
 void gffile_to_tsv(std::unique_ptr<GFFReader> &reader,
                    std::unique_ptr<std::ostream> &writer, const string &missing,
-                   const std::string &empty, bool comments);
+                   const std::string &empty, bool comments,
+                   const vector<string> &keys = {});
+
+// Attribute keys of a file in first-seen order, from a pass that does not
+// keep records. Comments are copied to `comments` when given.
+vector<string> discover_keys(const string &file_name,
+                             std::ostream *comments = nullptr);
+
+// Bounded-memory variant for when keys are not given. Raw lines are held up
+// to `memory` bytes, counting what each takes on the heap, and beyond that
+// `file_name` is read again when the input is that file, or the lines are
+// spilled to a temporary file otherwise.
+void gffstream_to_tsv(std::istream &input,
+                      std::unique_ptr<std::ostream> &writer,
+                      const string &missing, const string &empty,
+                      bool comments, size_t memory,
+                      const std::optional<string> &file_name = std::nullopt);
+
+// Writes one JSON object per record (and per comment when enabled).
+void gffile_to_json(std::unique_ptr<GFFReader> &reader,
+                    std::unique_ptr<std::ostream> &writer, bool comments);
+
+// Writes the columnar binary layout of hkl/columnar.hpp. Without `keys` the
+// records are held until all keys are known.
+void gffile_to_columnar(std::unique_ptr<GFFReader> &reader,
+                        std::unique_ptr<std::ostream> &writer,
+                        const vector<string> &keys);
+
+// Writes GTF with gene_id and transcript_id resolved from ID and Parent, one
+// locus held at a time and formatted on `threads` workers. Only "#!" comments
+// are written.
+void gffile_to_gtf(std::unique_ptr<GFFReader> &reader,
+                   std::unique_ptr<std::ostream> &writer, bool comments,
+                   size_t threads);
+
+// Several inputs processed in parallel into one table. The TSV variant adds a
+// leading 'file' column and uses the union of the keys of all inputs when
+// `keys` is empty; the JSON variant adds a "file" member. Comments are not
+// written.
+void gffiles_to_tsv(const vector<string> &inputs,
+                    std::unique_ptr<std::ostream> &writer,
+                    const string &missing, const string &empty,
+                    const vector<string> &keys, size_t threads);
+
+void gffiles_to_json(const vector<string> &inputs,
+                     std::unique_ptr<std::ostream> &writer, size_t threads);
 
 } // namespace GFF
 
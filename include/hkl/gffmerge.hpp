@@ -0,0 +1,440 @@
+#pragma once
+
+#include <zlib.h>
+
+#include <hkl/gffsort.hpp>
+#include <hkl/parallel.hpp>
+#include <hkl/percent.hpp>
+
+#include <algorithm>
+#include <exception>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <queue>
+#include <streambuf>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace HKL::GFF {
+
+using std::optional;
+using std::string;
+using std::string_view;
+using std::vector;
+
+// Reads a gzip or BGZF file that a background thread decompresses ahead of
+// the reader, one block at a time, so several inputs inflate in parallel
+// while a single thread consumes them.
+class InflateStream : public std::istream {
+ private:
+  class Buffer : public std::streambuf {
+   private:
+    Parallel::BoundedQueue<string> blocks;
+    string block{};
+    std::exception_ptr error{nullptr};
+    std::thread worker{};
+
+    void inflate(gzFile file) {
+      try {
+        while (true) {
+          string data(block_size, '\0');
+          const auto count =
+              gzread(file, data.data(), static_cast<unsigned>(data.size()));
+          if (count < 0) {
+            int code{0};
+            throw runerror{string{"Cannot decompress: "} +
+                           gzerror(file, &code)};
+          }
+          if (!count) break;
+          data.resize(static_cast<size_t>(count));
+          if (!blocks.push(std::move(data))) break;
+        }
+      } catch (...) {
+        error = std::current_exception();
+      }
+      gzclose(file);
+      blocks.close();
+    }
+
+   protected:
+    int_type underflow() override {
+      if (gptr() < egptr()) return traits_type::to_int_type(*gptr());
+      auto next = blocks.pop();
+      if (!next) {
+        if (error) std::rethrow_exception(error);
+        return traits_type::eof();
+      }
+      block = std::move(*next);
+      setg(block.data(), block.data(), block.data() + block.size());
+      return traits_type::to_int_type(*gptr());
+    }
+
+   public:
+    static constexpr size_t block_size{size_t{1} << 20};
+
+    explicit Buffer(const string &file_name, size_t depth) : blocks{depth} {
+      const auto file = gzopen(file_name.c_str(), "rb");
+      if (!file) throw runerror{"Cannot open file '" + file_name + "'"};
+      gzbuffer(file, block_size);
+      worker = std::thread{&Buffer::inflate, this, file};
+    }
+    Buffer(const Buffer &) = delete;
+    Buffer &operator=(const Buffer &) = delete;
+    ~Buffer() override {
+      blocks.close();
+      worker.join();
+    }
+  };
+
+  Buffer buffer;
+
+ public:
+  // `depth` decompressed blocks of 1 MiB are kept ahead of the reader.
+  explicit InflateStream(const string &file_name, size_t depth = 4)
+      : std::istream{nullptr}, buffer{file_name, depth} {
+    rdbuf(&buffer);
+    exceptions(std::ios::badbit);
+  }
+
+  static bool is_compressed(const string &file_name) {
+    std::ifstream file{file_name, std::ios::binary};
+    return file.get() == 0x1f && file.get() == 0x8b;
+  }
+};
+
+// Merges GFF files sorted by (seqid, start, end), as GFFSort writes them,
+// holding one line per input. Lines are copied as they are and records with
+// equal keys are taken from the inputs in the order given.
+//
+// Each input orders its sequences as its ##sequence-region directives list
+// them, or by first appearance. A first pass over every input collects these
+// orders and ranks the sequences in one order keeping all of them, so the
+// result does not depend on the order of the inputs; inputs ordering two
+// sequences differently cannot be merged.
+//
+// Comments and directives of the headers are written once, in the order
+// first seen, and ##sequence-region lines for the same sequence are merged
+// into one covering all their ranges and listed in the merged order. Later
+// comments are written where they occur, "###" is dropped, and the FASTA
+// sections of all inputs are written at the end.
+// A record that sorts before its predecessor in the same input is an error.
+class GFFMerger {
+ private:
+  struct Input {
+    string name{};
+    std::unique_ptr<std::istream> stream{nullptr};
+    std::unique_ptr<GFFViewReader> reader{nullptr};
+    string_view line{};
+    SortKey key{}, last{};
+    bool fasta{false};
+  };
+
+  struct SequenceRegion {
+    string text{};
+    int64_t start{0}, end{0};
+    bool merged{false};
+  };
+
+  vector<Input> inputs{};
+  std::unordered_map<string, uint32_t> seqids{};
+  vector<SequenceRegion> regions{};
+  std::unordered_set<string> directives{};
+  optional<string> tag{};
+  GFFRecord::fields_t fields{};
+
+  uint32_t rank(string_view seqid) const {
+    const auto found = seqids.find(string(seqid));
+    if (found == seqids.end())
+      throw runerror{"Sequence '" + string(seqid) +
+                     "' was not seen when the inputs were first read"};
+    return found->second;
+  }
+
+  static std::unique_ptr<std::istream> open(const string &file_name) {
+    std::unique_ptr<std::istream> stream{nullptr};
+    if (InflateStream::is_compressed(file_name))
+      stream = std::make_unique<InflateStream>(file_name);
+    else
+      stream = std::make_unique<std::ifstream>(file_name, std::ios::binary);
+    if (!*stream) throw runerror{"Cannot open file '" + file_name + "'"};
+    return stream;
+  }
+
+  // The seqid, start and end of a "##sequence-region" directive.
+  static optional<std::tuple<string_view, int64_t, int64_t>> parse_region(
+      string_view line) {
+    vector<string_view> words;
+    for (size_t first = line.find_first_not_of(" \t");
+         first != string_view::npos;) {
+      const auto last = line.find_first_of(" \t", first);
+      words.push_back(line.substr(first, last - first));
+      first = line.find_first_not_of(" \t", last);
+    }
+    if (words.size() != 4 || words[0] != "##sequence-region") return nullopt;
+    const auto start = GFFRecord::parse_int(words[2]);
+    const auto end = GFFRecord::parse_int(words[3]);
+    if (!start || !end) return nullopt;
+    return std::make_tuple(words[1], *start, *end);
+  }
+
+  // The sequences of `file_name` in the order it ranks them: as its
+  // ##sequence-region directives and records first name them.
+  static vector<string> scan_seqids(const string &file_name) {
+    const auto stream = open(file_name);
+    GFFViewReader reader{*stream};
+    vector<string> order;
+    std::unordered_set<string> seen;
+    string last;
+    while (const auto next = reader.getLine()) {
+      auto line = *next;
+      if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+      if (line.empty()) continue;
+      if (is_fasta_start(line)) break;
+
+      string_view seqid;
+      if (line[0] == '#') {
+        const auto region = parse_region(line);
+        if (!region) continue;
+        seqid = std::get<0>(*region);
+      } else {
+        seqid = line.substr(0, line.find('\t'));
+        if (seqid == last) continue;
+        last = seqid;
+      }
+      if (seen.emplace(seqid).second) order.emplace_back(seqid);
+    }
+    return order;
+  }
+
+  // Ranks the sequences of all inputs in a topological order of their
+  // orders, taking the first seen where several may come next.
+  void rankSeqids() {
+    vector<vector<string>> orders(inputs.size());
+    Parallel::parallel_for(inputs.size(), [&](size_t index) {
+      orders[index] = scan_seqids(inputs[index].name);
+    });
+
+    std::unordered_map<string, uint32_t> ids;
+    vector<string> names;
+    vector<vector<uint32_t>> following;
+    vector<uint32_t> preceding;
+    for (const auto &order : orders) {
+      for (size_t index = 0; index < order.size(); ++index) {
+        const auto next = static_cast<uint32_t>(names.size());
+        const auto [item, inserted] = ids.try_emplace(order[index], next);
+        if (inserted) {
+          names.push_back(order[index]);
+          following.emplace_back();
+          preceding.push_back(0);
+        }
+        if (index) {
+          following[ids.at(order[index - 1])].push_back(item->second);
+          ++preceding[item->second];
+        }
+      }
+    }
+
+    std::priority_queue<uint32_t, vector<uint32_t>, std::greater<uint32_t>>
+        ready;
+    for (uint32_t id = 0; id < names.size(); ++id)
+      if (!preceding[id]) ready.push(id);
+    seqids.clear();
+    while (!ready.empty()) {
+      const auto id = ready.top();
+      ready.pop();
+      seqids.emplace(names[id], static_cast<uint32_t>(seqids.size()));
+      for (const auto next : following[id])
+        if (!--preceding[next]) ready.push(next);
+    }
+    for (uint32_t id = 0; id < names.size(); ++id)
+      if (preceding[id])
+        throw runerror{"Inputs order sequence '" + names[id] +
+                       "' differently and cannot be merged"};
+    regions.assign(seqids.size(), {});
+  }
+
+  // Records a comment or directive; true when it is new and should be
+  // written.
+  bool addDirective(string_view line) {
+    if (const auto region = parse_region(line)) {
+      const auto [seqid, start, end] = *region;
+      auto &known = regions[rank(seqid)];
+      if (known.text.empty()) {
+        known = {string(line), start, end};
+        return true;
+      }
+      if (start < known.start || end > known.end) {
+        known.start = std::min(known.start, start);
+        known.end = std::max(known.end, end);
+        known.merged = true;
+      }
+      return false;
+    }
+    return directives.emplace(line).second;
+  }
+
+  // Reads the next record of `input` into its head, passing comments met on
+  // the way to `comment`; false at the end of the input or its FASTA.
+  template <class Comment>
+  bool advance(Input &input, Comment &&comment) {
+    while (const auto next = input.reader->getLine()) {
+      auto line = *next;
+      if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+      if (line.empty()) continue;
+      if (line[0] == '#' || line[0] == '>') {
+        if (line == "###") continue;
+        if (is_fasta_start(line)) {
+          input.fasta = true;
+          input.line = line;
+          return false;
+        }
+        comment(line);
+        continue;
+      }
+
+      if (!GFFRecord::split_fields(line, fields))
+        throw runerror{"Not a GFF record in '" + input.name + "': '" +
+                       string(line) + "'"};
+      input.line = line;
+      input.key = {rank(fields[0]),
+                   GFFRecord::parse_int(fields[3]).value_or(0),
+                   GFFRecord::parse_int(fields[4]).value_or(0), 0};
+      if (input.key < input.last)
+        throw runerror{"'" + input.name + "' is not sorted at '" +
+                       string(line) + "'"};
+      input.last = input.key;
+      return true;
+    }
+    return false;
+  }
+
+  // The record line with `tag` added to its attributes.
+  void putTagged(OutputBuffer &out, string_view line, const string &value) {
+    out.put(line);
+    const auto attributes = line.substr(line.rfind('\t') + 1);
+    if (attributes == ".")
+      out.getBuffer().pop_back();
+    else if (!attributes.empty())
+      out.put(';');
+    out.put(*tag);
+    out.put('=');
+    out.put(value);
+  }
+
+ public:
+  // Inputs compressed with gzip or BGZF are decompressed on their own
+  // threads.
+  explicit GFFMerger(const vector<string> &file_names) {
+    for (const auto &file_name : file_names) {
+      Input input{file_name};
+      input.stream = open(file_name);
+      input.reader = std::make_unique<GFFViewReader>(*input.stream);
+      inputs.push_back(std::move(input));
+    }
+  }
+
+  // Adds `key`=<input file name> to the attributes of every record.
+  void setTag(string key) { tag = std::move(key); }
+
+  void merge(std::ostream &output) {
+    OutputBuffer out{output};
+    const auto put_line = [&out](string_view line) {
+      out.put(line);
+      out.put('\n');
+      out.commit();
+    };
+
+    rankSeqids();
+
+    // Headers come first, so ##sequence-region ranges are merged before any
+    // is written. Their lines take the places of the first seen, in rank
+    // order.
+    vector<string> header;
+    vector<size_t> region_lines;
+    for (auto &input : inputs) {
+      while (const auto next = input.reader->getLine()) {
+        auto line = *next;
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+        if (line.empty() || line == "###") continue;
+        if (line[0] != '#' || is_fasta_start(line)) {
+          input.line = line;
+          break;
+        }
+        if (!addDirective(line)) continue;
+        if (parse_region(line)) region_lines.push_back(header.size());
+        header.emplace_back(line);
+      }
+    }
+    auto region_line = region_lines.begin();
+    for (const auto &known : regions) {
+      if (known.text.empty()) continue;
+      auto &line = header[*region_line++];
+      line = known.text;
+      if (known.merged)
+        line = "##sequence-region " +
+               string(std::get<0>(*parse_region(known.text))) + " " +
+               std::to_string(known.start) + " " + std::to_string(known.end);
+    }
+    for (const auto &line : header) put_line(line);
+
+    const auto comment = [&](string_view line) {
+      if (addDirective(line)) put_line(line);
+    };
+
+    // The first line after each header is already read.
+    vector<const SortKey *> heads;
+    vector<string> values;
+    for (auto &input : inputs) {
+      auto has_record = false;
+      if (!input.line.empty()) {
+        const auto line = input.line;
+        if (is_fasta_start(line)) {
+          input.fasta = true;
+        } else {
+          if (!GFFRecord::split_fields(line, fields))
+            throw runerror{"Not a GFF record in '" + input.name + "': '" +
+                           string(line) + "'"};
+          input.key = input.last = {
+              rank(fields[0]), GFFRecord::parse_int(fields[3]).value_or(0),
+              GFFRecord::parse_int(fields[4]).value_or(0), 0};
+          has_record = true;
+        }
+      }
+      heads.push_back(has_record ? &input.key : nullptr);
+      values.push_back(tag ? Percent::encoded(input.name) : string{});
+    }
+
+    LoserTree<SortKey> tree{heads};
+    while (!tree.empty()) {
+      const auto index = tree.top();
+      auto &input = inputs[index];
+      if (tag) {
+        putTagged(out, input.line, values[index]);
+        out.put('\n');
+        out.commit();
+      } else
+        put_line(input.line);
+      tree.replace(advance(input, comment) ? &input.key : nullptr);
+    }
+
+    bool fasta{false};
+    for (auto &input : inputs) {
+      if (!input.fasta) continue;
+      if (!fasta) put_line("##FASTA");
+      fasta = true;
+      if (input.line[0] == '>') put_line(input.line);
+      while (const auto line = input.reader->getLine()) put_line(*line);
+    }
+    out.flush();
+    output.flush();
+  }
+};
+
+}  // namespace HKL::GFF
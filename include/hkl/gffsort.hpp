@@ -0,0 +1,585 @@
+#pragma once
+
+#include <agizmo/args.hpp>
+#include <hkl/gff.hpp>
+#include <hkl/gffwriter.hpp>
+#include <hkl/parallel.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <unistd.h>
+
+using namespace AGizmo;
+
+namespace HKL {
+
+namespace GFF {
+
+using std::optional;
+using std::string;
+using std::string_view;
+using std::vector;
+
+// Tournament tree merging k sorted sources. Every internal node keeps the
+// loser of the match played there and tree[0] the overall winner, so taking
+// the smallest head and replacing it replays one leaf-to-root path: log2(k)
+// comparisons against stored losers, and none of the sibling comparisons a
+// binary heap makes on the way down.
+template <class T, class Less = std::less<T>>
+class LoserTree {
+ private:
+  vector<const T *> heads;
+  vector<size_t> tree;
+  Less less;
+
+  // Exhausted sources lose every match; equal heads go to the lower source.
+  bool beats(size_t first, size_t second) const {
+    if (!heads[second]) return true;
+    if (!heads[first]) return false;
+    if (less(*heads[first], *heads[second])) return true;
+    return !less(*heads[second], *heads[first]) && first < second;
+  }
+
+ public:
+  // `heads` holds the first item of each source, null for an empty one.
+  explicit LoserTree(vector<const T *> heads, Less less = Less{})
+      : heads{std::move(heads)}, tree(this->heads.size()), less{less} {
+    const auto size = this->heads.size();
+    if (!size) return;
+    // Leaf i sits at node size + i; winners of the subtrees are kept only
+    // while the tree is built.
+    vector<size_t> winners(2 * size);
+    for (size_t source = 0; source < size; ++source)
+      winners[size + source] = source;
+    for (auto node = size - 1; node > 0; --node) {
+      const auto left = winners[2 * node], right = winners[2 * node + 1];
+      const auto left_wins = beats(left, right);
+      winners[node] = left_wins ? left : right;
+      tree[node] = left_wins ? right : left;
+    }
+    tree[0] = size > 1 ? winners[1] : 0;
+  }
+
+  bool empty() const noexcept { return heads.empty() || !heads[tree[0]]; }
+
+  // Source whose head is the smallest.
+  size_t top() const noexcept { return tree[0]; }
+  const T &front() const noexcept { return *heads[tree[0]]; }
+
+  // Sets the next item of the top source, null once it is exhausted.
+  void replace(const T *next) {
+    auto winner = tree[0];
+    heads[winner] = next;
+    for (auto node = (winner + heads.size()) / 2; node > 0; node /= 2)
+      if (beats(tree[node], winner)) std::swap(tree[node], winner);
+    tree[0] = winner;
+  }
+};
+
+// Position of a record in sorted order. Sequences are ranked by their first
+// ##sequence-region directive, or by first appearance otherwise; `order` is
+// the input position, which keeps the sort stable and the keys unique.
+struct SortKey {
+  uint32_t seqid{0};
+  int64_t start{0}, end{0};
+  uint64_t order{0};
+
+  bool operator<(const SortKey &other) const noexcept {
+    if (seqid != other.seqid) return seqid < other.seqid;
+    if (start != other.start) return start < other.start;
+    if (end != other.end) return end < other.end;
+    return order < other.order;
+  }
+
+  bool sameCoordinates(const SortKey &other) const noexcept {
+    return seqid == other.seqid && start == other.start && end == other.end;
+  }
+};
+
+// Sorts GFF files larger than memory. Records are gathered into runs of at
+// most the memory budget, each run is sorted on a worker and spilled to a
+// temporary file of fixed-size keys and raw lines, and the runs are merged
+// with a LoserTree. Lines are copied as they are, never reformatted.
+//
+// Order is (seqid, start, end), and records with equal coordinates are
+// written parents first, by the ID and Parent attributes of the group, then
+// by type and input order. Comment lines and directives are written first in
+// input order, except "###" which sorting makes meaningless; an embedded
+// FASTA section is copied to the end.
+class GFFSorter {
+ public:
+  static constexpr size_t default_memory{size_t{1024} << 20};
+  static constexpr size_t default_fan_in{256};
+
+ private:
+  // Spilled run, removed when it goes out of scope.
+  class RunFile {
+   private:
+    string path{};
+
+   public:
+    explicit RunFile(const std::filesystem::path &directory) {
+      auto pattern = (directory / "gffsort-XXXXXX").string();
+      const auto fd = mkstemp(pattern.data());
+      if (fd == -1)
+        throw runerror{"Cannot create temporary file in " +
+                       directory.string()};
+      ::close(fd);
+      path = pattern;
+    }
+    RunFile(const RunFile &) = delete;
+    RunFile &operator=(const RunFile &) = delete;
+    ~RunFile() { std::remove(path.c_str()); }
+
+    const string &getPath() const noexcept { return path; }
+  };
+
+  using run_ptr = std::unique_ptr<RunFile>;
+
+  // Entries are the key, the line length and the line, in native byte order
+  // as runs never leave the machine.
+  static constexpr size_t entry_header{sizeof(uint32_t) + 2 * sizeof(int64_t) +
+                                       sizeof(uint64_t) + sizeof(uint32_t)};
+
+  template <class T>
+  static char *store(char *data, const T &value) noexcept {
+    std::memcpy(data, &value, sizeof(T));
+    return data + sizeof(T);
+  }
+  template <class T>
+  static const char *load(const char *data, T &value) noexcept {
+    std::memcpy(&value, data, sizeof(T));
+    return data + sizeof(T);
+  }
+
+  class RunWriter {
+   private:
+    DescriptorStream stream;
+    OutputBuffer out;
+
+   public:
+    explicit RunWriter(const RunFile &run)
+        : stream{run.getPath()}, out{stream} {}
+
+    void write(const SortKey &key, string_view line) {
+      char header[entry_header];
+      auto data = store(header, key.seqid);
+      data = store(data, key.start);
+      data = store(data, key.end);
+      data = store(data, key.order);
+      store(data, static_cast<uint32_t>(line.size()));
+      out.put(string_view(header, entry_header));
+      out.put(line);
+      out.commit();
+    }
+
+    void close() {
+      out.flush();
+      stream.flush();
+      if (!stream) throw runerror{"Cannot write temporary run"};
+    }
+  };
+
+  class RunReader {
+   private:
+    std::ifstream file;
+    SortKey key{};
+    string line{};
+
+   public:
+    explicit RunReader(const RunFile &run)
+        : file{run.getPath(), std::ios::binary} {
+      if (!file) throw runerror{"Cannot read temporary run"};
+    }
+
+    // Reads the next entry; false at the end of the run.
+    bool next() {
+      char header[entry_header];
+      file.read(header, entry_header);
+      if (file.gcount() == 0) return false;
+      if (file.gcount() != static_cast<std::streamsize>(entry_header))
+        throw runerror{"Truncated temporary run"};
+      uint32_t size{0};
+      auto data = load(header, key.seqid);
+      data = load(data, key.start);
+      data = load(data, key.end);
+      data = load(data, key.order);
+      load(data, size);
+      line.resize(size);
+      file.read(line.data(), size);
+      if (file.gcount() != static_cast<std::streamsize>(size))
+        throw runerror{"Truncated temporary run"};
+      return true;
+    }
+
+    const SortKey &getKey() const noexcept { return key; }
+    string_view getLine() const noexcept { return line; }
+  };
+
+  // Lines of one run in a single buffer, sorted through their keys.
+  struct Batch {
+    struct Item {
+      SortKey key;
+      size_t offset;
+      uint32_t size;
+    };
+
+    string text{};
+    vector<Item> items{};
+
+    size_t bytes() const noexcept {
+      return text.size() + items.size() * sizeof(Item);
+    }
+
+    void add(const SortKey &key, string_view line) {
+      items.push_back({key, text.size(), static_cast<uint32_t>(line.size())});
+      text.append(line);
+    }
+
+    void sort() {
+      std::sort(items.begin(), items.end(),
+                [](const Item &first, const Item &second) {
+                  return first.key < second.key;
+                });
+    }
+
+    string_view line(const Item &item) const noexcept {
+      return string_view(text).substr(item.offset, item.size);
+    }
+  };
+
+  // Receives the records in key order and writes each group with equal
+  // coordinates parents first.
+  class TieWriter {
+   private:
+    struct Tie {
+      SortKey key{};
+      string line{};
+      string_view type{}, id{};
+      vector<string_view> parents{};
+      size_t depth{0};
+    };
+
+    OutputBuffer &out;
+    vector<Tie> group{};
+    size_t used{0};
+    vector<size_t> order{};
+    std::unordered_map<string_view, size_t> ids{};
+
+    static void parse(Tie &tie) {
+      GFFRecord::fields_t fields;
+      GFFRecord::split_fields(tie.line, fields);
+      tie.type = fields[2];
+      tie.id = {};
+      tie.parents.clear();
+      tie.depth = 0;
+      string_view attributes{fields[8]};
+      while (!attributes.empty()) {
+        const auto sep = attributes.find(';');
+        const auto item = attributes.substr(0, sep);
+        if (item.rfind("ID=", 0) == 0 && tie.id.empty()) {
+          tie.id = item.substr(3);
+        } else if (item.rfind("Parent=", 0) == 0) {
+          auto parents = item.substr(7);
+          while (true) {
+            const auto comma = parents.find(',');
+            tie.parents.push_back(parents.substr(0, comma));
+            if (comma == string_view::npos) break;
+            parents.remove_prefix(comma + 1);
+          }
+        }
+        if (sep == string_view::npos) break;
+        attributes.remove_prefix(sep + 1);
+      }
+    }
+
+    void writeGroup() {
+      if (used == 1) {
+        out.put(group[0].line);
+        out.put('\n');
+        out.commit();
+        used = 0;
+        return;
+      }
+
+      ids.clear();
+      for (size_t index = 0; index < used; ++index) {
+        parse(group[index]);
+        if (!group[index].id.empty())
+          ids.try_emplace(group[index].id, index);
+      }
+      // Depth within the group; a pass per level, bounded for cycles.
+      bool changed{!ids.empty()};
+      for (size_t pass = 0; changed && pass < used; ++pass) {
+        changed = false;
+        for (size_t index = 0; index < used; ++index)
+          for (const auto parent : group[index].parents)
+            if (const auto found = ids.find(parent);
+                found != ids.end() && found->second != index &&
+                group[found->second].depth + 1 > group[index].depth) {
+              group[index].depth = group[found->second].depth + 1;
+              changed = true;
+            }
+      }
+
+      order.resize(used);
+      for (size_t index = 0; index < used; ++index) order[index] = index;
+      std::sort(order.begin(), order.end(), [this](size_t first,
+                                                   size_t second) {
+        const auto &one = group[first], &two = group[second];
+        if (one.depth != two.depth) return one.depth < two.depth;
+        if (one.type != two.type) return one.type < two.type;
+        return one.key.order < two.key.order;
+      });
+      for (const auto index : order) {
+        out.put(group[index].line);
+        out.put('\n');
+        out.commit();
+      }
+      used = 0;
+    }
+
+   public:
+    explicit TieWriter(OutputBuffer &out) : out{out} {}
+
+    void write(const SortKey &key, string_view line) {
+      if (used && !group[0].key.sameCoordinates(key)) writeGroup();
+      if (used == group.size()) group.emplace_back();
+      group[used].key = key;
+      group[used].line.assign(line);
+      ++used;
+    }
+
+    void finish() {
+      if (used) writeGroup();
+    }
+  };
+
+  size_t memory;
+  size_t threads;
+  size_t fan_in;
+  std::filesystem::path directory;
+  size_t runs{0};
+
+  static run_ptr spill(Batch batch, const std::filesystem::path &directory) {
+    batch.sort();
+    auto run = std::make_unique<RunFile>(directory);
+    RunWriter writer{*run};
+    for (const auto &item : batch.items)
+      writer.write(item.key, batch.line(item));
+    writer.close();
+    return run;
+  }
+
+  // Merges `runs` and passes every entry to sink(key, line) in key order.
+  template <class Sink>
+  static void merge(const vector<run_ptr> &runs, Sink &&sink) {
+    vector<std::unique_ptr<RunReader>> readers;
+    vector<const SortKey *> heads;
+    for (const auto &run : runs) {
+      readers.push_back(std::make_unique<RunReader>(*run));
+      heads.push_back(readers.back()->next() ? &readers.back()->getKey()
+                                             : nullptr);
+    }
+
+    LoserTree<SortKey> tree{heads};
+    while (!tree.empty()) {
+      auto &reader = *readers[tree.top()];
+      sink(reader.getKey(), reader.getLine());
+      tree.replace(reader.next() ? &reader.getKey() : nullptr);
+    }
+  }
+
+  // Merges groups of `fan_in` runs into single runs until at most `fan_in`
+  // are left, so the final merge never holds more files open.
+  vector<run_ptr> reduce(vector<run_ptr> runs) const {
+    while (runs.size() > fan_in) {
+      vector<run_ptr> merged;
+      for (size_t first = 0; first < runs.size(); first += fan_in) {
+        const auto last = std::min(first + fan_in, runs.size());
+        if (last - first == 1) {
+          merged.push_back(std::move(runs[first]));
+          continue;
+        }
+        vector<run_ptr> group;
+        for (auto index = first; index < last; ++index)
+          group.push_back(std::move(runs[index]));
+        auto run = std::make_unique<RunFile>(directory);
+        RunWriter writer{*run};
+        merge(group, [&writer](const SortKey &key, string_view line) {
+          writer.write(key, line);
+        });
+        writer.close();
+        merged.push_back(std::move(run));
+      }
+      runs = std::move(merged);
+    }
+    return runs;
+  }
+
+ public:
+  // `memory` bounds the bytes held by the runs being filled and sorted, 0
+  // for no limit; `threads` sorts that many runs at once, 0 for all cores.
+  explicit GFFSorter(size_t memory = default_memory, size_t threads = 0,
+                     std::filesystem::path directory =
+                         std::filesystem::temp_directory_path(),
+                     size_t fan_in = default_fan_in)
+      : memory{memory},
+        threads{Parallel::resolve_threads(threads)},
+        fan_in{std::max<size_t>(fan_in, 2)},
+        directory{std::move(directory)} {}
+
+  // Runs spilled by the last sort(), 0 when it fit in memory.
+  size_t getRuns() const noexcept { return runs; }
+
+  void sort(std::istream &input, std::ostream &output) {
+    GFFViewReader reader{input};
+    OutputBuffer out{output};
+    runs = 0;
+
+    // A run being filled and those being sorted share the budget.
+    const auto budget = memory ? std::max<size_t>(memory / (threads + 1), 1)
+                               : std::numeric_limits<size_t>::max();
+    std::unordered_map<string, uint32_t> seqids;
+    const auto rank = [&seqids](string_view seqid) {
+      return seqids.try_emplace(string(seqid), seqids.size()).first->second;
+    };
+
+    vector<string> comments;
+    std::unique_ptr<RunFile> fasta{nullptr};
+    vector<run_ptr> spilled;
+    std::deque<std::future<run_ptr>> sorting;
+    Batch batch;
+    uint64_t order{0};
+    GFFRecord::fields_t fields;
+
+    while (const auto line = reader.getLine()) {
+      auto text = *line;
+      if (!text.empty() && text.back() == '\r') text.remove_suffix(1);
+      if (text.empty()) continue;
+
+      if (text[0] == '#' || text[0] == '>') {
+        if (text == "###") continue;
+        if (is_fasta_start(text)) {
+          fasta = std::make_unique<RunFile>(directory);
+          std::ofstream copy{fasta->getPath(), std::ios::binary};
+          if (text[0] == '>') copy << "##FASTA\n";
+          copy << text << '\n';
+          while (const auto rest = reader.getLine()) copy << *rest << '\n';
+          if (!copy.flush())
+            throw runerror{"Cannot write temporary file " + fasta->getPath()};
+          break;
+        }
+        if (text.rfind("##sequence-region", 0) == 0) {
+          const auto first = text.find_first_not_of(" \t", 17);
+          if (first != string_view::npos)
+            rank(text.substr(first,
+                             text.find_first_of(" \t", first) - first));
+        }
+        comments.emplace_back(text);
+        continue;
+      }
+
+      if (!GFFRecord::split_fields(text, fields))
+        throw runerror{"Not a GFF record: '" + string(text) + "'"};
+      batch.add({rank(fields[0]),
+                 GFFRecord::parse_int(fields[3]).value_or(0),
+                 GFFRecord::parse_int(fields[4]).value_or(0), order++},
+                text);
+
+      if (batch.bytes() >= budget) {
+        if (sorting.size() == threads) {
+          spilled.push_back(sorting.front().get());
+          sorting.pop_front();
+        }
+        sorting.push_back(std::async(std::launch::async, spill,
+                                     std::move(batch), directory));
+        batch = Batch{};
+      }
+    }
+
+    for (const auto &comment : comments) {
+      out.put(comment);
+      out.put('\n');
+    }
+
+    TieWriter ties{out};
+    if (sorting.empty() && spilled.empty()) {
+      batch.sort();
+      for (const auto &item : batch.items)
+        ties.write(item.key, batch.line(item));
+    } else {
+      if (!batch.items.empty())
+        sorting.push_back(std::async(std::launch::async, spill,
+                                     std::move(batch), directory));
+      for (auto &run : sorting) spilled.push_back(run.get());
+      runs = spilled.size();
+      merge(reduce(std::move(spilled)),
+            [&ties](const SortKey &key, string_view line) {
+              ties.write(key, line);
+            });
+    }
+    ties.finish();
+
+    out.flush();
+    if (fasta) {
+      std::ifstream copy{fasta->getPath(), std::ios::binary};
+      output << copy.rdbuf();
+    }
+    output.flush();
+  }
+
+  // `output` may be `input`; it is replaced once the input is sorted.
+  void sort(const string &input, const string &output) {
+    std::ifstream stream{input, std::ios::binary};
+    if (!stream) throw runerror{"Cannot open file '" + input + "'"};
+    OutputFile writer{output, {input}};
+    sort(stream, writer.get());
+    writer.commit();
+  }
+};
+
+class SortParameters {
+ private:
+  vector<string> input{};
+  optional<string> output{};
+  size_t memory{GFFSorter::default_memory};
+  size_t threads{0};
+  optional<string> directory{};
+  bool merge{false};
+  optional<string> tag{};
+
+ public:
+  SortParameters() = default;
+  bool parse(int argc, char *argv[]);
+
+  auto getInput() const { return input; }
+  auto getOutput() const { return output; }
+  // Memory budget in bytes, 0 meaning unlimited.
+  auto getMemory() const { return memory; }
+  auto getThreads() const { return threads; }
+  auto getDirectory() const { return directory; }
+  // Inputs are already sorted and only merged.
+  auto isMerge() const { return merge; }
+  auto getTag() const { return tag; }
+};
+
+}  // namespace GFF
+
+}  // namespace HKL
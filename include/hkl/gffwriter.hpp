@@ -0,0 +1,626 @@
+#pragma once
+
+#include <algorithm>
+#include <charconv>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <streambuf>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <hkl/gff.hpp>
+#include <hkl/percent.hpp>
+
+namespace HKL::GFF {
+
+using std::string;
+using std::string_view;
+using std::vector;
+
+// Stream buffer over a file descriptor. Small writes are gathered in a 64 KiB
+// buffer; writes at least that large go straight to write(2), so an
+// OutputBuffer flushing through it costs one system call per block.
+// Destruction does no I/O: bytes not flushed by then are dropped.
+class DescriptorBuf : public std::streambuf {
+ private:
+  int descriptor{-1};
+  bool owned{false};
+  std::vector<char> buffer;
+  int error{0};
+
+  bool writeAll(const char *data, size_t size) {
+    while (size) {
+      const auto written = ::write(descriptor, data, size);
+      if (written < 0) {
+        if (errno == EINTR) continue;
+        error = errno;
+        return false;
+      }
+      data += written;
+      size -= static_cast<size_t>(written);
+    }
+    return true;
+  }
+
+  bool drain() {
+    const auto size = static_cast<size_t>(pptr() - pbase());
+    setp(buffer.data(), buffer.data() + buffer.size());
+    return writeAll(buffer.data(), size);
+  }
+
+ protected:
+  int_type overflow(int_type symbol) override {
+    if (!drain()) return traits_type::eof();
+    if (!traits_type::eq_int_type(symbol, traits_type::eof())) {
+      *pptr() = traits_type::to_char_type(symbol);
+      pbump(1);
+    }
+    return traits_type::not_eof(symbol);
+  }
+
+  std::streamsize xsputn(const char *data, std::streamsize size) override {
+    if (size >= epptr() - pptr()) {
+      if (!drain()) return 0;
+      if (size >= epptr() - pptr())
+        return writeAll(data, static_cast<size_t>(size)) ? size : 0;
+    }
+    std::copy(data, data + size, pptr());
+    pbump(static_cast<int>(size));
+    return size;
+  }
+
+  int sync() override { return drain() ? 0 : -1; }
+
+ public:
+  explicit DescriptorBuf(int descriptor, bool owned = false,
+                         size_t capacity = size_t{1} << 16)
+      : descriptor{descriptor}, owned{owned}, buffer(capacity) {
+    setp(buffer.data(), buffer.data() + buffer.size());
+  }
+  DescriptorBuf(const DescriptorBuf &) = delete;
+  DescriptorBuf &operator=(const DescriptorBuf &) = delete;
+  ~DescriptorBuf() override {
+    if (owned) ::close(descriptor);
+  }
+
+  int getDescriptor() const noexcept { return descriptor; }
+  // errno of the last failed write, 0 when none failed.
+  int getError() const noexcept { return error; }
+};
+
+// Output stream writing to a file descriptor through DescriptorBuf.
+class DescriptorStream : public std::ostream {
+ private:
+  DescriptorBuf buffer;
+
+  static int open(const string &file_name) {
+    const auto descriptor =
+        ::open(file_name.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (descriptor == -1)
+      throw runerror{"Cannot write file '" + file_name + "'"};
+    return descriptor;
+  }
+
+ public:
+  // Writes to `descriptor`, closing it on destruction when `owned`.
+  explicit DescriptorStream(int descriptor, bool owned = false)
+      : std::ostream{nullptr}, buffer{descriptor, owned} {
+    rdbuf(&buffer);
+  }
+  explicit DescriptorStream(const string &file_name)
+      : DescriptorStream(open(file_name), true) {}
+
+  // Writes out the buffer, throwing when this or any earlier write failed.
+  // Nothing is flushed on destruction, so output ends with this call.
+  void finish() {
+    flush();
+    if (*this) return;
+    const auto error = buffer.getError();
+    throw runerror{string{"Cannot write output"} +
+                   (error ? string{": "} + std::strerror(error) : string{})};
+  }
+};
+
+// Output file that may also be one of the inputs. Such an output is written
+// to a temporary file beside it, which commit() renames over it once the
+// inputs are read; any other output is written in place. An output that is
+// not committed is left untouched.
+class OutputFile {
+ private:
+  string file_name;
+  string temporary{};
+  DescriptorStream *descriptor_stream{nullptr};
+  std::unique_ptr<std::ostream> stream{};
+
+ public:
+  OutputFile(const string &file_name, const vector<string> &inputs)
+      : file_name{file_name} {
+    const auto same = std::any_of(
+        inputs.begin(), inputs.end(), [&file_name](const string &input) {
+          std::error_code error;
+          return std::filesystem::equivalent(input, file_name, error);
+        });
+    std::unique_ptr<DescriptorStream> opened{nullptr};
+    if (same) {
+      temporary = file_name + ".XXXXXX";
+      const auto descriptor = mkstemp(temporary.data());
+      if (descriptor == -1) {
+        temporary.clear();
+        throw runerror{"Cannot write file '" + file_name + "'"};
+      }
+      struct stat info {};
+      if (!stat(file_name.c_str(), &info)) fchmod(descriptor, info.st_mode);
+      opened = std::make_unique<DescriptorStream>(descriptor, true);
+    } else {
+      opened = std::make_unique<DescriptorStream>(file_name);
+    }
+    descriptor_stream = opened.get();
+    stream = std::move(opened);
+  }
+  OutputFile(const OutputFile &) = delete;
+  OutputFile &operator=(const OutputFile &) = delete;
+  ~OutputFile() {
+    stream.reset();
+    if (!temporary.empty()) std::remove(temporary.c_str());
+  }
+
+  std::ostream &get() { return *stream; }
+  // The stream for writers that take it by its owner; it stays owned here.
+  std::unique_ptr<std::ostream> &getWriter() { return stream; }
+
+  void commit() {
+    try {
+      descriptor_stream->finish();
+    } catch (const runerror &error) {
+      stream.reset();
+      throw runerror{string{error.what()} + " to '" + file_name + "'"};
+    }
+    stream.reset();
+    if (temporary.empty()) return;
+    if (std::rename(temporary.c_str(), file_name.c_str()))
+      throw runerror{"Cannot replace file '" + file_name + "'"};
+    temporary.clear();
+  }
+};
+
+// Collects formatted output in one large block and hands it to the stream in
+// a single write once `capacity` bytes are reached. Numbers are formatted with
+// to_chars, so nothing goes through the stream's locale and formatting state.
+class OutputBuffer {
+ private:
+  std::ostream &stream;
+  string buffer{};
+  size_t capacity{0};
+  Metrics *metrics{nullptr};
+
+ public:
+  static constexpr size_t default_capacity{size_t{1} << 20};
+
+  explicit OutputBuffer(std::ostream &stream,
+                        size_t capacity = default_capacity)
+      : stream{stream}, capacity{capacity} {
+    buffer.reserve(capacity + 4096);
+  }
+  OutputBuffer(const OutputBuffer &) = delete;
+  OutputBuffer &operator=(const OutputBuffer &) = delete;
+  ~OutputBuffer() { flush(); }
+
+  // Blocks handed to the stream are timed as Stage::Write.
+  void setMetrics(Metrics *metrics) noexcept { this->metrics = metrics; }
+
+  // Times the formatting of one record until the end of the enclosing block.
+  Metrics::Scope format() const { return {metrics, Metrics::Stage::Format}; }
+
+  void flush() {
+    if (buffer.empty()) return;
+    const Metrics::Scope scope{metrics, Metrics::Stage::Write};
+    stream.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    if (metrics) metrics->addWritten(buffer.size());
+    buffer.clear();
+  }
+
+  // Flushes when the block is full; call at record boundaries.
+  void commit() {
+    if (buffer.size() >= capacity) flush();
+  }
+
+  void put(char value) { buffer.push_back(value); }
+  void put(string_view value) { buffer.append(value); }
+
+  template <class Int>
+  void putInt(Int value) {
+    char digits[24];
+    const auto result = std::to_chars(digits, digits + sizeof(digits), value);
+    buffer.append(digits, result.ptr);
+  }
+
+  // Shortest representation that reads back to the same value.
+  void putDouble(double value) {
+    char digits[32];
+    const auto result = std::to_chars(digits, digits + sizeof(digits), value);
+    buffer.append(digits, result.ptr);
+  }
+
+  void putEncoded(string_view value) { Percent::encode_append(value, buffer); }
+  void putDecoded(string_view value) { Percent::decode_append(value, buffer); }
+
+  // For formatters that append to a string, such as GFFRecord::appendGFF().
+  string &getBuffer() noexcept { return buffer; }
+
+  size_t size() const noexcept { return buffer.size(); }
+};
+
+// Writes records and comments as GFF3 lines.
+class GFFWriter {
+ private:
+  OutputBuffer out;
+
+ public:
+  explicit GFFWriter(std::ostream &stream,
+                     size_t capacity = OutputBuffer::default_capacity)
+      : out{stream, capacity} {}
+
+  void setMetrics(Metrics *metrics) noexcept { out.setMetrics(metrics); }
+
+  void write(const GFFRecord &record) {
+    {
+      const auto scope = out.format();
+      record.appendGFF(out.getBuffer());
+      out.put('\n');
+    }
+    out.commit();
+  }
+
+  void write(const GFFComment &comment) {
+    out.put(comment.str());
+    out.put('\n');
+    out.commit();
+  }
+
+  void write(const gff_variant &item) {
+    std::visit([this](const auto &value) { write(value); }, item);
+  }
+
+  void flush() { out.flush(); }
+};
+
+// Writes records as a table: the eight fixed columns followed by one column
+// per key, the layout of GFFRecord::strFields() and strAttributes(). The
+// attributes of a record are found in one scan of its raw column.
+class TSVWriter {
+ private:
+  enum class State : char { Absent, Flag, Value };
+
+  OutputBuffer out;
+  const vector<string> keys;
+  const string missing, empty;
+  std::unordered_map<string_view, size_t> columns{};
+  vector<State> states{};
+  vector<string_view> values{};
+
+  void putAttributes(const GFFRecord &record) {
+    if (record.isMaterialized()) {
+      record.appendAttributes(out.getBuffer(), keys.begin(), keys.end(),
+                              missing, "\t", empty);
+      return;
+    }
+
+    std::fill(states.begin(), states.end(), State::Absent);
+    string_view attributes{record.getRawAttributes()};
+    while (!attributes.empty()) {
+      const auto sep = attributes.find(';');
+      const auto item = attributes.substr(0, sep);
+      const auto equal = item.find('=');
+      // The first occurrence of a key wins, as in GFFRecord::get().
+      if (const auto column = columns.find(item.substr(0, equal));
+          column != columns.end() && states[column->second] == State::Absent) {
+        if (equal == string_view::npos)
+          states[column->second] = State::Flag;
+        else {
+          states[column->second] = State::Value;
+          values[column->second] = item.substr(equal + 1);
+        }
+      }
+      if (sep == string_view::npos) break;
+      attributes.remove_prefix(sep + 1);
+    }
+
+    for (size_t column = 0; column < keys.size(); ++column) {
+      out.put('\t');
+      switch (states[column]) {
+        case State::Absent:
+          out.put(missing);
+          break;
+        case State::Flag:
+          out.put(empty);
+          break;
+        case State::Value:
+          // Lists are written as they are.
+          if (values[column].find(',') == string_view::npos)
+            out.putDecoded(values[column]);
+          else
+            out.put(values[column]);
+      }
+    }
+  }
+
+ public:
+  TSVWriter(std::ostream &stream, vector<string> keys,
+            string missing = ".", string empty = "true",
+            size_t capacity = OutputBuffer::default_capacity)
+      : out{stream, capacity},
+        keys{std::move(keys)},
+        missing{std::move(missing)},
+        empty{std::move(empty)},
+        states(this->keys.size()),
+        values(this->keys.size()) {
+    for (size_t column = 0; column < this->keys.size(); ++column)
+      columns.try_emplace(this->keys[column], column);
+  }
+
+  static constexpr string_view header{
+      "seqid\tsource\ttype\tstart\tend\tscore\tstrand\tphase"};
+
+  // `prefix` is put before the line, e.g. "file\t" for an extra column.
+  void writeHeader(string_view prefix = {}) {
+    out.put(prefix);
+    out.put(header);
+    out.put('\t');
+    for (size_t column = 0; column < keys.size(); ++column) {
+      if (column) out.put('\t');
+      out.put(keys[column]);
+    }
+    out.put('\n');
+    out.commit();
+  }
+
+  void setMetrics(Metrics *metrics) noexcept { out.setMetrics(metrics); }
+
+  void write(const GFFRecord &record, string_view prefix = {}) {
+    {
+      const auto scope = out.format();
+      out.put(prefix);
+      record.appendFields(out.getBuffer(), missing, "\t");
+      putAttributes(record);
+      out.put('\n');
+    }
+    out.commit();
+  }
+
+  void write(const GFFComment &comment) {
+    out.put(comment.str());
+    out.put('\n');
+    out.commit();
+  }
+
+  void flush() { out.flush(); }
+};
+
+// Writes records as newline-delimited JSON, one object per line:
+//   {"seqid":"1","source":null,"type":"gene","start":1,"end":9,"score":null,
+//    "strand":"+","phase":null,"attributes":{"ID":"g1","Alias":["a","b"]}}
+// Missing fields are null; start, end, score and phase are numbers. Attribute
+// values are percent-decoded, multiple values become arrays and keys without
+// a value become true.
+class NDJSONWriter {
+ private:
+  OutputBuffer out;
+  bool comments{false};
+  std::optional<string> file{};
+  // Reused for percent-decoded values and the keys of a record.
+  string decoded{};
+  vector<string_view> keys{};
+
+  static constexpr char hex[]{"0123456789abcdef"};
+
+  static bool needsEscape(char value) noexcept {
+    return static_cast<unsigned char>(value) < 0x20 || value == '"' ||
+           value == '\\';
+  }
+
+  void putString(string_view value) {
+    out.put('"');
+    size_t first{0};
+    for (size_t pos = 0; pos < value.size(); ++pos) {
+      const auto symbol = value[pos];
+      if (!needsEscape(symbol)) continue;
+
+      out.put(value.substr(first, pos - first));
+      first = pos + 1;
+      out.put('\\');
+      switch (symbol) {
+        case '"':
+        case '\\':
+          out.put(symbol);
+          break;
+        case '\n':
+          out.put('n');
+          break;
+        case '\t':
+          out.put('t');
+          break;
+        case '\r':
+          out.put('r');
+          break;
+        case '\b':
+          out.put('b');
+          break;
+        case '\f':
+          out.put('f');
+          break;
+        default:
+          out.put("u00");
+          out.put(hex[(symbol >> 4) & 0xF]);
+          out.put(hex[symbol & 0xF]);
+      }
+    }
+    out.put(value.substr(first));
+    out.put('"');
+  }
+
+  void putDecoded(string_view value) {
+    if (!Percent::needs_decoding(value)) {
+      putString(value);
+      return;
+    }
+    decoded.clear();
+    Percent::decode_append(value, decoded);
+    putString(decoded);
+  }
+
+  void putField(string_view name, const opt_str &value) {
+    out.put(name);
+    if (value)
+      putString(*value);
+    else
+      out.put("null");
+  }
+
+  void putValues(string_view value) {
+    if (value.find(',') == string_view::npos) {
+      putDecoded(value);
+      return;
+    }
+
+    out.put('[');
+    for (bool first = true;; first = false) {
+      if (!first) out.put(',');
+      const auto comma = value.find(',');
+      putDecoded(value.substr(0, comma));
+      if (comma == string_view::npos) break;
+      value.remove_prefix(comma + 1);
+    }
+    out.put(']');
+  }
+
+  // Attributes changed through a materialized record are taken from its map.
+  void putAttributes(const GFFRecord &record) {
+    if (!record.isMaterialized()) {
+      putAttributes(string_view{record.getRawAttributes()});
+      return;
+    }
+
+    out.put("\"attributes\":{");
+    for (auto key = record.keys_cbegin(); key != record.keys_cend(); ++key) {
+      if (key != record.keys_cbegin()) out.put(',');
+      putString(*key);
+      out.put(':');
+      // Single values are decoded when the map is built, lists are not.
+      if (const auto value = record.at(*key); !value)
+        out.put("true");
+      else if (!record.isList(*key))
+        putString(*value);
+      else
+        putValues(*value);
+    }
+    out.put('}');
+  }
+
+  // A repeated key is written once, with its first value, as
+  // GFFRecord::get() returns it.
+  void putAttributes(string_view attributes) {
+    out.put("\"attributes\":{");
+    keys.clear();
+    while (!attributes.empty()) {
+      const auto sep = attributes.find(';');
+      const auto item = attributes.substr(0, sep);
+      attributes.remove_prefix(sep == string_view::npos ? attributes.size()
+                                                        : sep + 1);
+      const auto eq = item.find('=');
+      const auto key = item.substr(0, eq);
+      if (key.empty() ||
+          std::find(keys.begin(), keys.end(), key) != keys.end())
+        continue;
+
+      if (!keys.empty()) out.put(',');
+      keys.push_back(key);
+      putString(key);
+      out.put(':');
+      if (eq == string_view::npos) {
+        out.put("true");
+        continue;
+      }
+
+      putValues(item.substr(eq + 1));
+    }
+    out.put('}');
+  }
+
+ public:
+  explicit NDJSONWriter(std::ostream &stream, bool comments = false,
+                        size_t capacity = OutputBuffer::default_capacity)
+      : out{stream, capacity}, comments{comments} {}
+
+  // Adds a leading "file" member to every record.
+  void setFile(const string &name) { file = name; }
+
+  void setMetrics(Metrics *metrics) noexcept { out.setMetrics(metrics); }
+
+  void write(const GFFRecord &record) {
+    {
+      const auto scope = out.format();
+      out.put('{');
+      if (file) {
+        out.put("\"file\":");
+        putString(*file);
+        out.put(',');
+      }
+      putField("\"seqid\":", record.getSeqID());
+      putField(",\"source\":", record.getSource());
+      putField(",\"type\":", record.getType());
+      out.put(",\"start\":");
+      out.putInt(record.getStart());
+      out.put(",\"end\":");
+      out.putInt(record.getEnd());
+      out.put(",\"score\":");
+      if (const auto score = record.getScore(); score && std::isfinite(*score))
+        out.putDouble(*score);
+      else
+        out.put("null");
+      out.put(",\"strand\":");
+      if (const auto strand = record.getStrand())
+        putString(string_view(&*strand, 1));
+      else
+        out.put("null");
+      out.put(",\"phase\":");
+      if (const auto phase = record.getPhase())
+        out.putInt(*phase);
+      else
+        out.put("null");
+      out.put(',');
+      putAttributes(record);
+      out.put("}\n");
+    }
+    out.commit();
+  }
+
+  // Comments are written as {"comment":"..."} when enabled.
+  void write(const GFFComment &comment) {
+    if (!comments) return;
+    out.put("{\"comment\":");
+    putString(comment.str());
+    out.put("}\n");
+    out.commit();
+  }
+
+  void write(const gff_variant &item) {
+    std::visit([this](const auto &value) { write(value); }, item);
+  }
+
+  void flush() { out.flush(); }
+};
+
+}  // namespace HKL::GFF
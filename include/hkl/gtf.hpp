@@ -0,0 +1,412 @@
+#pragma once
+
+#include <algorithm>
+#include <exception>
+#include <future>
+#include <iostream>
+#include <limits>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <hkl/gff.hpp>
+#include <hkl/gffgraph.hpp>
+#include <hkl/metrics.hpp>
+#include <hkl/parallel.hpp>
+#include <hkl/percent.hpp>
+
+namespace HKL::GFF {
+
+using std::string;
+using std::string_view;
+using std::vector;
+
+// Converts GFF3 to GTF in one pass. Consecutive records connected through ID
+// and Parent form a locus, and only the locus being read is held; a feature
+// naming a parent not seen yet stays in the locus it overlaps. Finished
+// loci are formatted in batches on worker threads and written in input order
+// by a writer thread, so at most `depth` batches are in flight.
+//
+// In a locus the root of a Parent chain is the gene and the next feature on
+// the chain the transcript. A root whose children have no children of their
+// own, as a transcript without a gene or a gene with its CDS, is both.
+// gene_id and transcript_id are the attributes of that name of these features
+// when they have one, their ID otherwise. A feature with several parents in
+// the locus, as an exon shared by transcripts, is written once per parent.
+// The remaining attributes follow as key "value"; pairs, one per value of a
+// list, without ID and Parent. Types and the eight columns are kept. "###"
+// ends a locus; of the comments only "#!" lines are written, before the next
+// locus, when enabled.
+class GTFConverter {
+ private:
+  struct Feature {
+    GFFRecord record;
+    string id{};
+    vector<string> parents{};
+  };
+
+  struct Locus {
+    vector<string> comments{};
+    vector<Feature> features{};
+  };
+
+  struct Task {
+    vector<Locus> loci;
+    std::promise<string> result;
+  };
+
+  static constexpr size_t none{std::numeric_limits<size_t>::max()};
+
+  size_t threads{0}, batch{default_batch}, depth{0};
+  bool comments{false};
+  Metrics *metrics{nullptr};
+
+  static Feature make_feature(GFFRecord record) {
+    Feature feature{std::move(record)};
+    if (const auto id = feature.record.get("ID"); id && *id)
+      feature.id = **id;
+    if (const auto parents = feature.record.get("Parent"); parents && *parents)
+      feature.parents = GFFFeatureGraph::split_parents(**parents);
+    return feature;
+  }
+
+  // Appends `value` in double quotes, with quotes and backslashes escaped
+  // and tabs and line breaks written as \t, \n and \r, so a value never
+  // splits a line or a column.
+  static void put_quoted(string &out, string_view value) {
+    out.push_back('"');
+    for (auto pos = value.find_first_of("\"\\\t\n\r");
+         pos != string_view::npos;
+         pos = value.find_first_of("\"\\\t\n\r")) {
+      out.append(value.substr(0, pos));
+      out.push_back('\\');
+      switch (value[pos]) {
+        case '\t':
+          out.push_back('t');
+          break;
+        case '\n':
+          out.push_back('n');
+          break;
+        case '\r':
+          out.push_back('r');
+          break;
+        default:
+          out.push_back(value[pos]);
+      }
+      value.remove_prefix(pos + 1);
+    }
+    out.append(value);
+    out.push_back('"');
+  }
+
+  static void put_attribute(string &out, string_view key, string_view value) {
+    if (out.back() != '\t') out.push_back(' ');
+    out.append(key);
+    out.push_back(' ');
+    put_quoted(out, value);
+    out.push_back(';');
+  }
+
+  // The attributes of column 9 other than those written first.
+  static void put_attributes(string &out, string_view attributes,
+                             string &decoded) {
+    while (!attributes.empty()) {
+      const auto sep = attributes.find(';');
+      const auto item = attributes.substr(0, sep);
+      attributes.remove_prefix(sep == string_view::npos ? attributes.size()
+                                                        : sep + 1);
+      const auto equal = item.find('=');
+      const auto key = item.substr(0, equal);
+      if (key.empty() || key == "ID" || key == "Parent" || key == "gene_id" ||
+          key == "transcript_id")
+        continue;
+      if (equal == string_view::npos) {
+        put_attribute(out, key, {});
+        continue;
+      }
+
+      auto values = item.substr(equal + 1);
+      while (true) {
+        const auto comma = values.find(',');
+        decoded.clear();
+        Percent::decode_append(values.substr(0, comma), decoded);
+        put_attribute(out, key, decoded);
+        if (comma == string_view::npos) break;
+        values.remove_prefix(comma + 1);
+      }
+    }
+  }
+
+  // The `key` attribute of `feature`, its ID without one, or the first
+  // parent it names when it has neither; resolved once into `resolved`.
+  static string_view identifier(const Feature &feature, const string &key,
+                                std::optional<string> &resolved) {
+    if (resolved) return *resolved;
+    if (const auto value = feature.record.get(key); value && *value)
+      resolved = **value;
+    else if (!feature.id.empty())
+      resolved = feature.id;
+    else if (!feature.parents.empty())
+      resolved = feature.parents.front();
+    else
+      resolved.emplace();
+    return *resolved;
+  }
+
+  // Buffers of format() kept across the loci of a batch.
+  struct Scratch {
+    std::unordered_map<string_view, size_t> ids{};
+    vector<size_t> parent{}, root{}, level{}, top{}, owners{}, written{};
+    vector<bool> deep{};
+    vector<std::optional<string>> genes{}, transcripts{};
+    string decoded{};
+  };
+
+  static void format(const Locus &locus, Scratch &scratch, string &out) {
+    for (const auto &comment : locus.comments) {
+      out.append(comment);
+      out.push_back('\n');
+    }
+
+    const auto &features = locus.features;
+    const auto size = features.size();
+    auto &[ids, parent, root, level, top, owners, written, deep, genes,
+           transcripts, decoded] = scratch;
+    ids.clear();
+    for (size_t index = 0; index < size; ++index)
+      if (!features[index].id.empty())
+        ids.try_emplace(features[index].id, index);
+
+    // The first parent found in the locus places a feature in the tree;
+    // chains are cut after `size` steps, so a cycle cannot loop.
+    parent.assign(size, none);
+    for (size_t index = 0; index < size; ++index)
+      for (const auto &id : features[index].parents)
+        if (const auto found = ids.find(id);
+            found != ids.end() && found->second != index) {
+          parent[index] = found->second;
+          break;
+        }
+    root.resize(size);
+    level.assign(size, 0);
+    top.resize(size);
+    deep.assign(size, false);
+    for (size_t index = 0; index < size; ++index) {
+      auto node = index, below = index;
+      while (parent[node] != none && level[index] < size) {
+        below = node;
+        node = parent[node];
+        ++level[index];
+      }
+      root[index] = node;
+      top[index] = below;
+      if (level[index] > 1) deep[node] = true;
+    }
+
+    genes.assign(size, std::nullopt);
+    transcripts.assign(size, std::nullopt);
+    for (size_t index = 0; index < size; ++index) {
+      const auto &feature = features[index];
+
+      // The first parent, then any other in the locus, placing the feature
+      // under its transcript as the first one does.
+      owners.assign(1, parent[index]);
+      for (const auto &id : feature.parents)
+        if (const auto found = ids.find(id);
+            found != ids.end() && found->second != index &&
+            std::find(owners.begin(), owners.end(), found->second) ==
+                owners.end())
+          owners.push_back(found->second);
+
+      written.clear();
+      for (const auto owner : owners) {
+        auto gene = root[index], transcript = none;
+        if (owner != parent[index]) {
+          gene = root[owner];
+          transcript = level[owner] ? top[owner] : deep[gene] ? index : gene;
+        } else if (level[index] > 1)
+          transcript = top[index];
+        else if (level[index] == 1)
+          transcript = deep[gene] ? index : gene;
+        else if (!deep[index])
+          transcript = index;
+        if (std::find(written.begin(), written.end(), transcript) !=
+            written.end())
+          continue;
+        written.push_back(transcript);
+
+        feature.record.appendFields(out, ".", "\t");
+        out.push_back('\t');
+        put_attribute(out, "gene_id",
+                      identifier(features[gene], "gene_id", genes[gene]));
+        if (transcript != none)
+          put_attribute(out, "transcript_id",
+                        identifier(features[transcript], "transcript_id",
+                                   transcripts[transcript]));
+        put_attributes(out, feature.record.getRawAttributes(), decoded);
+        out.push_back('\n');
+      }
+    }
+  }
+
+  string format(const vector<Locus> &loci) const {
+    const Metrics::Scope scope{metrics, Metrics::Stage::Format};
+    Scratch scratch;
+    string out;
+    for (const auto &locus : loci) format(locus, scratch, out);
+    return out;
+  }
+
+ public:
+  static constexpr size_t default_batch{size_t{1} << 12};
+
+  // `threads` is the number of formatting workers (0 means all hardware
+  // threads); `batch` the number of records formatted as one task, rounded
+  // up to whole loci; `depth` the number of batches in flight (0 means twice
+  // the workers).
+  explicit GTFConverter(size_t threads = 0, size_t batch = default_batch,
+                        size_t depth = 0)
+      : threads{threads}, batch{std::max<size_t>(batch, 1)}, depth{depth} {}
+
+  void setComments(bool comments) noexcept { this->comments = comments; }
+
+  // Times formatting and writing into `metrics`, or stops when null; the
+  // reader is timed through its own setMetrics().
+  void setMetrics(Metrics *metrics) noexcept { this->metrics = metrics; }
+
+  void convert(GFFReader &reader, std::ostream &output) const {
+    const auto workers = Parallel::resolve_threads(threads);
+    Parallel::BoundedQueue<Task> tasks{workers};
+    Parallel::BoundedQueue<std::future<string>> results{depth ? depth
+                                                              : 2 * workers};
+
+    vector<std::thread> pool;
+    for (size_t worker = 0; worker < workers; ++worker)
+      pool.emplace_back([&] {
+        while (auto task = tasks.pop()) {
+          try {
+            task->result.set_value(format(task->loci));
+          } catch (...) {
+            task->result.set_exception(std::current_exception());
+          }
+        }
+      });
+
+    std::exception_ptr write_error{nullptr};
+    std::thread writer{[&] {
+      try {
+        while (auto result = results.pop()) {
+          const auto text = result->get();
+          const Metrics::Scope scope{metrics, Metrics::Stage::Write};
+          if (!output.write(text.data(),
+                            static_cast<std::streamsize>(text.size())))
+            throw runerror{"Cannot write GTF output"};
+          if (metrics) metrics->addWritten(text.size());
+        }
+      } catch (...) {
+        write_error = std::current_exception();
+        results.close();
+        tasks.close();
+      }
+    }};
+
+    vector<Locus> loci;
+    size_t held{0};
+    const auto submit = [&]() {
+      Task task{std::move(loci), {}};
+      loci = {};
+      held = 0;
+      if (!results.push(task.result.get_future())) return false;
+      return tasks.push(std::move(task));
+    };
+
+    std::exception_ptr read_error{nullptr};
+    try {
+      Locus locus;
+      vector<string> pending_comments;
+      std::unordered_set<string> ids, pending;
+      // Span of the locus, which a feature naming a parent not seen yet
+      // joins when it overlaps.
+      StringPool::id_t seqid{StringPool::none};
+      int end{0};
+      // Queues the current locus and starts an empty one; false once the
+      // writer has stopped.
+      const auto finish = [&]() {
+        if (locus.features.empty() && locus.comments.empty()) return true;
+        held += locus.features.size();
+        loci.push_back(std::move(locus));
+        locus = {};
+        ids.clear();
+        pending.clear();
+        return held < batch || submit();
+      };
+
+      auto running = true;
+      while (running) {
+        auto item = reader();
+        if (!item) break;
+        if (const auto comment = std::get_if<GFFComment>(&*item)) {
+          if (comment->isEmpty())
+            running = finish();
+          else if (comments && comment->isMeta())
+            pending_comments.push_back(comment->str());
+          continue;
+        }
+
+        auto feature = make_feature(std::get<GFFRecord>(std::move(*item)));
+        const auto linked = [&](const string &id) {
+          return ids.count(id) || pending.count(id);
+        };
+        const auto &record = feature.record;
+        const auto joins =
+            (!feature.id.empty() && pending.count(feature.id)) ||
+            std::any_of(feature.parents.begin(), feature.parents.end(),
+                        linked) ||
+            (!feature.parents.empty() && !locus.features.empty() &&
+             record.getSeqIDIndex() == seqid && record.getStart() <= end);
+        if (!joins && !(running = finish())) break;
+        if (locus.features.empty()) locus.comments.swap(pending_comments);
+
+        if (!feature.id.empty()) {
+          pending.erase(feature.id);
+          ids.insert(feature.id);
+        }
+        for (const auto &id : feature.parents)
+          if (!ids.count(id)) pending.insert(id);
+        if (locus.features.empty() || record.getSeqIDIndex() != seqid) {
+          seqid = record.getSeqIDIndex();
+          end = record.getEnd();
+        } else
+          end = std::max(end, record.getEnd());
+        locus.features.push_back(std::move(feature));
+      }
+      if (running) {
+        if (locus.features.empty()) locus.comments.swap(pending_comments);
+        if (finish() && !loci.empty()) submit();
+      }
+    } catch (...) {
+      read_error = std::current_exception();
+    }
+
+    tasks.close();
+    results.close();
+    for (auto &thread : pool) thread.join();
+    writer.join();
+
+    if (read_error) std::rethrow_exception(read_error);
+    if (write_error) std::rethrow_exception(write_error);
+    output.flush();
+  }
+
+  void convert(const string &file_name, std::ostream &output) const {
+    GFFReader reader{file_name};
+    reader.setMetrics(metrics);
+    convert(reader, output);
+  }
+};
+
+}  // namespace HKL::GFF
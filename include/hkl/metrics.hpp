@@ -0,0 +1,256 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include <sys/resource.h>
+
+namespace HKL {
+
+// Counters and stage timers of one run, safe to update from several threads.
+// Readers and writers take a Metrics pointer that is null by default and only
+// read the clock when it is set, so a run without metrics pays one pointer
+// test per line.
+class Metrics {
+ public:
+  using clock = std::chrono::steady_clock;
+
+  enum class Stage : size_t { Read, Parse, Discover, Format, Write };
+  static constexpr size_t stages{5};
+  static constexpr std::array<const char *, stages> stage_names{
+      "read", "parse", "discover", "format", "write"};
+
+  // Bucket b counts parse latencies below 2^b nanoseconds; the last one also
+  // takes everything longer.
+  static constexpr size_t latency_buckets{32};
+
+  // Adds the time until destruction to `stage`; does nothing without metrics.
+  class Scope {
+   private:
+    Metrics *metrics;
+    Stage stage;
+    clock::time_point start;
+
+   public:
+    Scope(Metrics *metrics, Stage stage)
+        : metrics{metrics},
+          stage{stage},
+          start{metrics ? clock::now() : clock::time_point{}} {}
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+    ~Scope() {
+      if (metrics) metrics->add(stage, clock::now() - start);
+    }
+  };
+
+  // Allocations of the process, counted only by programs that replace the
+  // global operator new with one incrementing this, as GFFlatter does with
+  // --stats.
+  static std::atomic<uint64_t> &allocations() noexcept {
+    static std::atomic<uint64_t> count{0};
+    return count;
+  }
+
+  // Peak resident set size of the process in bytes.
+  static uint64_t peak_rss() noexcept {
+    rusage usage{};
+    if (getrusage(RUSAGE_SELF, &usage)) return 0;
+    return static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+  }
+
+ private:
+  struct Timer {
+    std::atomic<uint64_t> nanoseconds{0}, calls{0};
+  };
+
+  const clock::time_point started{clock::now()};
+  const uint64_t allocations_before{allocations().load()};
+  std::array<Timer, stages> timers{};
+  std::atomic<uint64_t> records{0}, bytes_read{0}, bytes_written{0};
+  std::array<std::atomic<uint64_t>, latency_buckets> latency{};
+
+  static uint64_t nanoseconds(clock::duration duration) noexcept {
+    const auto count =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+    return count > 0 ? static_cast<uint64_t>(count) : 0;
+  }
+
+  static size_t bucket(uint64_t nanoseconds) noexcept {
+    size_t bucket{0};
+    while (nanoseconds && bucket + 1 < latency_buckets) {
+      nanoseconds >>= 1;
+      ++bucket;
+    }
+    return bucket;
+  }
+
+ public:
+  Metrics() = default;
+  Metrics(const Metrics &) = delete;
+  Metrics &operator=(const Metrics &) = delete;
+
+  void add(Stage stage, clock::duration duration) noexcept {
+    auto &timer = timers[static_cast<size_t>(stage)];
+    timer.nanoseconds.fetch_add(nanoseconds(duration),
+                                std::memory_order_relaxed);
+    timer.calls.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  // One record parsed in `duration`, which also counts as parse time.
+  void addRecord(clock::duration duration) noexcept {
+    add(Stage::Parse, duration);
+    records.fetch_add(1, std::memory_order_relaxed);
+    latency[bucket(nanoseconds(duration))].fetch_add(
+        1, std::memory_order_relaxed);
+  }
+
+  void addRead(uint64_t bytes) noexcept {
+    bytes_read.fetch_add(bytes, std::memory_order_relaxed);
+  }
+  void addWritten(uint64_t bytes) noexcept {
+    bytes_written.fetch_add(bytes, std::memory_order_relaxed);
+  }
+
+  double getElapsed() const noexcept {
+    return std::chrono::duration<double>(clock::now() - started).count();
+  }
+  double getSeconds(Stage stage) const noexcept {
+    return static_cast<double>(
+               timers[static_cast<size_t>(stage)].nanoseconds.load()) /
+           1e9;
+  }
+  uint64_t getCalls(Stage stage) const noexcept {
+    return timers[static_cast<size_t>(stage)].calls.load();
+  }
+  uint64_t getRecords() const noexcept { return records.load(); }
+  uint64_t getBytesRead() const noexcept { return bytes_read.load(); }
+  uint64_t getBytesWritten() const noexcept { return bytes_written.load(); }
+  uint64_t getAllocations() const noexcept {
+    return allocations().load() - allocations_before;
+  }
+  uint64_t getLatencyCount(size_t bucket) const noexcept {
+    return latency[bucket].load();
+  }
+
+  // Upper bound in nanoseconds of the bucket holding the `quantile` of parse
+  // latencies, 0 before any record.
+  uint64_t getLatencyQuantile(double quantile) const noexcept {
+    std::array<uint64_t, latency_buckets> counts{};
+    uint64_t total{0};
+    for (size_t index = 0; index < latency_buckets; ++index)
+      total += counts[index] = latency[index].load();
+    if (!total) return 0;
+
+    const auto rank = static_cast<uint64_t>(quantile * total);
+    uint64_t seen{0};
+    for (size_t index = 0; index < latency_buckets; ++index) {
+      seen += counts[index];
+      if (seen > rank || seen == total) return uint64_t{1} << index;
+    }
+    return uint64_t{1} << (latency_buckets - 1);
+  }
+
+  // One JSON object on a single line, `event` telling a periodic report from
+  // the final summary:
+  //   {"event":"summary","elapsed":1.5,"records":1000,"bytes_read":...,
+  //    "stages":{"read":{"seconds":0.1,"calls":1000},...},
+  //    "parse_latency":{"p50":512,...,"histogram":[[512,990],[1024,10]]}}
+  // Latencies are in nanoseconds, each histogram pair giving the exclusive
+  // upper bound of a bucket and its count. Bytes read include every pass over
+  // the input, so a conversion reading a file twice reports it twice.
+  void writeJSON(std::ostream &stream, std::string_view event = "summary")
+      const {
+    const auto elapsed = getElapsed();
+    const auto rate = [elapsed](uint64_t count) {
+      return elapsed > 0 ? static_cast<double>(count) / elapsed : 0.0;
+    };
+
+    stream << "{\"event\":\"" << event << "\",\"elapsed\":" << elapsed
+           << ",\"records\":" << getRecords()
+           << ",\"bytes_read\":" << getBytesRead()
+           << ",\"bytes_written\":" << getBytesWritten()
+           << ",\"records_per_second\":" << rate(getRecords())
+           << ",\"bytes_per_second\":" << rate(getBytesRead())
+           << ",\"peak_rss\":" << peak_rss()
+           << ",\"allocations\":" << getAllocations() << ",\"stages\":{";
+    for (size_t index = 0; index < stages; ++index) {
+      const auto stage = static_cast<Stage>(index);
+      if (index) stream << ',';
+      stream << '"' << stage_names[index]
+             << "\":{\"seconds\":" << getSeconds(stage)
+             << ",\"calls\":" << getCalls(stage) << '}';
+    }
+    stream << "},\"parse_latency\":{\"p50\":" << getLatencyQuantile(0.5)
+           << ",\"p90\":" << getLatencyQuantile(0.9)
+           << ",\"p99\":" << getLatencyQuantile(0.99)
+           << ",\"histogram\":[";
+    bool first = true;
+    for (size_t index = 0; index < latency_buckets; ++index) {
+      if (const auto count = getLatencyCount(index)) {
+        if (!first) stream << ',';
+        first = false;
+        stream << '[' << (uint64_t{1} << index) << ',' << count << ']';
+      }
+    }
+    stream << "]}}";
+  }
+
+  // The JSON object of writeJSON() and a newline, to be written at once so
+  // reports from several threads do not interleave on unbuffered streams.
+  std::string toJSON(std::string_view event = "summary") const {
+    std::ostringstream line;
+    writeJSON(line, event);
+    line << '\n';
+    return line.str();
+  }
+};
+
+// Writes a "progress" report of `metrics` to `stream` every `interval` from
+// a background thread until stopped or destroyed.
+class MetricsReporter {
+ private:
+  const Metrics &metrics;
+  std::ostream &stream;
+  const std::chrono::milliseconds interval;
+  std::mutex mutex{};
+  std::condition_variable wake{};
+  bool stopping{false};
+  std::thread worker{};
+
+  void run() {
+    std::unique_lock lock{mutex};
+    while (!wake.wait_for(lock, interval, [this] { return stopping; })) {
+      stream << metrics.toJSON("progress") << std::flush;
+    }
+  }
+
+ public:
+  MetricsReporter(const Metrics &metrics, std::ostream &stream,
+                  std::chrono::milliseconds interval)
+      : metrics{metrics}, stream{stream}, interval{interval} {
+    worker = std::thread{&MetricsReporter::run, this};
+  }
+  MetricsReporter(const MetricsReporter &) = delete;
+  MetricsReporter &operator=(const MetricsReporter &) = delete;
+  ~MetricsReporter() { stop(); }
+
+  void stop() {
+    {
+      std::lock_guard lock{mutex};
+      stopping = true;
+    }
+    wake.notify_all();
+    if (worker.joinable()) worker.join();
+  }
+};
+
+}  // namespace HKL
@@ -0,0 +1,282 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <iostream>
+#include <queue>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "hkl/parallel.hpp"
+#include "hkl/region.hpp"
+#include "hkl/regionseq.hpp"
+
+namespace HKL::Motif {
+
+using std::array;
+using std::ostream;
+using std::string;
+using std::to_string;
+using std::vector;
+using runerror = std::runtime_error;
+
+struct MotifHit {
+  Region loc{};
+  size_t pattern{0};
+
+  string str() const { return loc.str() + "#" + to_string(pattern); }
+
+  friend ostream &operator<<(ostream &stream, const MotifHit &hit) {
+    return stream << hit.str();
+  }
+
+  friend bool operator==(const MotifHit &left, const MotifHit &right) {
+    return left.loc == right.loc && left.pattern == right.pattern;
+  }
+
+  friend bool operator!=(const MotifHit &left, const MotifHit &right) {
+    return !(left == right);
+  }
+
+  friend bool operator<(const MotifHit &left, const MotifHit &right) {
+    if (left.loc != right.loc) return left.loc < right.loc;
+    return left.pattern < right.pattern;
+  }
+};
+
+// Multi-pattern matcher based on an Aho-Corasick automaton over {A,C,G,T}.
+// IUPAC degenerate patterns are expanded into concrete words when they are
+// added, so the text is scanned exactly once regardless of the number of
+// patterns. Any text character outside ACGTU (N, gaps, ...) resets the
+// automaton. Matching is case-insensitive, so soft-masked sequence is
+// scanned as well.
+class MotifSearch {
+ private:
+  using node_t = uint32_t;
+
+  static constexpr node_t root{0};
+  static constexpr uint8_t invalid{4};
+
+  struct Entry {
+    uint32_t pattern;
+    uint32_t length;
+    char strand;
+  };
+
+  vector<string> patterns{};
+  vector<array<node_t, 4>> jumps{{}};
+  vector<node_t> links{0};
+  vector<node_t> out_links{0};
+  vector<vector<Entry>> entries{{}};
+  bool reverse{false};
+  size_t max_expansion{4096};
+  bool built{false};
+
+  static uint8_t encode(char base) noexcept {
+    switch (base) {
+      case 'A':
+      case 'a':
+        return 0;
+      case 'C':
+      case 'c':
+        return 1;
+      case 'G':
+      case 'g':
+        return 2;
+      case 'T':
+      case 't':
+      case 'U':
+      case 'u':
+        return 3;
+      default:
+        return invalid;
+    }
+  }
+
+  static const char *degenerate(char base) {
+    switch (toupper(static_cast<unsigned char>(base))) {
+      case 'A': return "A";
+      case 'C': return "C";
+      case 'G': return "G";
+      case 'T':
+      case 'U': return "T";
+      case 'R': return "AG";
+      case 'Y': return "CT";
+      case 'S': return "CG";
+      case 'W': return "AT";
+      case 'K': return "GT";
+      case 'M': return "AC";
+      case 'B': return "CGT";
+      case 'D': return "AGT";
+      case 'H': return "ACT";
+      case 'V': return "ACG";
+      case 'N': return "ACGT";
+      default:
+        throw runerror{"Unrecognized IUPAC symbol '" + string(1, base) + "'"};
+    }
+  }
+
+  vector<string> expand(const string &pattern) const {
+    size_t total{1};
+    for (auto base : pattern) {
+      total *= string(degenerate(base)).size();
+      if (total > max_expansion)
+        throw runerror{"Pattern '" + pattern + "' expands to more than " +
+                       to_string(max_expansion) + " words"};
+    }
+
+    vector<string> result{""};
+    result.reserve(total);
+    for (auto base : pattern) {
+      const string choices{degenerate(base)};
+      vector<string> next;
+      next.reserve(result.size() * choices.size());
+      for (const auto &prefix : result)
+        for (auto choice : choices) next.push_back(prefix + choice);
+      result = std::move(next);
+    }
+    return result;
+  }
+
+  void insert(const string &word, Entry entry) {
+    node_t node{root};
+    for (auto base : word) {
+      const auto code = encode(base);
+      if (!jumps[node][code]) {
+        jumps[node][code] = static_cast<node_t>(jumps.size());
+        jumps.push_back({});
+        entries.emplace_back();
+      }
+      node = jumps[node][code];
+    }
+    entries[node].push_back(entry);
+  }
+
+  string getChrom(const RegionSeq &seq) const {
+    const auto chrom = seq.getChrom();
+    return chrom.empty() ? seq.getName() : chrom;
+  }
+
+ public:
+  MotifSearch() = default;
+  // An empty pattern list leaves the search open for addPattern() calls
+  // followed by an explicit build().
+  MotifSearch(const vector<string> &patterns, bool reverse = false,
+              size_t max_expansion = 4096)
+      : reverse{reverse}, max_expansion{max_expansion} {
+    for (const auto &pattern : patterns) addPattern(pattern);
+    if (!patterns.empty()) build();
+  }
+
+  size_t addPattern(const string &pattern) {
+    if (built) throw runerror{"Patterns cannot be added after build()"};
+    if (pattern.empty()) throw runerror{"Empty motif pattern"};
+
+    const auto id = static_cast<uint32_t>(patterns.size());
+    const auto length = static_cast<uint32_t>(pattern.size());
+
+    for (const auto &word : expand(pattern)) {
+      insert(word, {id, length, '+'});
+      if (reverse)
+        insert(RegionSeq::reverseComplement(word), {id, length, '-'});
+    }
+
+    patterns.push_back(pattern);
+    return id;
+  }
+
+  // Resolves failure transitions into a complete DFA, so scanning performs a
+  // single table lookup per base.
+  void build() {
+    links.assign(jumps.size(), root);
+    out_links.assign(jumps.size(), root);
+
+    std::queue<node_t> queue;
+    for (auto child : jumps[root])
+      if (child) queue.push(child);
+
+    while (!queue.empty()) {
+      const auto node = queue.front();
+      queue.pop();
+
+      const auto link = links[node];
+      out_links[node] = entries[link].empty() ? out_links[link] : link;
+
+      for (uint8_t code = 0; code < 4; ++code) {
+        if (const auto child = jumps[node][code]) {
+          links[child] = jumps[link][code];
+          queue.push(child);
+        } else
+          jumps[node][code] = jumps[link][code];
+      }
+    }
+
+    built = true;
+  }
+
+  bool isBuilt() const noexcept { return built; }
+  bool hasReverse() const noexcept { return reverse; }
+  size_t size() const noexcept { return patterns.size(); }
+  size_t getNodes() const noexcept { return jumps.size(); }
+  const string &getPattern(size_t id) const { return patterns.at(id); }
+  const vector<string> &getPatterns() const noexcept { return patterns; }
+
+  template <class Output>
+  Output scan(const RegionSeq &seq, Output out) const {
+    if (!built) throw runerror{"MotifSearch::build() was not called"};
+    if (seq.isEmpty()) return out;
+
+    const auto &text = seq.getSeq();
+    const auto chrom = getChrom(seq);
+    const int offset = seq.getFirst();
+
+    node_t state{root};
+
+    for (size_t pos = 0; pos < text.size(); ++pos) {
+      const auto code = encode(text[pos]);
+      if (code == invalid) {
+        state = root;
+        continue;
+      }
+
+      state = jumps[state][code];
+
+      for (auto node = entries[state].empty() ? out_links[state] : state;
+           node != root; node = out_links[node]) {
+        const int last = offset + static_cast<int>(pos);
+        for (const auto &entry : entries[node]) {
+          const int first = last - static_cast<int>(entry.length) + 1;
+          *out++ = MotifHit{Region(chrom, first, last, entry.strand),
+                            entry.pattern};
+        }
+      }
+    }
+
+    return out;
+  }
+
+  vector<MotifHit> scan(const RegionSeq &seq) const {
+    vector<MotifHit> result;
+    scan(seq, back_inserter(result));
+    return result;
+  }
+
+  vector<MotifHit> scan(const RegionSeq &seq, const Region &loc) const {
+    if (const auto slice = seq.getSlice(loc))
+      return scan(*slice);
+    else
+      return {};
+  }
+
+  vector<vector<MotifHit>> scan(const vector<RegionSeq> &seqs,
+                                size_t threads = 0) const {
+    vector<vector<MotifHit>> result(seqs.size());
+    Parallel::parallel_for(
+        seqs.size(), [&](size_t index) { result[index] = scan(seqs[index]); },
+        threads);
+    return result;
+  }
+};
+
+}  // namespace HKL::Motif
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+namespace HKL::Parallel {
+
+using std::size_t;
+
+inline size_t resolve_threads(size_t threads) noexcept {
+  if (!threads) threads = std::thread::hardware_concurrency();
+  return std::max<size_t>(threads, 1);
+}
+
+// Calls func(index) for every index in [0, size) using up to `threads`
+// workers (0 means all hardware threads). Indices are handed out one by one,
+// so uneven items do not stall the pool. The first exception thrown by any
+// worker is rethrown on the calling thread after all workers have joined.
+template <class Func>
+void parallel_for(size_t size, Func func, size_t threads = 0) {
+  threads = std::min(resolve_threads(threads), size);
+
+  if (threads <= 1) {
+    for (size_t index = 0; index < size; ++index) func(index);
+    return;
+  }
+
+  std::atomic<size_t> next{0};
+  std::exception_ptr error{nullptr};
+  std::mutex error_mutex;
+
+  auto worker = [&]() {
+    try {
+      for (size_t index = next++; index < size; index = next++) func(index);
+    } catch (...) {
+      std::lock_guard<std::mutex> lock{error_mutex};
+      if (!error) error = std::current_exception();
+      next = size;
+    }
+  };
+
+  std::vector<std::thread> pool;
+  pool.reserve(threads - 1);
+  for (size_t i = 1; i < threads; ++i) pool.emplace_back(worker);
+  worker();
+  for (auto &thread : pool) thread.join();
+
+  if (error) std::rethrow_exception(error);
+}
+
+// Blocking FIFO with a fixed capacity, used to hand work between pipeline
+// stages while bounding the memory held in flight. After close() producers
+// are refused and consumers drain the remaining items.
+template <class T>
+class BoundedQueue {
+ private:
+  std::mutex mutex{};
+  std::condition_variable not_empty{}, not_full{};
+  std::deque<T> items{};
+  size_t capacity{1};
+  bool closed{false};
+
+ public:
+  explicit BoundedQueue(size_t capacity)
+      : capacity{std::max<size_t>(capacity, 1)} {}
+
+  // Blocks while the queue is full; returns false once it is closed.
+  bool push(T item) {
+    std::unique_lock<std::mutex> lock{mutex};
+    not_full.wait(lock, [this] { return closed || items.size() < capacity; });
+    if (closed) return false;
+    items.push_back(std::move(item));
+    not_empty.notify_one();
+    return true;
+  }
+
+  // Blocks while the queue is empty; returns nothing once it is closed and
+  // drained.
+  std::optional<T> pop() {
+    std::unique_lock<std::mutex> lock{mutex};
+    not_empty.wait(lock, [this] { return closed || !items.empty(); });
+    if (items.empty()) return std::nullopt;
+    auto item = std::move(items.front());
+    items.pop_front();
+    not_full.notify_one();
+    return item;
+  }
+
+  void close() {
+    std::lock_guard<std::mutex> lock{mutex};
+    closed = true;
+    not_empty.notify_all();
+    not_full.notify_all();
+  }
+};
+
+}  // namespace HKL::Parallel
@@ -0,0 +1,177 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// Percent-encoding of GFF3 columns. Every routine makes one pass over its
+// input and writes into a buffer owned by the caller; inputs without
+// anything to encode or decode are detected 16 bytes at a time.
+namespace HKL::Percent {
+
+using std::string;
+using std::string_view;
+
+// Characters GFF3 reserves in columns and attribute values.
+inline constexpr char reserved_chars[]{"\t\n\r%;=&,"};
+
+namespace detail {
+
+constexpr std::array<bool, 256> make_reserved() {
+  std::array<bool, 256> table{};
+  for (const char *symbol = reserved_chars; *symbol; ++symbol)
+    table[static_cast<unsigned char>(*symbol)] = true;
+  return table;
+}
+
+constexpr std::array<int8_t, 256> make_hex() {
+  std::array<int8_t, 256> table{};
+  for (auto &value : table) value = -1;
+  for (int digit = 0; digit < 10; ++digit) table['0' + digit] = digit;
+  for (int digit = 0; digit < 6; ++digit) {
+    table['a' + digit] = static_cast<int8_t>(10 + digit);
+    table['A' + digit] = static_cast<int8_t>(10 + digit);
+  }
+  return table;
+}
+
+inline constexpr auto reserved{make_reserved()};
+inline constexpr auto hex_value{make_hex()};
+inline constexpr char hex_digit[]{"0123456789ABCDEF"};
+
+}  // namespace detail
+
+inline bool is_reserved(char symbol) noexcept {
+  return detail::reserved[static_cast<unsigned char>(symbol)];
+}
+
+// Position of the first reserved character, or npos.
+inline size_t find_reserved(string_view input, size_t pos = 0) noexcept {
+  const auto data = input.data();
+  const auto size = input.size();
+#ifdef __SSE2__
+  const auto tab = _mm_set1_epi8('\t'), newline = _mm_set1_epi8('\n'),
+             carriage = _mm_set1_epi8('\r'), percent = _mm_set1_epi8('%'),
+             semicolon = _mm_set1_epi8(';'), equal = _mm_set1_epi8('='),
+             ampersand = _mm_set1_epi8('&'), comma = _mm_set1_epi8(',');
+  for (; pos + 16 <= size; pos += 16) {
+    const auto chunk =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + pos));
+    const auto hits = _mm_or_si128(
+        _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(chunk, tab),
+                         _mm_cmpeq_epi8(chunk, newline)),
+            _mm_or_si128(_mm_cmpeq_epi8(chunk, carriage),
+                         _mm_cmpeq_epi8(chunk, percent))),
+        _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, semicolon),
+                                  _mm_cmpeq_epi8(chunk, equal)),
+                     _mm_or_si128(_mm_cmpeq_epi8(chunk, ampersand),
+                                  _mm_cmpeq_epi8(chunk, comma))));
+    if (const auto mask = _mm_movemask_epi8(hits))
+      return pos + static_cast<size_t>(__builtin_ctz(mask));
+  }
+#endif
+  for (; pos < size; ++pos)
+    if (is_reserved(data[pos])) return pos;
+  return string_view::npos;
+}
+
+inline bool needs_encoding(string_view input) noexcept {
+  return find_reserved(input) != string_view::npos;
+}
+
+inline bool needs_decoding(string_view input) noexcept {
+  return !input.empty() &&
+         std::memchr(input.data(), '%', input.size()) != nullptr;
+}
+
+// Upper bound of the encoded size of `size` input bytes.
+inline constexpr size_t max_encoded_size(size_t size) noexcept {
+  return 3 * size;
+}
+
+// Writes `input` to `out` with reserved characters as %XX and returns the
+// number of bytes written, at most max_encoded_size(input.size()).
+inline size_t encode(string_view input, char *out) noexcept {
+  if (input.empty()) return 0;
+  const auto begin = out;
+  size_t first{0};
+  for (auto pos = find_reserved(input); pos != string_view::npos;
+       pos = find_reserved(input, first)) {
+    std::memcpy(out, input.data() + first, pos - first);
+    out += pos - first;
+    const auto symbol = static_cast<unsigned char>(input[pos]);
+    *out++ = '%';
+    *out++ = detail::hex_digit[symbol >> 4];
+    *out++ = detail::hex_digit[symbol & 0xF];
+    first = pos + 1;
+  }
+  std::memcpy(out, input.data() + first, input.size() - first);
+  return static_cast<size_t>(out - begin) + input.size() - first;
+}
+
+// Writes `input` to `out` with every %XX replaced by its byte and returns the
+// number of bytes written, at most input.size(). A '%' not followed by two
+// hex digits is copied as is. `out` may be input.data() for in-place use.
+inline size_t decode(string_view input, char *out) noexcept {
+  if (input.empty()) return 0;
+  const auto data = input.data();
+  const auto size = input.size();
+  size_t written{0}, first{0};
+  while (const auto found = static_cast<const char *>(
+             std::memchr(data + first, '%', size - first))) {
+    const auto pos = static_cast<size_t>(found - data);
+    std::memmove(out + written, data + first, pos - first);
+    written += pos - first;
+    if (pos + 2 < size) {
+      const auto high =
+          detail::hex_value[static_cast<unsigned char>(data[pos + 1])];
+      const auto low =
+          detail::hex_value[static_cast<unsigned char>(data[pos + 2])];
+      if ((high | low) >= 0) {
+        out[written++] = static_cast<char>(high << 4 | low);
+        first = pos + 3;
+        continue;
+      }
+    }
+    out[written++] = '%';
+    first = pos + 1;
+  }
+  std::memmove(out + written, data + first, size - first);
+  return written + size - first;
+}
+
+// Appends the encoded `input` to `out`.
+inline void encode_append(string_view input, string &out) {
+  const auto size = out.size();
+  out.resize(size + max_encoded_size(input.size()));
+  out.resize(size + encode(input, out.data() + size));
+}
+
+// Appends the decoded `input` to `out`.
+inline void decode_append(string_view input, string &out) {
+  const auto size = out.size();
+  out.resize(size + input.size());
+  out.resize(size + decode(input, out.data() + size));
+}
+
+inline string encoded(string_view input) {
+  string result;
+  if (!needs_encoding(input)) return string(input);
+  encode_append(input, result);
+  return result;
+}
+
+inline string decoded(string input) {
+  if (needs_decoding(input))
+    input.resize(decode(input, input.data()));
+  return input;
+}
+
+}  // namespace HKL::Percent
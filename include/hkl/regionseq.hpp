@@ -1,7 +1,11 @@
 #pragma once
 
+#include <array>
+#include <cstdint>
+#include <cstring>
 #include <fstream>
 #include <iostream>
+#include <memory>
 #include <numeric>
 #include <optional>
 #include <stdexcept>
@@ -211,13 +215,216 @@ class RegionSeq {
   double calcGCRatio() const {
     return countGC() / static_cast<double>(getLength());
   }
+
+  // Numeric code of a base: A=0, C=1, G=2, T/U=3, anything else (N, gaps,
+  // IUPAC ambiguity) 4. Case is ignored.
+  static uint8_t encodeBase(char base) noexcept {
+    static constexpr auto table = [] {
+      std::array<uint8_t, 256> result{};
+      for (auto &code : result) code = 4;
+      for (auto [base, code] : {pair<char, uint8_t>{'A', 0}, {'C', 1},
+                                {'G', 2}, {'T', 3}, {'U', 3}}) {
+        result[static_cast<uint8_t>(base)] = code;
+        result[static_cast<uint8_t>(base | 0x20)] = code;
+      }
+      return result;
+    }();
+    return table[static_cast<uint8_t>(base)];
+  }
+
+  // Writes encodeBase() of every base to `out`, which must have room for
+  // size() values.
+  template <class Output>
+  Output encode(Output out) const {
+    for (auto base : this->seq) *out++ = encodeBase(base);
+    return out;
+  }
+
+  vector<uint8_t> getCodes() const {
+    vector<uint8_t> result(this->seq.size());
+    encode(result.begin());
+    return result;
+  }
+
+  static char complement(char base) noexcept {
+    switch (base) {
+      case 'A': return 'T';
+      case 'C': return 'G';
+      case 'G': return 'C';
+      case 'T': return 'A';
+      case 'U': return 'A';
+      case 'R': return 'Y';
+      case 'Y': return 'R';
+      case 'K': return 'M';
+      case 'M': return 'K';
+      case 'B': return 'V';
+      case 'V': return 'B';
+      case 'D': return 'H';
+      case 'H': return 'D';
+      case 'a': return 't';
+      case 'c': return 'g';
+      case 'g': return 'c';
+      case 't': return 'a';
+      case 'u': return 'a';
+      case 'r': return 'y';
+      case 'y': return 'r';
+      case 'k': return 'm';
+      case 'm': return 'k';
+      case 'b': return 'v';
+      case 'v': return 'b';
+      case 'd': return 'h';
+      case 'h': return 'd';
+      default: return base;
+    }
+  }
+
+  static string reverseComplement(const string &seq) {
+    string result(seq.rbegin(), seq.rend());
+    for (auto &base : result) base = complement(base);
+    return result;
+  }
+};
+
+// Collects soft-masked (lowercase) and gap (N) runs of a sequence that is fed
+// in consecutive pieces, so runs spanning FASTA lines are reported once.
+// Bases are inspected eight at a time and whole words that do not change the
+// current state are skipped, which keeps long clean, masked or gap stretches
+// cheap. Besides the Region lists a run-length track of the state flags is
+// kept, covering every scanned base.
+class MaskScanner {
+ public:
+  static constexpr uint8_t Soft{1};
+  static constexpr uint8_t Gap{2};
+
+  using track_t = vector<pair<uint8_t, size_t>>;
+
+ private:
+  string chrom{};
+  int offset{1};
+  size_t pos{0};
+  uint8_t state{0};
+  size_t soft_first{0}, gap_first{0}, run_first{0};
+  vector<Region> soft{};
+  vector<Region> gaps{};
+  track_t track{};
+
+  static constexpr uint64_t broadcast(uint8_t byte) noexcept {
+    return 0x0101010101010101ULL * byte;
+  }
+
+  static constexpr bool hasByte(uint64_t word, uint8_t byte) noexcept {
+    const auto value = word ^ broadcast(byte);
+    return (value - broadcast(0x01)) & ~value & broadcast(0x80);
+  }
+
+  static uint8_t classify(char base) noexcept {
+    return ((base & 0x60) == 0x60 ? Soft : 0) |
+           ((base | 0x20) == 'n' ? Gap : 0);
+  }
+
+  bool skipWord(uint64_t word) const noexcept {
+    const auto lower = word | broadcast(0x20);
+    switch (state) {
+      case 0:
+        return !(word & broadcast(0x20)) && !hasByte(lower, 'n');
+      case Soft:
+        return (word & broadcast(0x60)) == broadcast(0x60) &&
+               !hasByte(lower, 'n');
+      case Gap:
+        return word == broadcast('N');
+      default:
+        return word == broadcast('n');
+    }
+  }
+
+  Region genRegion(size_t first, size_t last) const {
+    return Region(chrom, offset + static_cast<int>(first),
+                  offset + static_cast<int>(last) - 1);
+  }
+
+  void update(uint8_t flags) {
+    if (const auto changed = flags ^ state) {
+      if (changed & Soft) {
+        if (flags & Soft)
+          soft_first = pos;
+        else
+          soft.push_back(genRegion(soft_first, pos));
+      }
+      if (changed & Gap) {
+        if (flags & Gap)
+          gap_first = pos;
+        else
+          gaps.push_back(genRegion(gap_first, pos));
+      }
+      if (pos != run_first) track.emplace_back(state, pos - run_first);
+      run_first = pos;
+      state = flags;
+    }
+  }
+
+ public:
+  MaskScanner() = default;
+  MaskScanner(string chrom, int offset = 1)
+      : chrom{move(chrom)}, offset{offset} {}
+
+  void reset(string chrom = "", int offset = 1) {
+    *this = MaskScanner{move(chrom), offset};
+  }
+
+  void scan(const char *data, size_t size) {
+    size_t index{0};
+    while (index < size) {
+      if (size - index >= sizeof(uint64_t)) {
+        uint64_t word;
+        std::memcpy(&word, data + index, sizeof(word));
+        if (skipWord(word)) {
+          index += sizeof(word);
+          pos += sizeof(word);
+          continue;
+        }
+        for (const auto last = index + sizeof(word); index < last; ++index) {
+          update(classify(data[index]));
+          ++pos;
+        }
+      } else {
+        update(classify(data[index++]));
+        ++pos;
+      }
+    }
+  }
+
+  void scan(const string &seq) { scan(seq.data(), seq.size()); }
+
+  // Closes the runs still open at the end of the sequence.
+  void finish() {
+    update(0);
+    if (pos != run_first) track.emplace_back(state, pos - run_first);
+    run_first = pos;
+  }
+
+  static MaskScanner scanSeq(const RegionSeq &seq) {
+    const auto chrom = seq.getChrom();
+    MaskScanner result{chrom.empty() ? seq.getName() : chrom,
+                       seq.isEmpty() ? 1 : seq.getFirst()};
+    result.scan(seq.getSeq());
+    result.finish();
+    return result;
+  }
+
+  const string &getChrom() const noexcept { return chrom; }
+  size_t size() const noexcept { return pos; }
+  const vector<Region> &getSoftMasked() const noexcept { return soft; }
+  const vector<Region> &getGaps() const noexcept { return gaps; }
+  const track_t &getTrack() const noexcept { return track; }
 };
 
 class FASTAReader {
  private:
-  Files::FileReader reader;
+  std::unique_ptr<Files::FileReader> file{nullptr};
+  Files::FileReader *reader{nullptr};
   optional<RegionSeq> prev_seq;
   string next_name;
+  MaskScanner masks;
 
   static string prepareSeq(const string &seq, bool upper) noexcept {
     string output = seq;
@@ -230,52 +437,88 @@ class FASTAReader {
     return name.substr(1, name.size() - 1);
   }
 
-  void loadSeq(bool upper) {
-    if (!reader.good())
+  void loadSeq(bool upper, bool track_masks) {
+    if (!good())
       prev_seq = std::nullopt;
     else {
       string new_name;
       string seq;
 
-      while (const auto line = reader()) {
+      if (track_masks) masks.reset(getSeqID(next_name));
+
+      while (const auto line = (*reader)()) {
         if ((*line).empty()) continue;
 
         if ((*line)[0] == '>') {
           new_name = *line;
-          if (next_name.empty())
+          if (next_name.empty()) {
             std::swap(new_name, next_name);
-          else
+            if (track_masks) masks.reset(getSeqID(next_name));
+          } else
             break;
         } else {
           if (next_name.empty())
             throw runerror{"FASTA does not start with '>' sign"};
-          seq += prepareSeq(*line, upper);
+          if (track_masks) {
+            auto bases = prepareSeq(*line, false);
+            masks.scan(bases);
+            if (upper)
+              transform(bases.begin(), bases.end(), bases.begin(), toupper);
+            seq += bases;
+          } else
+            seq += prepareSeq(*line, upper);
         }
       }
+      if (track_masks) masks.finish();
       prev_seq = RegionSeq(next_name, seq);
       std::swap(new_name, next_name);
     }
   }
 
  public:
-  FASTAReader(string file_name) : reader(file_name) {}
+  // The sequence ID of a FASTA header: its first word, without '>'.
+  static string getSeqID(const string &name) {
+    const auto first = name.find_first_not_of('>');
+    if (first == string::npos) return "";
+    return name.substr(first, name.find_first_of(" \t", first) - first);
+  }
 
-  [[nodiscard]] auto good() const noexcept { return reader.good(); }
+  FASTAReader(string file_name)
+      : file{std::make_unique<Files::FileReader>(file_name)},
+        reader{file.get()} {}
+  // Continues on the lines of `reader`, which must outlive this one, as a
+  // GFFReader does with its ##FASTA section; `name` is a header line
+  // already taken from it.
+  FASTAReader(Files::FileReader &reader, string name = {})
+      : reader{&reader}, next_name{move(name)} {}
+  FASTAReader(const FASTAReader &) = delete;
+  FASTAReader &operator=(const FASTAReader &) = delete;
+
+  [[nodiscard]] bool good() const noexcept {
+    return reader && reader->good();
+  }
   void close() {
     prev_seq = std::nullopt;
-    reader.close();
+    next_name.clear();
+    if (file) file->close();
+    reader = nullptr;
   }
   void open(const string &file_name) {
     close();
-    reader.open(file_name);
+    file = std::make_unique<Files::FileReader>(file_name);
+    reader = file.get();
   }
 
   [[nodiscard]] auto getSeq() const noexcept { return prev_seq; }
-  [[nodiscard]] auto readSeq(bool upper = false) {
-    loadSeq(upper);
+  // Soft-masked and gap runs of the last sequence read with masks enabled.
+  [[nodiscard]] const MaskScanner &getMasks() const noexcept { return masks; }
+  [[nodiscard]] auto readSeq(bool upper = false, bool masks = false) {
+    loadSeq(upper, masks);
     return getSeq();
   }
-  [[nodiscard]] auto operator()(bool upper = false) { return readSeq(upper); }
+  [[nodiscard]] auto operator()(bool upper = false, bool masks = false) {
+    return readSeq(upper, masks);
+  }
 
   vector<RegionSeq> readFile(bool upper = false) {
     vector<RegionSeq> result;
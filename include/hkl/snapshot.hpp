@@ -0,0 +1,592 @@
+#pragma once
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <hkl/annotationstore.hpp>
+#include <hkl/columnar.hpp>
+#include <hkl/gff.hpp>
+#include <hkl/parallel.hpp>
+#include <hkl/region.hpp>
+
+namespace HKL::GFF {
+
+using std::optional;
+using std::string;
+using std::string_view;
+using std::vector;
+
+// Read-only AnnotationStore mapped from a binary image, so a process starts
+// answering queries without parsing its GFF. The image holds only offsets,
+// is mapped shared and read in place, and one copy in the page cache serves
+// every process mapping it.
+//
+// Layout, integers in native byte order (checked through a byte order mark)
+// and every section 8-byte aligned:
+//   header:   magic "HKLSNAP\0", u32 version, u32 byte order mark, u64 image
+//             length, u64 source size, i64 source mtime in nanoseconds, u32
+//             CRC-32 of the source, u32 CRC-32 of everything after the
+//             header, u64 records, then u64 offsets of the sections below
+//   tables:   type names, source names, seqids and the records as GFF3
+//             lines, each u64 count, u64 offsets[count + 1] and the bytes
+//   codes:    u32 type and u32 source per record, then u8 strand per record
+//   contigs:  u64 count, per seqid {u64 offset, u64 size, i64 root level} of
+//             its intervals, then the intervals as AnnotationStore lays
+//             them out: {i32 first, i32 last, i32 max, u32 record}
+// The source fields identify the GFF the image was built from; load()
+// rebuilds the image when they no longer match it.
+class AnnotationSnapshot {
+ public:
+  using Filter = AnnotationFilter;
+
+  // Identity of a source GFF: size and modification time, and the CRC-32 of
+  // its content when computed.
+  struct Source {
+    uint64_t size{0};
+    int64_t mtime{0};
+    uint32_t crc{0};
+
+    static Source of(const string &file_name, bool checksum = true) {
+      struct stat info {};
+      if (stat(file_name.c_str(), &info) == -1)
+        throw runerror{"Cannot open file '" + file_name + "'"};
+      Source source{static_cast<uint64_t>(info.st_size),
+                    int64_t{info.st_mtim.tv_sec} * 1000000000 +
+                        info.st_mtim.tv_nsec};
+      if (checksum) source.crc = crc_of(file_name);
+      return source;
+    }
+
+    static uint32_t crc_of(const string &file_name) {
+      std::ifstream file{file_name, std::ios::binary};
+      if (!file) throw runerror{"Cannot open file '" + file_name + "'"};
+      vector<char> block(size_t{1} << 20);
+      auto crc = crc32(0L, Z_NULL, 0);
+      while (file.read(block.data(), static_cast<std::streamsize>(
+                                         block.size())) ||
+             file.gcount())
+        crc = crc32(crc, reinterpret_cast<const Bytef *>(block.data()),
+                    static_cast<uInt>(file.gcount()));
+      return static_cast<uint32_t>(crc);
+    }
+  };
+
+  static constexpr char magic[8]{'H', 'K', 'L', 'S', 'N', 'A', 'P', '\0'};
+  static constexpr uint32_t version{1};
+  static constexpr uint32_t byte_order{0x01020304};
+
+ private:
+  using Interval = AnnotationStore::Interval;
+  using Codes = AnnotationStore::Codes;
+
+  enum Section : size_t {
+    TypeNames,
+    SourceNames,
+    SeqIDs,
+    Lines,
+    Types,
+    Sources,
+    Strands,
+    Contigs,
+    Sections
+  };
+
+  struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint64_t length;
+    uint64_t source_size;
+    int64_t source_mtime;
+    uint32_t source_crc;
+    uint32_t body_crc;
+    uint64_t records;
+    uint64_t sections[Sections];
+  };
+  static_assert(sizeof(Header) == 120 && std::is_trivially_copyable_v<Header>);
+  static_assert(sizeof(Interval) == 16 &&
+                std::is_trivially_copyable_v<Interval>);
+
+  struct ContigEntry {
+    uint64_t offset;
+    uint64_t size;
+    int64_t root_level;
+  };
+
+  struct Table {
+    uint64_t count{0};
+    const uint64_t *offsets{nullptr};
+    const char *bytes{nullptr};
+
+    string_view operator[](size_t index) const {
+      if (index >= count) throw std::out_of_range{"Unknown snapshot entry"};
+      return string_view(bytes + offsets[index],
+                         offsets[index + 1] - offsets[index]);
+    }
+  };
+
+  struct Contig {
+    const Interval *intervals{nullptr};
+    int64_t size{0};
+    int root_level{-1};
+  };
+
+  // Appends to an image, computing the CRC-32 of what it writes.
+  class Writer {
+   private:
+    std::ostream &stream;
+    uint64_t offset{0};
+    uLong crc{crc32(0L, Z_NULL, 0)};
+
+   public:
+    explicit Writer(std::ostream &stream) : stream{stream} {}
+
+    void put(const void *data, size_t size) {
+      stream.write(static_cast<const char *>(data),
+                   static_cast<std::streamsize>(size));
+      for (size_t done = 0; done < size;) {
+        const auto step = std::min<size_t>(size - done, size_t{1} << 30);
+        crc = crc32(crc, static_cast<const Bytef *>(data) + done,
+                    static_cast<uInt>(step));
+        done += step;
+      }
+      offset += size;
+    }
+
+    template <class T>
+    void put(T value) {
+      put(&value, sizeof(T));
+    }
+
+    void pad() {
+      static constexpr char zeros[8]{};
+      put(zeros, Columnar::padded(offset) - offset);
+    }
+
+    // Values are appended to `bytes` by `append(index, bytes)`.
+    template <class Append>
+    void putTable(size_t count, Append append) {
+      string bytes;
+      vector<uint64_t> offsets{0};
+      offsets.reserve(count + 1);
+      for (size_t index = 0; index < count; ++index) {
+        append(index, bytes);
+        offsets.push_back(bytes.size());
+      }
+      put(uint64_t{count});
+      put(offsets.data(), offsets.size() * sizeof(uint64_t));
+      put(bytes.data(), bytes.size());
+      pad();
+    }
+
+    uint64_t getOffset() const noexcept { return offset; }
+    uint32_t getCRC() const noexcept { return static_cast<uint32_t>(crc); }
+  };
+
+  const uint8_t *data{nullptr};
+  size_t length{0};
+  Header header{};
+  Table lines{};
+  const uint32_t *types{nullptr}, *sources{nullptr};
+  const char *strands{nullptr};
+  vector<string> type_names{}, source_names{};
+  std::unordered_map<string, Contig> contigs{};
+  // Interns the seqids, sources and types of the records handed out.
+  std::shared_ptr<StringPool> pool{std::make_shared<StringPool>()};
+
+  void check(uint64_t pos, uint64_t size) const {
+    if (pos > length || size > length - pos)
+      throw runerror{"Snapshot is truncated"};
+  }
+
+  Table table(Section section) const {
+    const auto pos = header.sections[section];
+    check(pos, sizeof(uint64_t));
+    Table result;
+    std::memcpy(&result.count, data + pos, sizeof(uint64_t));
+    if (result.count >= length / sizeof(uint64_t))
+      throw runerror{"Snapshot is truncated"};
+    check(pos + sizeof(uint64_t), (result.count + 1) * sizeof(uint64_t));
+    result.offsets = reinterpret_cast<const uint64_t *>(data + pos + 8);
+    result.bytes = reinterpret_cast<const char *>(result.offsets +
+                                                  result.count + 1);
+    check(static_cast<uint64_t>(result.bytes -
+                                reinterpret_cast<const char *>(data)),
+          result.offsets[result.count]);
+    return result;
+  }
+
+  // Checks the structure; the per-record arrays are not read, so opening
+  // touches only the header, the names and the contig list.
+  void parse(bool verify) {
+    if (length < sizeof(Header)) throw runerror{"Not a GFF snapshot"};
+    std::memcpy(&header, data, sizeof(Header));
+    if (std::memcmp(header.magic, magic, sizeof(magic)))
+      throw runerror{"Not a GFF snapshot"};
+    if (header.version != version)
+      throw runerror{"Unsupported snapshot version"};
+    if (header.byte_order != byte_order)
+      throw runerror{"Snapshot has a different byte order"};
+    if (header.length != length) throw runerror{"Snapshot is truncated"};
+    if (verify && checksum(data + sizeof(Header), length - sizeof(Header)) !=
+                      header.body_crc)
+      throw runerror{"Snapshot is corrupt"};
+
+    const auto records = header.records;
+    for (const auto section : {TypeNames, SourceNames}) {
+      const auto names = table(section);
+      auto &values = section == TypeNames ? type_names : source_names;
+      for (uint64_t index = 0; index < names.count; ++index)
+        values.emplace_back(names[index]);
+    }
+    lines = table(Lines);
+    if (lines.count != records)
+      throw runerror{"Snapshot record count does not match"};
+
+    check(header.sections[Types], records * sizeof(uint32_t));
+    check(header.sections[Sources], records * sizeof(uint32_t));
+    check(header.sections[Strands], records);
+    types = reinterpret_cast<const uint32_t *>(data + header.sections[Types]);
+    sources =
+        reinterpret_cast<const uint32_t *>(data + header.sections[Sources]);
+    strands = reinterpret_cast<const char *>(data + header.sections[Strands]);
+
+    const auto seqids = table(SeqIDs);
+    const auto pos = header.sections[Contigs];
+    check(pos, sizeof(uint64_t) + seqids.count * sizeof(ContigEntry));
+    uint64_t count;
+    std::memcpy(&count, data + pos, sizeof(uint64_t));
+    if (count != seqids.count)
+      throw runerror{"Snapshot contig count does not match"};
+    for (uint64_t index = 0; index < count; ++index) {
+      ContigEntry entry;
+      std::memcpy(&entry,
+                  data + pos + sizeof(uint64_t) + index * sizeof(ContigEntry),
+                  sizeof(ContigEntry));
+      if (entry.size > records) throw runerror{"Snapshot is corrupt"};
+      check(entry.offset, entry.size * sizeof(Interval));
+      contigs.try_emplace(
+          string(seqids[index]),
+          Contig{reinterpret_cast<const Interval *>(data + entry.offset),
+                 static_cast<int64_t>(entry.size),
+                 static_cast<int>(entry.root_level)});
+    }
+  }
+
+  static uint32_t checksum(const uint8_t *bytes, size_t size) {
+    auto crc = crc32(0L, Z_NULL, 0);
+    for (size_t done = 0; done < size;) {
+      const auto step = std::min<size_t>(size - done, size_t{1} << 30);
+      crc = crc32(crc, bytes + done, static_cast<uInt>(step));
+      done += step;
+    }
+    return static_cast<uint32_t>(crc);
+  }
+
+  static optional<Header> read_header(const string &image) {
+    std::ifstream file{image, std::ios::binary};
+    Header header{};
+    if (!file.read(reinterpret_cast<char *>(&header), sizeof(Header)))
+      return std::nullopt;
+    if (std::memcmp(header.magic, magic, sizeof(magic)) ||
+        header.version != version || header.byte_order != byte_order)
+      return std::nullopt;
+    return header;
+  }
+
+  template <class Output>
+  Output overlap(const Region &loc, Output out, const Codes &codes) const {
+    if (AnnotationStore::matches_nothing(codes)) return out;
+
+    const auto found = contigs.find(loc.getChrom());
+    if (found == contigs.end()) return out;
+
+    const auto &contig = found->second;
+    const int first{loc.getFirst()}, last{loc.getLast()};
+    const auto strand = loc.getStrand();
+
+    AnnotationStore::search(
+        contig.intervals, contig.size, contig.root_level, first, last,
+        [&](const Interval &interval) {
+          const auto record = interval.record;
+          if (first > interval.last) return;
+          if (record >= header.records) throw runerror{"Snapshot is corrupt"};
+          if (!AnnotationStore::accepts(types[record], sources[record],
+                                        codes))
+            return;
+          if (strand && strands[record] != strand) return;
+          *out++ = record;
+        });
+    return out;
+  }
+
+  Codes resolve(const Filter &filter) const {
+    return AnnotationStore::resolve(filter, type_names, source_names);
+  }
+
+ public:
+  AnnotationSnapshot() = delete;
+  AnnotationSnapshot(const AnnotationSnapshot &) = delete;
+  AnnotationSnapshot &operator=(const AnnotationSnapshot &) = delete;
+
+  // Maps `image`; with `verify` the whole image is read once to check its
+  // CRC-32, otherwise only its structure is checked.
+  explicit AnnotationSnapshot(const string &image, bool verify = false) {
+    const auto fd = open(image.c_str(), O_RDONLY);
+    if (fd == -1) throw runerror{"Cannot open file '" + image + "'"};
+
+    struct stat info {};
+    if (fstat(fd, &info) == -1 || info.st_size == 0) {
+      close(fd);
+      throw runerror{"Not a GFF snapshot"};
+    }
+    length = static_cast<size_t>(info.st_size);
+
+    auto mapped = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) throw runerror{"Cannot map file '" + image + "'"};
+    data = static_cast<const uint8_t *>(mapped);
+
+    try {
+      parse(verify);
+    } catch (...) {
+      munmap(const_cast<uint8_t *>(data), length);
+      throw;
+    }
+  }
+
+  ~AnnotationSnapshot() {
+    if (data) munmap(const_cast<uint8_t *>(data), length);
+  }
+
+  // Writes `store` as an image. The image is written next to `image` and
+  // renamed over it, so processes never map a partial file and those that
+  // mapped the old one keep it.
+  static void save(const AnnotationStore &store, const string &image,
+                   const Source &source) {
+    auto path = image + ".XXXXXX";
+    const auto fd = mkstemp(path.data());
+    if (fd == -1) throw runerror{"Cannot write file '" + image + "'"};
+    fchmod(fd, 0644);
+    close(fd);
+
+    try {
+      std::ofstream stream{path, std::ios::binary};
+      Header header{};
+      std::memcpy(header.magic, magic, sizeof(magic));
+      header.version = version;
+      header.byte_order = byte_order;
+      header.source_size = source.size;
+      header.source_mtime = source.mtime;
+      header.source_crc = source.crc;
+      header.records = store.size();
+      stream.write(reinterpret_cast<const char *>(&header), sizeof(Header));
+
+      // Offsets count from the start of the image, the CRC covers the body.
+      Writer out{stream};
+      const auto mark = [&](Section section) {
+        header.sections[section] = sizeof(Header) + out.getOffset();
+      };
+      const auto names = [](const vector<string> &values) {
+        return [&values](size_t index, string &bytes) {
+          bytes.append(values[index]);
+        };
+      };
+
+      vector<string> seqids;
+      for (const auto &[seqid, contig] : store.contigs) seqids.push_back(seqid);
+      std::sort(seqids.begin(), seqids.end());
+
+      mark(TypeNames);
+      out.putTable(store.type_names.size(), names(store.type_names));
+      mark(SourceNames);
+      out.putTable(store.source_names.size(), names(store.source_names));
+      mark(SeqIDs);
+      out.putTable(seqids.size(), names(seqids));
+      mark(Lines);
+      out.putTable(store.size(), [&store](size_t index, string &bytes) {
+        store.records[index].appendGFF(bytes);
+      });
+
+      mark(Types);
+      out.put(store.types.data(), store.types.size() * sizeof(uint32_t));
+      out.pad();
+      mark(Sources);
+      out.put(store.sources.data(), store.sources.size() * sizeof(uint32_t));
+      out.pad();
+      mark(Strands);
+      for (const auto &record : store.records)
+        out.put(record.getStrand().value_or(0));
+      out.pad();
+
+      mark(Contigs);
+      out.put(uint64_t{seqids.size()});
+      auto offset = header.sections[Contigs] + sizeof(uint64_t) +
+                    seqids.size() * sizeof(ContigEntry);
+      for (const auto &seqid : seqids) {
+        const auto &contig = store.contigs.at(seqid);
+        out.put(ContigEntry{offset, contig.intervals.size(),
+                            contig.root_level});
+        offset += contig.intervals.size() * sizeof(Interval);
+      }
+      for (const auto &seqid : seqids) {
+        const auto &intervals = store.contigs.at(seqid).intervals;
+        out.put(intervals.data(), intervals.size() * sizeof(Interval));
+      }
+
+      header.length = sizeof(Header) + out.getOffset();
+      header.body_crc = out.getCRC();
+      stream.seekp(0);
+      stream.write(reinterpret_cast<const char *>(&header), sizeof(Header));
+      stream.close();
+      if (!stream) throw runerror{"Cannot write file '" + image + "'"};
+      std::filesystem::rename(path, image);
+    } catch (...) {
+      std::remove(path.c_str());
+      throw;
+    }
+  }
+
+  static void save(const AnnotationStore &store, const string &image) {
+    save(store, image, Source{});
+  }
+
+  // The source recorded in `image`, nothing when it is not a snapshot of
+  // this version.
+  static optional<Source> read_source(const string &image) {
+    const auto header = read_header(image);
+    if (!header) return std::nullopt;
+    return Source{header->source_size, header->source_mtime,
+                  header->source_crc};
+  }
+
+  // True when `image` was built from `source` as it is now: same size,
+  // modification time and content. Without `checksum` the content is not
+  // read, so an edit that keeps the size and time goes unnoticed.
+  static bool is_fresh(const string &image, const string &source,
+                       bool checksum = true) {
+    const auto recorded = read_source(image);
+    if (!recorded) return false;
+    const auto current = Source::of(source, false);
+    if (recorded->size != current.size || recorded->mtime != current.mtime)
+      return false;
+    return !checksum || recorded->crc == Source::crc_of(source);
+  }
+
+  // Maps the snapshot of `source` kept in `image`, building it first when
+  // missing or stale. Staleness is checked as in is_fresh().
+  static std::unique_ptr<AnnotationSnapshot> load(const string &source,
+                                                  const string &image,
+                                                  bool checksum = true) {
+    if (!is_fresh(image, source, checksum)) {
+      // Taken before parsing, so a change made meanwhile shows as stale.
+      const auto identity = Source::of(source);
+      save(AnnotationStore{source}, image, identity);
+    }
+    return std::make_unique<AnnotationSnapshot>(image);
+  }
+
+  Source getSource() const noexcept {
+    return {header.source_size, header.source_mtime, header.source_crc};
+  }
+
+  size_t size() const noexcept { return header.records; }
+
+  // The record as a GFF3 line inside the mapping.
+  string_view getLine(size_t record) const {
+    const auto line = lines[record];
+    if (line.data() + line.size() > reinterpret_cast<const char *>(data) +
+                                         length)
+      throw runerror{"Snapshot is truncated"};
+    return line;
+  }
+
+  // Fields of the record read in place, valid while the snapshot is open.
+  GFFRecordView getView(size_t record) const {
+    return GFFRecordView{getLine(record)};
+  }
+
+  GFFRecord getRecord(size_t record) const {
+    return getView(record).toRecord(pool);
+  }
+
+  Region getRegion(size_t record) const {
+    const auto view = getView(record);
+    const auto strand = strands[record];
+    return Region(view.getSeqID().value_or("."), view.getStart().value_or(0),
+                  view.getEnd().value_or(0),
+                  strand == '+' || strand == '-' ? strand : 0);
+  }
+
+  vector<string> getSeqIDs() const {
+    vector<string> result;
+    for (const auto &[seqid, contig] : contigs) result.push_back(seqid);
+    std::sort(result.begin(), result.end());
+    return result;
+  }
+
+  // The queries of AnnotationStore, with the same results.
+  template <class Output>
+  Output overlap(const Region &loc, Output out,
+                 const Filter &filter = {}) const {
+    return overlap(loc, out, resolve(filter));
+  }
+
+  vector<size_t> query(const Region &loc, const Filter &filter = {}) const {
+    vector<size_t> result;
+    overlap(loc, std::back_inserter(result), filter);
+    std::sort(result.begin(), result.end());
+    return result;
+  }
+
+  vector<size_t> query(string loc, const Filter &filter = {}) const {
+    loc.erase(std::remove(loc.begin(), loc.end(), ','), loc.end());
+    return query(Region(loc), filter);
+  }
+
+  vector<vector<size_t>> query(const vector<Region> &locs,
+                               const Filter &filter = {},
+                               size_t threads = 0) const {
+    const auto codes = resolve(filter);
+    vector<vector<size_t>> result(locs.size());
+    Parallel::parallel_for(
+        locs.size(),
+        [&](size_t index) {
+          auto &hits = result[index];
+          overlap(locs[index], std::back_inserter(hits), codes);
+          std::sort(hits.begin(), hits.end());
+        },
+        threads);
+    return result;
+  }
+
+  vector<GFFRecord> getRecords(const vector<size_t> &indices) const {
+    vector<GFFRecord> result;
+    result.reserve(indices.size());
+    for (const auto index : indices) result.push_back(getRecord(index));
+    return result;
+  }
+};
+
+}  // namespace HKL::GFF
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+
+namespace HKL {
+
+// Interns strings into dense integer IDs. Each distinct value is stored once
+// and references returned by operator[] stay valid for the lifetime of the
+// pool. All methods are safe to call concurrently; reading a value by ID
+// takes no lock.
+class StringPool {
+ public:
+  using id_t = uint32_t;
+  static constexpr id_t none{std::numeric_limits<id_t>::max()};
+
+ private:
+  // Values are appended to chunks that never move. Chunk k holds
+  // first_chunk << k values, so every ID below none fits in a fixed table
+  // of chunks and is found with a few bit operations.
+  static constexpr size_t first_chunk{size_t{1} << 8};
+  static constexpr size_t max_chunks{25};
+
+  mutable std::shared_mutex mutex{};
+  std::array<std::atomic<std::string *>, max_chunks> chunks{};
+  std::atomic<size_t> count{0};
+  std::unordered_map<std::string_view, id_t> index{};
+
+  // The chunk holding `id` and the position in it.
+  static std::pair<size_t, size_t> locate(id_t id) noexcept {
+    const auto slot = static_cast<size_t>(id) / first_chunk + 1;
+    const auto chunk =
+        static_cast<size_t>(63 - __builtin_clzll(static_cast<uint64_t>(slot)));
+    return {chunk, id - first_chunk * ((size_t{1} << chunk) - 1)};
+  }
+
+  std::string &slot(id_t id) const noexcept {
+    const auto [chunk, offset] = locate(id);
+    return chunks[chunk].load(std::memory_order_acquire)[offset];
+  }
+
+ public:
+  StringPool() = default;
+  StringPool(const StringPool &) = delete;
+  StringPool &operator=(const StringPool &) = delete;
+  ~StringPool() {
+    for (auto &chunk : chunks) delete[] chunk.load();
+  }
+
+  id_t intern(std::string_view value) {
+    {
+      std::shared_lock<std::shared_mutex> lock{mutex};
+      if (const auto found = index.find(value); found != index.end())
+        return found->second;
+    }
+
+    std::unique_lock<std::shared_mutex> lock{mutex};
+    if (const auto found = index.find(value); found != index.end())
+      return found->second;
+
+    const auto size = count.load(std::memory_order_relaxed);
+    if (size >= none) throw std::length_error{"StringPool is full"};
+    const auto id = static_cast<id_t>(size);
+    const auto [chunk, offset] = locate(id);
+    if (!offset)
+      chunks[chunk].store(new std::string[first_chunk << chunk],
+                          std::memory_order_release);
+    auto &stored = slot(id);
+    stored = value;
+    index.emplace(stored, id);
+    count.store(size + 1, std::memory_order_release);
+    return id;
+  }
+
+  std::optional<id_t> find(std::string_view value) const {
+    std::shared_lock<std::shared_mutex> lock{mutex};
+    if (const auto found = index.find(value); found != index.end())
+      return found->second;
+    return std::nullopt;
+  }
+
+  // `id` must come from intern() or find() of this pool.
+  const std::string &operator[](id_t id) const noexcept { return slot(id); }
+
+  const std::string &at(id_t id) const {
+    if (id >= size()) throw std::out_of_range{"Unknown StringPool ID"};
+    return slot(id);
+  }
+
+  size_t size() const noexcept {
+    return count.load(std::memory_order_acquire);
+  }
+};
+
+}  // namespace HKL
@@ -0,0 +1,618 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <hkl/bgzf.hpp>
+#include <hkl/gff.hpp>
+#include <hkl/region.hpp>
+
+namespace HKL::Tabix {
+
+using std::string;
+using std::string_view;
+using std::vector;
+using runerror = std::runtime_error;
+using BGZF::voffset_t;
+
+// Range of virtual offsets [first, last) holding records of one bin.
+struct Chunk {
+  voffset_t first{0};
+  voffset_t last{0};
+};
+
+// Bin of the smallest node of the binning scheme that contains the 0-based
+// half-open interval [first, last), as in htslib's hts_reg2bin().
+inline uint32_t reg2bin(int64_t first, int64_t last, int min_shift, int depth) {
+  int shift{min_shift};
+  int64_t offset{((int64_t{1} << (3 * depth + 3)) - 1) / 7};
+  --last;
+  for (int level = depth; level > 0; --level) {
+    offset -= int64_t{1} << (3 * level);
+    if (first >> shift == last >> shift)
+      return static_cast<uint32_t>(offset + (first >> shift));
+    shift += 3;
+  }
+  return 0;
+}
+
+// Every bin that may hold records overlapping [first, last).
+inline vector<uint32_t> reg2bins(int64_t first, int64_t last, int min_shift,
+                                 int depth) {
+  vector<uint32_t> result;
+  if (first >= last) return result;
+  const auto limit = int64_t{1} << (min_shift + 3 * depth);
+  first = std::max<int64_t>(first, 0);
+  last = std::min(last, limit) - 1;
+  int64_t offset{0};
+  for (int level = 0, shift = min_shift + 3 * depth; level <= depth;
+       ++level, shift -= 3) {
+    for (auto bin = offset + (first >> shift); bin <= offset + (last >> shift);
+         ++bin)
+      result.push_back(static_cast<uint32_t>(bin));
+    offset += int64_t{1} << (3 * level);
+  }
+  return result;
+}
+
+// Binning and linear index over a coordinate-sorted BGZF file, readable and
+// writable as tabix .tbi (14-bit windows, 6 levels, coordinates below 2^29)
+// or as .csi, which takes any window size and depth. Records are addressed by
+// the 0-based half-open intervals tabix uses internally.
+class Index {
+ public:
+  // Columns of the tabix header; the defaults are the GFF preset.
+  struct Columns {
+    int32_t format{0};
+    int32_t seqid{1};
+    int32_t first{4};
+    int32_t last{5};
+    int32_t meta{'#'};
+    int32_t skip{0};
+  };
+
+  static constexpr int tbi_min_shift{14};
+  static constexpr int tbi_depth{5};
+
+ private:
+  struct Reference {
+    std::map<uint32_t, vector<Chunk>> bins{};
+    // Per bin of a .csi, the smallest offset of records overlapping its
+    // first window.
+    std::map<uint32_t, voffset_t> loffsets{};
+    // Smallest offset of records overlapping each window.
+    vector<voffset_t> linear{};
+    Chunk span{voffset_t(-1), 0};
+    uint64_t records{0};
+  };
+
+  int min_shift{tbi_min_shift};
+  int depth{tbi_depth};
+  Columns columns{};
+  vector<string> names{};
+  std::unordered_map<string, size_t> ids{};
+  vector<Reference> references{};
+  uint64_t no_coordinate{0};
+
+  // State while adding records.
+  std::optional<size_t> current{};
+  int64_t last_first{-1};
+  uint32_t last_bin{UINT32_MAX};
+
+  static constexpr voffset_t unset{voffset_t(-1)};
+
+  uint32_t metaBin() const {
+    return static_cast<uint32_t>(((int64_t{1} << (3 * depth + 3)) - 1) / 7 + 1);
+  }
+
+  // First window covered by `bin`.
+  int64_t binFirstWindow(uint32_t bin) const {
+    int64_t offset{0};
+    int level{0};
+    while (level < depth && bin >= offset + (int64_t{1} << (3 * level))) {
+      offset += int64_t{1} << (3 * level);
+      ++level;
+    }
+    return (bin - offset) << (3 * (depth - level));
+  }
+
+  static void put32(string &out, uint32_t value) {
+    for (int byte = 0; byte < 4; ++byte)
+      out.push_back(static_cast<char>(value >> (8 * byte)));
+  }
+  static void put64(string &out, uint64_t value) {
+    for (int byte = 0; byte < 8; ++byte)
+      out.push_back(static_cast<char>(value >> (8 * byte)));
+  }
+
+  static void read(BGZF::Reader &reader, void *data, size_t size) {
+    if (reader.read(static_cast<char *>(data), size) != size)
+      throw runerror{"Truncated index file"};
+  }
+  static uint32_t get32(BGZF::Reader &reader) {
+    unsigned char data[4];
+    read(reader, data, 4);
+    return BGZF::read_u32(data);
+  }
+  static uint64_t get64(BGZF::Reader &reader) {
+    unsigned char data[8];
+    read(reader, data, 8);
+    return static_cast<uint64_t>(BGZF::read_u32(data)) |
+           static_cast<uint64_t>(BGZF::read_u32(data + 4)) << 32;
+  }
+
+  void putHeader(string &out) const {
+    put32(out, static_cast<uint32_t>(columns.format));
+    put32(out, static_cast<uint32_t>(columns.seqid));
+    put32(out, static_cast<uint32_t>(columns.first));
+    put32(out, static_cast<uint32_t>(columns.last));
+    put32(out, static_cast<uint32_t>(columns.meta));
+    put32(out, static_cast<uint32_t>(columns.skip));
+    size_t size{0};
+    for (const auto &name : names) size += name.size() + 1;
+    put32(out, static_cast<uint32_t>(size));
+    for (const auto &name : names) out.append(name.c_str(), name.size() + 1);
+  }
+
+  void getHeader(BGZF::Reader &reader) {
+    columns.format = static_cast<int32_t>(get32(reader));
+    columns.seqid = static_cast<int32_t>(get32(reader));
+    columns.first = static_cast<int32_t>(get32(reader));
+    columns.last = static_cast<int32_t>(get32(reader));
+    columns.meta = static_cast<int32_t>(get32(reader));
+    columns.skip = static_cast<int32_t>(get32(reader));
+    string data(get32(reader), '\0');
+    read(reader, data.data(), data.size());
+    for (size_t first = 0; first < data.size();) {
+      const auto last = data.find('\0', first);
+      names.push_back(data.substr(first, last - first));
+      if (last == string::npos) break;
+      first = last + 1;
+    }
+  }
+
+  // Merges consecutive chunks of a bin that meet inside one BGZF block.
+  static void compact(vector<Chunk> &chunks) {
+    size_t kept{0};
+    for (size_t index = 1; index < chunks.size(); ++index) {
+      if (BGZF::block_address(chunks[kept].last) ==
+          BGZF::block_address(chunks[index].first))
+        chunks[kept].last = std::max(chunks[kept].last, chunks[index].last);
+      else
+        chunks[++kept] = chunks[index];
+    }
+    if (!chunks.empty()) chunks.resize(kept + 1);
+  }
+
+ public:
+  // Binning with 2^min_shift bases per window and `depth` levels above it;
+  // only 14 and 5 can be saved as .tbi.
+  explicit Index(int min_shift = tbi_min_shift, int depth = tbi_depth)
+      : min_shift{min_shift}, depth{depth} {
+    if (min_shift < 0 || depth < 0 || min_shift + 3 * depth > 63)
+      throw runerror{"Invalid binning of index"};
+  }
+
+  static Index tbi() { return Index(tbi_min_shift, tbi_depth); }
+
+  // Index covering every coordinate of an int with windows of 2^min_shift.
+  static Index csi(int min_shift = tbi_min_shift) {
+    int depth{0};
+    while (min_shift + 3 * depth < 32) ++depth;
+    return Index(min_shift, depth);
+  }
+
+  int getMinShift() const noexcept { return min_shift; }
+  int getDepth() const noexcept { return depth; }
+  const Columns &getColumns() const noexcept { return columns; }
+  const vector<string> &getNames() const noexcept { return names; }
+  bool isTabixCompatible() const noexcept {
+    return min_shift == tbi_min_shift && depth == tbi_depth;
+  }
+  // Largest coordinate the binning can address.
+  int64_t getLimit() const noexcept {
+    return int64_t{1} << (min_shift + 3 * depth);
+  }
+
+  // Adds the record at [offset, end) of the BGZF file spanning the 0-based
+  // half-open interval [first, last) of `seqid`. Records must come in file
+  // order, sorted by seqid blocks and then start.
+  void add(const string &seqid, int64_t first, int64_t last, voffset_t offset,
+           voffset_t end) {
+    if (last <= first) last = first + 1;
+    if (first < 0 || last > getLimit())
+      throw runerror{"Coordinate " + std::to_string(last) + " of " + seqid +
+                     " exceeds the range of the index; use a .csi index"};
+
+    if (!current || names[*current] != seqid) {
+      const auto [item, inserted] = ids.try_emplace(seqid, names.size());
+      if (!inserted)
+        throw runerror{"Records of " + seqid +
+                       " are not contiguous; sort the file first"};
+      names.push_back(seqid);
+      references.emplace_back();
+      current = item->second;
+      last_first = -1;
+      last_bin = UINT32_MAX;
+    } else if (first < last_first) {
+      throw runerror{"Records of " + seqid +
+                     " are not sorted by start; sort the file first"};
+    }
+    last_first = first;
+
+    auto &reference = references[*current];
+    const auto bin = reg2bin(first, last, min_shift, depth);
+    auto &chunks = reference.bins[bin];
+    if (bin == last_bin && !chunks.empty())
+      chunks.back().last = end;
+    else
+      chunks.push_back({offset, end});
+    last_bin = bin;
+
+    const auto window_first = static_cast<size_t>(first >> min_shift);
+    const auto window_last = static_cast<size_t>((last - 1) >> min_shift);
+    if (reference.linear.size() <= window_last)
+      reference.linear.resize(window_last + 1, unset);
+    for (auto window = window_first; window <= window_last; ++window)
+      reference.linear[window] = std::min(reference.linear[window], offset);
+
+    reference.span.first = std::min(reference.span.first, offset);
+    reference.span.last = end;
+    ++reference.records;
+  }
+
+  // Completes the index once every record has been added.
+  void finish() {
+    for (auto &reference : references) {
+      for (auto &[bin, chunks] : reference.bins) compact(chunks);
+
+      voffset_t previous{0};
+      for (auto &offset : reference.linear) {
+        if (offset == unset)
+          offset = previous;
+        else
+          previous = offset;
+      }
+
+      for (const auto &[bin, chunks] : reference.bins) {
+        const auto window = static_cast<size_t>(binFirstWindow(bin));
+        reference.loffsets[bin] = window < reference.linear.size()
+                                      ? reference.linear[window]
+                                      : chunks.front().first;
+      }
+    }
+    current.reset();
+  }
+
+  // Indexes the GFF records of a BGZF file, up to an embedded FASTA
+  // section, opened by ##FASTA or a bare '>' header.
+  void build(BGZF::Reader &reader) {
+    string line;
+    for (auto offset = reader.tell(); reader.getline(line);
+         offset = reader.tell()) {
+      if (GFF::is_fasta_start(line)) break;
+      if (line.empty() || line.front() == columns.meta) continue;
+      GFF::GFFRecord::fields_t fields;
+      if (!GFF::GFFRecord::split_fields(line, fields))
+        throw runerror{"Malformed GFF line - " + line};
+      const auto first = GFF::GFFRecord::parse_int(fields[3]);
+      const auto last = GFF::GFFRecord::parse_int(fields[4]);
+      if (!first || !last)
+        throw runerror{"Malformed GFF coordinates - " + line};
+      add(string(fields[0]), *first - 1, *last, offset, reader.tell());
+    }
+    finish();
+  }
+
+  static Index build(const string &file_name, int min_shift = tbi_min_shift,
+                     int depth = tbi_depth) {
+    BGZF::Reader reader{file_name};
+    Index index{min_shift, depth};
+    index.build(reader);
+    return index;
+  }
+
+  // Chunks that may contain records overlapping [first, last) of `seqid`,
+  // sorted and merged.
+  vector<Chunk> query(const string &seqid, int64_t first, int64_t last) const {
+    vector<Chunk> result;
+    const auto found = ids.find(seqid);
+    if (found == ids.end() || first >= last) return result;
+    const auto &reference = references[found->second];
+    first = std::max<int64_t>(first, 0);
+
+    voffset_t min_offset{0};
+    if (isTabixCompatible()) {
+      if (!reference.linear.empty()) {
+        const auto window = std::min(static_cast<size_t>(first >> min_shift),
+                                     reference.linear.size() - 1);
+        min_offset = reference.linear[window];
+      }
+    } else {
+      // Smallest bin containing `first` that exists.
+      auto bin = reg2bin(first, first + 1, min_shift, depth);
+      while (true) {
+        if (const auto item = reference.loffsets.find(bin);
+            item != reference.loffsets.end()) {
+          min_offset = item->second;
+          break;
+        }
+        if (!bin) break;
+        bin = (bin - 1) >> 3;
+      }
+    }
+
+    for (const auto bin : reg2bins(first, last, min_shift, depth)) {
+      const auto item = reference.bins.find(bin);
+      if (item == reference.bins.end()) continue;
+      for (const auto &chunk : item->second)
+        if (chunk.last > min_offset) result.push_back(chunk);
+    }
+
+    std::sort(result.begin(), result.end(),
+              [](const Chunk &left, const Chunk &right) {
+                return left.first < right.first;
+              });
+    size_t kept{0};
+    for (size_t index = 1; index < result.size(); ++index) {
+      if (result[index].first <= result[kept].last)
+        result[kept].last = std::max(result[kept].last, result[index].last);
+      else
+        result[++kept] = result[index];
+    }
+    if (!result.empty()) result.resize(kept + 1);
+    return result;
+  }
+
+  // Writes .tbi when the binning allows it and .csi otherwise.
+  void save(const string &file_name) const {
+    string out;
+    if (isTabixCompatible()) {
+      out.append("TBI\1", 4);
+      put32(out, static_cast<uint32_t>(names.size()));
+      putHeader(out);
+    } else {
+      out.append("CSI\1", 4);
+      put32(out, static_cast<uint32_t>(min_shift));
+      put32(out, static_cast<uint32_t>(depth));
+      string aux;
+      putHeader(aux);
+      put32(out, static_cast<uint32_t>(aux.size()));
+      out.append(aux);
+      put32(out, static_cast<uint32_t>(names.size()));
+    }
+
+    for (const auto &reference : references) {
+      const bool meta = reference.records > 0;
+      put32(out, static_cast<uint32_t>(reference.bins.size() + meta));
+      for (const auto &[bin, chunks] : reference.bins) {
+        put32(out, bin);
+        if (!isTabixCompatible()) put64(out, reference.loffsets.at(bin));
+        put32(out, static_cast<uint32_t>(chunks.size()));
+        for (const auto &chunk : chunks) {
+          put64(out, chunk.first);
+          put64(out, chunk.last);
+        }
+      }
+      // Pseudo-bin with the span and record count, as htslib writes.
+      if (meta) {
+        put32(out, metaBin());
+        if (!isTabixCompatible()) put64(out, 0);
+        put32(out, 2);
+        put64(out, reference.span.first);
+        put64(out, reference.span.last);
+        put64(out, reference.records);
+        put64(out, 0);
+      }
+      if (isTabixCompatible()) {
+        put32(out, static_cast<uint32_t>(reference.linear.size()));
+        for (const auto offset : reference.linear) put64(out, offset);
+      }
+    }
+    put64(out, no_coordinate);
+
+    BGZF::Writer writer{file_name};
+    writer.write(out);
+    writer.close();
+  }
+
+  static Index load(const string &file_name) {
+    BGZF::Reader reader{file_name};
+    char magic[4];
+    read(reader, magic, 4);
+
+    Index index;
+    size_t count{0};
+    if (!std::memcmp(magic, "TBI\1", 4)) {
+      count = get32(reader);
+      index.getHeader(reader);
+    } else if (!std::memcmp(magic, "CSI\1", 4)) {
+      const auto min_shift = static_cast<int>(get32(reader));
+      const auto depth = static_cast<int>(get32(reader));
+      index = Index(min_shift, depth);
+      const auto aux = get32(reader);
+      if (aux >= 28)
+        index.getHeader(reader);
+      else {
+        string skip(aux, '\0');
+        read(reader, skip.data(), skip.size());
+      }
+      count = get32(reader);
+    } else {
+      throw runerror{"'" + file_name + "' is not a .tbi or .csi index"};
+    }
+
+    if (index.names.size() != count)
+      throw runerror{"Sequence names do not match the index of '" +
+                     file_name + "'"};
+    for (size_t id = 0; id < index.names.size(); ++id)
+      index.ids.emplace(index.names[id], id);
+
+    const bool csi = magic[0] == 'C';
+    index.references.resize(count);
+    for (auto &reference : index.references) {
+      const auto bins = get32(reader);
+      for (uint32_t item = 0; item < bins; ++item) {
+        const auto bin = get32(reader);
+        const auto loffset = csi ? get64(reader) : 0;
+        const auto chunks = get32(reader);
+        vector<Chunk> list(chunks);
+        for (auto &chunk : list) {
+          chunk.first = get64(reader);
+          chunk.last = get64(reader);
+        }
+        if (bin == index.metaBin()) {
+          if (list.size() == 2) {
+            reference.span = list[0];
+            reference.records = list[1].first;
+          }
+          continue;
+        }
+        if (csi) reference.loffsets[bin] = loffset;
+        reference.bins[bin] = std::move(list);
+      }
+      if (!csi) {
+        reference.linear.resize(get32(reader));
+        for (auto &offset : reference.linear) offset = get64(reader);
+      }
+    }
+
+    unsigned char tail[8];
+    if (reader.read(reinterpret_cast<char *>(tail), 8) == 8)
+      index.no_coordinate = static_cast<uint64_t>(BGZF::read_u32(tail)) |
+                            static_cast<uint64_t>(BGZF::read_u32(tail + 4))
+                                << 32;
+    return index;
+  }
+
+  // Index next to `file_name`: .tbi when present, .csi otherwise.
+  static std::optional<string> find(const string &file_name) {
+    for (const auto &extension : {".tbi", ".csi"})
+      if (std::ifstream{file_name + extension}) return file_name + extension;
+    return std::nullopt;
+  }
+};
+
+}  // namespace HKL::Tabix
+
+namespace HKL::GFF {
+
+// Reads a coordinate-sorted, BGZF-compressed GFF. Without a region it yields
+// every comment and record like GFFReader; after fetch() it yields only the
+// records overlapping the region, decompressing just the blocks the index
+// points to.
+class GFFIndexedReader {
+ private:
+  BGZF::Reader reader;
+  Tabix::Index index{};
+  std::shared_ptr<StringPool> pool{std::make_shared<StringPool>()};
+  std::optional<Region> region{};
+  vector<Tabix::Chunk> chunks{};
+  size_t chunk{0};
+  bool seeked{false};
+  string line{};
+
+  static Tabix::Index open(const string &file_name) {
+    if (const auto index_name = Tabix::Index::find(file_name))
+      return Tabix::Index::load(*index_name);
+    throw runerror{"No .tbi or .csi index for '" + file_name +
+                   "'; create one with GFFIndex"};
+  }
+
+  optional<gff_variant> next() {
+    while (reader.getline(line)) {
+      if (line.empty()) continue;
+      if (is_fasta_start(line)) return nullopt;
+      if (line.front() == '#') return GFFComment{line};
+      return GFFRecord{line, pool};
+    }
+    return nullopt;
+  }
+
+  optional<gff_variant> nextInRegion() {
+    GFFRecord::fields_t fields;
+    while (chunk < chunks.size()) {
+      if (!seeked) {
+        reader.seek(chunks[chunk].first);
+        seeked = true;
+      }
+      if (reader.tell() >= chunks[chunk].last || !reader.getline(line)) {
+        ++chunk;
+        seeked = false;
+        continue;
+      }
+      if (line.empty() || line.front() == '#') continue;
+      if (!GFFRecord::split_fields(line, fields))
+        throw runerror{"Malformed GFF line - " + line};
+
+      const auto first = GFFRecord::parse_int(fields[3]);
+      const auto last = GFFRecord::parse_int(fields[4]);
+      if (!first || !last || fields[0] != region->getChrom()) continue;
+      // Sorted by start, so nothing further can overlap.
+      if (*first > region->getLast()) break;
+      if (*last < region->getFirst()) continue;
+      if (const auto strand = region->getStrand();
+          strand && (fields[6].size() != 1 || fields[6].front() != strand))
+        continue;
+      return GFFRecord{fields, pool};
+    }
+    chunks.clear();
+    chunk = 0;
+    return nullopt;
+  }
+
+ public:
+  GFFIndexedReader() = delete;
+  explicit GFFIndexedReader(const string &file_name)
+      : reader{file_name}, index{open(file_name)} {}
+  GFFIndexedReader(const string &file_name, const string &index_name)
+      : reader{file_name}, index{Tabix::Index::load(index_name)} {}
+
+  const std::shared_ptr<StringPool> &getPool() const noexcept { return pool; }
+  const Tabix::Index &getIndex() const noexcept { return index; }
+  vector<string> getSeqIDs() const { return index.getNames(); }
+
+  // Restricts reading to records overlapping `loc`, on its strand when it
+  // has one.
+  void fetch(const Region &loc) {
+    region = loc;
+    chunks = index.query(loc.getChrom(), int64_t{loc.getFirst()} - 1,
+                         loc.getLast());
+    chunk = 0;
+    seeked = false;
+  }
+
+  // Reads the whole file again from the top.
+  void rewind() {
+    region.reset();
+    chunks.clear();
+    reader.seek(0);
+  }
+
+  optional<gff_variant> getItem() { return (*this)(); }
+
+  optional<gff_variant> operator()() {
+    return region ? nextInRegion() : next();
+  }
+
+  vector<GFFRecord> query(const Region &loc) {
+    fetch(loc);
+    vector<GFFRecord> result;
+    while (auto item = nextInRegion())
+      result.push_back(std::get<GFFRecord>(std::move(*item)));
+    return result;
+  }
+};
+
+}  // namespace HKL::GFF
@@ -0,0 +1,283 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <functional>
+#include <map>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "hkl/gff.hpp"
+#include "hkl/parallel.hpp"
+#include "hkl/region.hpp"
+#include "hkl/regionseq.hpp"
+
+namespace HKL::Translate {
+
+using std::array;
+using std::map;
+using std::optional;
+using std::string;
+using std::unordered_map;
+using std::vector;
+using runerror = std::runtime_error;
+
+using GFF::GFFRecord;
+
+// Codon table in NCBI layout: 64 amino acids for codons ordered TTT, TTC,
+// TTA, TTG, TCT, ... (bases in T, C, A, G order).
+class GeneticCode {
+ private:
+  int table{1};
+  array<char, 64> amino{};
+
+  static uint8_t encode(char base) noexcept {
+    switch (base) {
+      case 'T':
+      case 't':
+      case 'U':
+      case 'u':
+        return 0;
+      case 'C':
+      case 'c':
+        return 1;
+      case 'A':
+      case 'a':
+        return 2;
+      case 'G':
+      case 'g':
+        return 3;
+      default:
+        return 4;
+    }
+  }
+
+ public:
+  static const map<int, string> &getTables() {
+    static const map<int, string> tables{
+        {1,
+         "FFLLSSSSYY**CC*WLLLLPPPPHHQQRRRRIIIMTTTTNNKKSSRRVVVVAAAADDEEGGGG"},
+        {2,
+         "FFLLSSSSYY**CCWWLLLLPPPPHHQQRRRRIIMMTTTTNNKKSS**VVVVAAAADDEEGGGG"},
+        {3,
+         "FFLLSSSSYY**CCWWTTTTPPPPHHQQRRRRIIMMTTTTNNKKSSRRVVVVAAAADDEEGGGG"},
+        {4,
+         "FFLLSSSSYY**CCWWLLLLPPPPHHQQRRRRIIIMTTTTNNKKSSRRVVVVAAAADDEEGGGG"},
+        {5,
+         "FFLLSSSSYY**CCWWLLLLPPPPHHQQRRRRIIMMTTTTNNKKSSSSVVVVAAAADDEEGGGG"},
+        {6,
+         "FFLLSSSSYYQQCC*WLLLLPPPPHHQQRRRRIIIMTTTTNNKKSSRRVVVVAAAADDEEGGGG"},
+        {9,
+         "FFLLSSSSYY**CCWWLLLLPPPPHHQQRRRRIIIMTTTTNNNKSSSSVVVVAAAADDEEGGGG"},
+        {10,
+         "FFLLSSSSYY**CCCWLLLLPPPPHHQQRRRRIIIMTTTTNNKKSSRRVVVVAAAADDEEGGGG"},
+        {11,
+         "FFLLSSSSYY**CC*WLLLLPPPPHHQQRRRRIIIMTTTTNNKKSSRRVVVVAAAADDEEGGGG"},
+        {12,
+         "FFLLSSSSYY**CC*WLLLSPPPPHHQQRRRRIIIMTTTTNNKKSSRRVVVVAAAADDEEGGGG"},
+        {13,
+         "FFLLSSSSYY**CCWWLLLLPPPPHHQQRRRRIIMMTTTTNNKKSSGGVVVVAAAADDEEGGGG"},
+        {14,
+         "FFLLSSSSYYY*CCWWLLLLPPPPHHQQRRRRIIIMTTTTNNNKSSSSVVVVAAAADDEEGGGG"},
+        {16,
+         "FFLLSSSSYY*LCC*WLLLLPPPPHHQQRRRRIIIMTTTTNNKKSSRRVVVVAAAADDEEGGGG"},
+        {21,
+         "FFLLSSSSYY**CCWWLLLLPPPPHHQQRRRRIIMMTTTTNNNKSSSSVVVVAAAADDEEGGGG"},
+        {22,
+         "FFLLSS*SYY*LCC*WLLLLPPPPHHQQRRRRIIIMTTTTNNKKSSRRVVVVAAAADDEEGGGG"},
+        {23,
+         "FF*LSSSSYY**CC*WLLLLPPPPHHQQRRRRIIIMTTTTNNKKSSRRVVVVAAAADDEEGGGG"},
+        {24,
+         "FFLLSSSSYY**CCWWLLLLPPPPHHQQRRRRIIIMTTTTNNKKSSSKVVVVAAAADDEEGGGG"},
+        {25,
+         "FFLLSSSSYY**CCGWLLLLPPPPHHQQRRRRIIIMTTTTNNKKSSRRVVVVAAAADDEEGGGG"},
+        {26,
+         "FFLLSSSSYY**CC*WLLLAPPPPHHQQRRRRIIIMTTTTNNKKSSRRVVVVAAAADDEEGGGG"},
+    };
+    return tables;
+  }
+
+  GeneticCode(int table = 1) : table{table} {
+    const auto &tables = getTables();
+    if (const auto found = tables.find(table); found != tables.end())
+      std::copy(found->second.begin(), found->second.end(), amino.begin());
+    else
+      throw runerror{"Unknown genetic code table " + to_string(table)};
+  }
+
+  int getTable() const noexcept { return table; }
+
+  char translate(char first, char second, char third) const noexcept {
+    const auto a = encode(first), b = encode(second), c = encode(third);
+    if ((a | b | c) & 4) return 'X';
+    return amino[a * 16 + b * 4 + c];
+  }
+
+  // Translates complete codons of `seq`; a trailing partial codon is dropped.
+  string translate(const string &seq, bool to_stop = false) const {
+    string result;
+    result.reserve(seq.size() / 3);
+    for (size_t pos = 0; pos + 3 <= seq.size(); pos += 3) {
+      const auto aa = translate(seq[pos], seq[pos + 1], seq[pos + 2]);
+      if (to_stop && aa == '*') break;
+      result.push_back(aa);
+    }
+    return result;
+  }
+};
+
+struct Transcript {
+  string id{};
+  string seqid{};
+  char strand{0};
+  int phase{0};
+  // CDS segments in transcript (5' to 3') order.
+  vector<Region> segments{};
+  string cds{};
+  string protein{};
+
+  Region getLoc() const {
+    if (segments.empty()) return Region();
+    int first{segments.front().getFirst()}, last{segments.front().getLast()};
+    for (const auto &segment : segments) {
+      first = std::min(first, segment.getFirst());
+      last = std::max(last, segment.getLast());
+    }
+    return Region(seqid, first, last, strand);
+  }
+};
+
+// Groups CDS records by each of their Parent IDs. Segments are ordered 5' to
+// 3' and the phase of the 5'-most segment is kept, so the spliced sequence can
+// be trimmed to the first complete codon. The phase of every later segment
+// must agree with the frame carried over from the segments before it, since
+// splicing them end to end would otherwise change the reading frame.
+inline vector<Transcript> collect_cds(const vector<GFFRecord> &records,
+                                      const string &type = "CDS") {
+  vector<Transcript> result;
+  vector<vector<pair<Region, optional<int>>>> parts;
+  unordered_map<string, size_t> index;
+
+  for (const auto &record : records) {
+    if (record.getType() != type) continue;
+
+    const auto parents = record.get("Parent", "", "");
+    if (parents.empty()) continue;
+
+    const auto seqid = record.getSeqID().value_or("");
+    const auto strand = record.getStrand().value_or('+');
+
+    for (const auto &parent : StringDecompose::str_split(parents, ",")) {
+      const auto [item, inserted] = index.try_emplace(parent, result.size());
+      if (inserted) {
+        result.push_back({parent, seqid, strand});
+        parts.emplace_back();
+      }
+
+      const auto &transcript = result[item->second];
+      if (transcript.seqid != seqid || transcript.strand != strand)
+        throw runerror{"CDS of '" + parent +
+                       "' span several sequences or strands"};
+
+      parts[item->second].emplace_back(
+          Region(seqid, record.getStart(), record.getEnd(), strand),
+          record.getPhase());
+    }
+  }
+
+  for (size_t pos = 0; pos < result.size(); ++pos) {
+    auto &transcript = result[pos];
+    auto &segments = parts[pos];
+
+    std::sort(segments.begin(), segments.end());
+    if (transcript.strand == '-')
+      std::reverse(segments.begin(), segments.end());
+
+    transcript.phase = segments.front().second.value_or(0);
+    auto expected = transcript.phase;
+    for (auto &[segment, phase] : segments) {
+      if (phase && *phase != expected)
+        throw runerror{"CDS of '" + transcript.id + "' at " + segment.str() +
+                       " has phase " + std::to_string(*phase) +
+                       " but the reading frame expects " +
+                       std::to_string(expected)};
+      expected = static_cast<int>((expected + 3 - segment.getLength() % 3) % 3);
+      transcript.segments.push_back(std::move(segment));
+    }
+  }
+
+  return result;
+}
+
+inline vector<Transcript> collect_cds(GFF::GFFReader &reader,
+                                      const string &type = "CDS") {
+  vector<GFFRecord> records;
+  while (const auto item = reader()) {
+    if (const auto record = std::get_if<GFFRecord>(&(*item)))
+      if (record->getType() == type) records.push_back(*record);
+  }
+  return collect_cds(records, type);
+}
+
+// Returns the forward strand sequence of a Region.
+using fetch_t = std::function<string(const Region &)>;
+
+// Fetches from loaded sequences, matched by the first word of their FASTA
+// header. A region reaching past its sequence is an error rather than being
+// clipped, which would shift the reading frame. The sequences must outlive
+// the returned function.
+inline fetch_t fetch_from(const vector<RegionSeq> &seqs) {
+  auto index = std::make_shared<unordered_map<string, const RegionSeq *>>();
+  for (const auto &seq : seqs)
+    index->try_emplace(FASTAReader::getSeqID(seq.getName()), &seq);
+
+  return [index](const Region &loc) -> string {
+    const auto found = index->find(loc.getChrom());
+    if (found == index->end())
+      throw runerror{"Sequence '" + loc.getChrom() + "' was not loaded"};
+    auto seq = found->second->getSeq(Region(loc.getFirst(), loc.getLast()));
+    if (seq.size() != loc.getLength())
+      throw runerror{"Region '" + loc.str() + "' is outside of sequence '" +
+                     loc.getChrom() + "'"};
+    return seq;
+  };
+}
+
+// Splices and translates transcripts in parallel. `fetch` is called
+// concurrently and must be thread-safe.
+inline void translate_transcripts(vector<Transcript> &transcripts,
+                                  const fetch_t &fetch,
+                                  const GeneticCode &code = GeneticCode(),
+                                  size_t threads = 0) {
+  Parallel::parallel_for(
+      transcripts.size(),
+      [&](size_t index) {
+        auto &transcript = transcripts[index];
+        string cds;
+        for (const auto &segment : transcript.segments) {
+          auto seq = fetch(segment);
+          if (transcript.strand == '-') seq = RegionSeq::reverseComplement(seq);
+          cds += seq;
+        }
+        const auto phase =
+            std::min(static_cast<size_t>(transcript.phase), cds.size());
+        transcript.cds = cds.substr(phase);
+        transcript.protein = code.translate(transcript.cds);
+      },
+      threads);
+}
+
+inline vector<Transcript> translate_cds(const vector<GFFRecord> &records,
+                                        const vector<RegionSeq> &seqs,
+                                        int table = 1, size_t threads = 0) {
+  auto transcripts = collect_cds(records);
+  translate_transcripts(transcripts, fetch_from(seqs), GeneticCode(table),
+                        threads);
+  return transcripts;
+}
+
+}  // namespace HKL::Translate
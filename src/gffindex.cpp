@@ -0,0 +1,103 @@
+#include <hkl/gffindex.hpp>
+
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+using std::string;
+
+using namespace HKL;
+
+using std::runtime_error;
+
+int main(int argc, char *argv[]) {
+  GFF::IndexParameters args{};
+
+  if (args.parse(argc, argv))
+    return 1;
+
+  const auto file_name = GFF::ensure_bgzf(args.getInput(), args.getLevel(),
+                                          args.isForced());
+  GFF::index_gff(file_name, args);
+  return 0;
+}
+
+bool GFF::IndexParameters::parse(int argc, char *argv[]) {
+  Args::Arguments args{"GFFIndex"};
+
+  args.addArgument("input",
+                   "Coordinate-sorted GFF, plain or BGZF compressed. Plain "
+                   "input is first compressed into <input>.gz",
+                   'i');
+  args.addArgument("output",
+                   "Index file, <input>.tbi or <input>.csi if not given", 'o');
+  args.addSwitch("csi",
+                 "Write a .csi index, required for coordinates of 2^29 and "
+                 "above",
+                 'c');
+  args.addArgument("min-shift", "Bits per window of a .csi index", 'm', "14");
+  args.addArgument("level", "Compression level of BGZF output, 0 to 9", 'l',
+                   "-1");
+  args.addSwitch("force", "Replace an existing <input>.gz", 'f');
+
+  if (args.parse(argc, argv))
+    return 1;
+
+  if (const auto input = args.getValue("input"))
+    this->input = *input;
+  else
+    throw runtime_error{"Input file is required"};
+
+  this->output = args.getValue("output");
+  this->csi = args.isSet("csi");
+  this->force = args.isSet("force");
+
+  if (const auto shift = StringFormat::str_to_int(*args.getValue("min-shift"));
+      shift && *shift > 0 && *shift < 32)
+    this->min_shift = *shift;
+  else
+    throw runtime_error{"Window bits must be a number between 1 and 31"};
+
+  if (this->min_shift != Tabix::Index::tbi_min_shift && !this->csi)
+    throw runtime_error{"Only a .csi index takes --min-shift"};
+
+  if (const auto level = StringFormat::str_to_int(*args.getValue("level"));
+      level && *level >= -1 && *level <= 9)
+    this->level = *level;
+  else
+    throw runtime_error{"Compression level must be between 0 and 9"};
+
+  return 0;
+}
+
+string GFF::ensure_bgzf(const string &input, int level, bool force) {
+  if (BGZF::is_bgzf(input))
+    return input;
+
+  std::ifstream stream{input, std::ios::binary};
+  if (!stream)
+    throw runtime_error{"Cannot read file '" + input + "'"};
+  if (stream.peek() == 0x1f)
+    throw runtime_error{"'" + input +
+                        "' is gzip but not BGZF compressed; decompress it "
+                        "first"};
+  const auto file_name = input + ".gz";
+  if (!force && std::filesystem::exists(file_name))
+    throw runtime_error{"'" + file_name +
+                        "' already exists; index it directly or pass "
+                        "--force to replace it"};
+  BGZF::compress(stream, file_name, level);
+  return file_name;
+}
+
+string GFF::index_gff(const string &file_name, const IndexParameters &args) {
+  BGZF::Reader reader{file_name};
+  auto index = args.isCSI() ? Tabix::Index::csi(args.getMinShift())
+                            : Tabix::Index::tbi();
+  index.build(reader);
+
+  const auto output = args.getOutput().value_or(
+      file_name + (index.isTabixCompatible() ? ".tbi" : ".csi"));
+  index.save(output);
+  return output;
+}
@@ -1,47 +1,225 @@
 #include <hkl/gfflatter.hpp>
 
 #include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
 #include <memory>
+#include <new>
+#include <unordered_map>
 #include <unordered_set>
 
+#include <stdlib.h>
+#include <unistd.h>
+
+using std::optional;
 using std::string;
 using std::vector;
 
 using namespace HKL;
 
+namespace fs = std::filesystem;
+
 using std::cerr;
 
-int main(int argc, char *argv[]) {
-  GFF::Parameters args{};
+// Set with --stats; the readers and writers of every conversion report to it,
+// and the line counters on standard error are left out so its reports stay
+// one JSON object per line.
+static Metrics *metrics{nullptr};
 
-  if (args.parse(argc, argv))
-    return 1;
+// Set with --stats before any thread starts, so a run without it does not
+// pay for a shared atomic increment on every allocation.
+static bool count_allocations{false};
 
-  std::unique_ptr<GFF::GFFReader> reader{nullptr};
+// Counts allocations for --stats. The array and nothrow forms call these.
+// They are kept out of line, as GCC otherwise pairs the inlined free() with
+// operator new and warns of a mismatch.
+[[gnu::noinline]] void *operator new(std::size_t size) {
+  if (count_allocations)
+    Metrics::allocations().fetch_add(1, std::memory_order_relaxed);
+  if (const auto memory = std::malloc(size ? size : 1))
+    return memory;
+  throw std::bad_alloc{};
+}
+[[gnu::noinline]] void operator delete(void *memory) noexcept {
+  std::free(memory);
+}
+[[gnu::noinline]] void operator delete(void *memory, std::size_t) noexcept {
+  std::free(memory);
+}
 
-  if (!args.hasInput())
-    reader = std::make_unique<GFF::GFFReader>(std::cin);
-  else if (args.size() == 1)
-    reader = std::make_unique<GFF::GFFReader>(args.getInput().front());
-  else
-    return 1;
+static std::unique_ptr<GFF::GFFReader> open_reader(
+    const optional<string> &input) {
+  auto reader = input ? std::make_unique<GFF::GFFReader>(*input)
+                      : std::make_unique<GFF::GFFReader>(std::cin);
+  reader->setMetrics(metrics);
+  return reader;
+}
 
-  std::unique_ptr<ostream> writer{nullptr};
+// Converts one input, standard input when not given, with the options of
+// `args`.
+static void convert(const GFF::Parameters &args, const optional<string> &input,
+                    std::unique_ptr<ostream> &writer) {
+  switch (args.getFormat()) {
+  case GFF::Formats::TSV: {
+    // Records are written as read when keys are given, and all held without
+    // a budget. Otherwise raw lines are held up to the budget, beyond which
+    // a file is read again and a stream spilled.
+    const auto memory = args.getMemory();
+    if (args.hasKeys() || !memory) {
+      auto reader = open_reader(input);
+      GFF::gffile_to_tsv(reader, writer, args.getMissing(), args.getEmpty(),
+                         args.hasComments(), args.getKeys());
+    } else if (!input) {
+      GFF::gffstream_to_tsv(std::cin, writer, args.getMissing(),
+                            args.getEmpty(), args.hasComments(), memory);
+    } else {
+      const auto &file_name = *input;
+      std::ifstream stream{file_name, std::ios::binary};
+      if (!stream)
+        throw runtime_error{"Cannot open file '" + file_name + "'"};
+      GFF::gffstream_to_tsv(stream, writer, args.getMissing(), args.getEmpty(),
+                            args.hasComments(), memory,
+                            fs::is_regular_file(file_name)
+                                ? optional<string>{file_name}
+                                : std::nullopt);
+    }
+    break;
+  }
+  case GFF::Formats::JSON: {
+    auto reader = open_reader(input);
+    GFF::gffile_to_json(reader, writer, args.hasComments());
+    break;
+  }
+  case GFF::Formats::Columnar: {
+    auto keys = args.getKeys();
+    if (keys.empty() && input && fs::is_regular_file(*input))
+      keys = GFF::discover_keys(*input);
 
-  if (const auto file_name = args.getOutput())
-    writer = std::make_unique<std::ofstream>(*file_name);
-  else
-    writer = std::make_unique<std::ostream>(std::cout.rdbuf());
+    auto reader = open_reader(input);
+    GFF::gffile_to_columnar(reader, writer, keys);
+    break;
+  }
+  case GFF::Formats::GTF: {
+    auto reader = open_reader(input);
+    GFF::gffile_to_gtf(reader, writer, args.hasComments(), args.getThreads());
+    break;
+  }
+  default:
+    throw runtime_error{"Unsupported format"};
+  }
+
+}
+
+// Converts all inputs as `args` asks.
+static void run(const GFF::Parameters &args) {
+  const auto inputs = args.getInput();
+
+  if (args.isSplit()) {
+    // Outputs are named after the inputs, so inputs sharing a name would
+    // overwrite each other.
+    const fs::path directory{args.getOutput().value_or(".")};
+    vector<fs::path> outputs;
+    std::unordered_map<string, size_t> names;
+    for (size_t index = 0; index < inputs.size(); ++index) {
+      auto name = fs::path(inputs[index]).filename().string() +
+                  GFF::extension(args.getFormat());
+      if (const auto [item, inserted] = names.try_emplace(name, index);
+          !inserted)
+        throw runtime_error{"Inputs '" + inputs[item->second] + "' and '" +
+                            inputs[index] + "' would both be written to '" +
+                            name + "'"};
+      outputs.push_back(directory / name);
+    }
+
+    fs::create_directories(directory);
+    Parallel::parallel_for(
+        inputs.size(),
+        [&](size_t index) {
+          GFF::OutputFile output{outputs[index].string(), inputs};
+          convert(args, inputs[index], output.getWriter());
+          output.commit();
+        },
+        args.getThreads());
+    return;
+  }
+
+  // Output goes to the descriptor with write(2) in large blocks. Streams do
+  // not flush on destruction; finishing the output reports failed writes. An
+  // output file that is also an input is replaced only once it is read.
+  std::unique_ptr<GFF::OutputFile> file{nullptr};
+  GFF::DescriptorStream *standard_output{nullptr};
+  std::unique_ptr<ostream> standard_writer{nullptr};
+  if (const auto file_name = args.getOutput()) {
+    file = std::make_unique<GFF::OutputFile>(*file_name, inputs);
+  } else {
+    auto stream = std::make_unique<GFF::DescriptorStream>(STDOUT_FILENO);
+    standard_output = stream.get();
+    standard_writer = std::move(stream);
+  }
+  auto &writer = file ? file->getWriter() : standard_writer;
+  const auto finish = [&] {
+    if (file)
+      file->commit();
+    else
+      standard_output->finish();
+  };
+
+  if (inputs.size() <= 1) {
+    convert(args, inputs.empty() ? optional<string>{} : inputs.front(),
+            writer);
+    finish();
+    return;
+  }
 
   switch (args.getFormat()) {
   case GFF::Formats::TSV:
-    GFF::gffile_to_tsv(reader, writer, args.getMissing(), args.getEmpty(),
-                       args.hasComments());
+    GFF::gffiles_to_tsv(inputs, writer, args.getMissing(), args.getEmpty(),
+                        args.getKeys(), args.getThreads());
+    break;
+  case GFF::Formats::JSON:
+    GFF::gffiles_to_json(inputs, writer, args.getThreads());
+    break;
+  case GFF::Formats::GTF:
+    // Each input is already formatted in parallel.
+    for (const auto &input : inputs)
+      convert(args, input, writer);
     break;
   default:
-    throw runtime_error{"Unsupported format"};
+    throw runtime_error{"Multiple inputs in one columnar file are not "
+                        "supported, use --split"};
+  }
+  finish();
+}
+
+int main(int argc, char *argv[]) {
+  GFF::Parameters args{};
+
+  if (args.parse(argc, argv))
+    return 1;
+
+  if (!args.hasStats()) {
+    run(args);
+    return 0;
   }
 
+  // Reports go to standard error as one JSON object per line, so they never
+  // mix with output on standard output.
+  count_allocations = true;
+  Metrics stats{};
+  metrics = &stats;
+  std::unique_ptr<MetricsReporter> reporter{nullptr};
+  if (const auto interval = args.getStatsInterval())
+    reporter = std::make_unique<MetricsReporter>(
+        stats, cerr, std::chrono::seconds{interval});
+
+  run(args);
+
+  reporter.reset();
+  cerr << stats.toJSON() << std::flush;
   return 0;
 }
 
@@ -49,8 +227,15 @@ bool GFF::Parameters::parse(int argc, char *argv[]) {
   Args::Arguments args{"GFFlatter"};
 
   args.addMulti("input", "Input file in GFF format", 'i');
-  args.addArgument("input", "Format of output", 'f', "tsv");
-  args.addSwitch("comments", "Print comments", 'c');
+  args.addArgument("output", "Output file, standard output if not given", 'o');
+  args.addArgument("format",
+                   "Format of output: tsv, json (NDJSON), columnar (binary) "
+                   "or gtf",
+                   'f', "tsv");
+  args.addSwitch("comments",
+                 "Print comments. Not supported when several inputs are "
+                 "combined into one TSV or JSON table",
+                 'c');
   args.addArgument(
       "keys",
       "Get only these keys as columns. Values should be delimetered with ','.",
@@ -58,6 +243,29 @@ bool GFF::Parameters::parse(int argc, char *argv[]) {
   args.enableAppend("keys", ',');
   args.addArgument("missing", "Value for .", 'm', "true");
   args.addArgument("empty", "Value to use when columns is empty.", 'e', ".");
+  args.addArgument("memory",
+                   "Memory budget in MiB for buffering records when keys are "
+                   "not given. Larger inputs are read twice or spilled to a "
+                   "temporary file. 0 keeps everything in memory.",
+                   'b', "1024");
+  args.addSwitch("split",
+                 "Write one output per input, named after it, into the "
+                 "directory given by --output (default: current directory) "
+                 "instead of one combined table. Needs --input, and inputs "
+                 "must have distinct file names",
+                 's');
+  args.addArgument("threads",
+                   "Number of inputs processed at once, or of GTF formatting "
+                   "workers, 0 for all cores",
+                   't', "0");
+  args.addSwitch("stats",
+                 "Write a JSON summary of throughput, stage timings, peak "
+                 "memory and parse latencies to standard error at exit",
+                 'S');
+  args.addArgument("stats-interval",
+                   "With --stats, also report progress every this many "
+                   "seconds, 0 for none",
+                   'I', "0");
 
   if (args.parse(argc, argv))
     return 1;
@@ -66,6 +274,12 @@ bool GFF::Parameters::parse(int argc, char *argv[]) {
 
   if (const auto format = *args.getValue("format"); format == "tsv")
     this->format = Formats::TSV;
+  else if (format == "json" || format == "ndjson")
+    this->format = Formats::JSON;
+  else if (format == "columnar")
+    this->format = Formats::Columnar;
+  else if (format == "gtf")
+    this->format = Formats::GTF;
   else
     throw runtime_error{"Unrecognized format '" + format + "'"};
 
@@ -75,41 +289,398 @@ bool GFF::Parameters::parse(int argc, char *argv[]) {
   this->empty = *args.getValue("empty");
   this->missing = *args.getValue("missing");
 
+  if (const auto memory = StringFormat::str_to_int(*args.getValue("memory"));
+      memory && *memory >= 0)
+    this->memory = static_cast<size_t>(*memory) << 20;
+  else
+    throw runtime_error{"Memory budget must be a non-negative number of MiB"};
+
+  this->split = args.isSet("split");
+  if (const auto threads = StringFormat::str_to_int(*args.getValue("threads"));
+      threads && *threads >= 0)
+    this->threads = static_cast<size_t>(*threads);
+  else
+    throw runtime_error{"Number of threads must be a non-negative number"};
+
+  if (this->split && this->input.empty())
+    throw runtime_error{"--split needs at least one --input"};
+  if (this->comments && !this->split && this->input.size() > 1 &&
+      (this->format == Formats::TSV || this->format == Formats::JSON))
+    throw runtime_error{"--comments is not supported when several inputs are "
+                        "combined, use --split"};
+
+  this->stats = args.isSet("stats");
+  if (const auto interval =
+          StringFormat::str_to_int(*args.getValue("stats-interval"));
+      interval && *interval >= 0)
+    this->stats_interval = static_cast<size_t>(*interval);
+  else
+    throw runtime_error{"Statistics interval must be a non-negative number "
+                        "of seconds"};
+
   return 0;
 }
 
+namespace {
+
+// Collects attribute keys in first-seen order, using the pool IDs of the
+// reader so each key is compared as an integer.
+class KeyCollector {
+private:
+  StringPool &pool;
+  vector<bool> known_keys{};
+  vector<StringPool::id_t> record_keys{};
+  vector<string> keys{};
+
+  void addKeys() {
+    for (const auto key : record_keys) {
+      if (key >= known_keys.size())
+        known_keys.resize(key + 1, false);
+      if (!known_keys[key]) {
+        known_keys[key] = true;
+        keys.push_back(pool[key]);
+      }
+    }
+  }
+
+public:
+  explicit KeyCollector(StringPool &pool) : pool{pool} {}
+
+  void add(const GFF::GFFRecord &record) {
+    record_keys.clear();
+    record.getKeyIndices(std::back_inserter(record_keys));
+    addKeys();
+  }
+
+  // Keys read from the raw column, without building a record.
+  void add(const GFF::GFFRecordView &view) {
+    record_keys.clear();
+    GFF::GFFRecord::scan_keys(view.getRaw(8), pool,
+                              std::back_inserter(record_keys));
+    addKeys();
+  }
+
+  const vector<string> &getKeys() const { return keys; }
+};
+
+// Writes the records of `reader` with known keys, without holding them. The
+// header is written before the first record, after any leading comments.
+void stream_to_tsv(GFF::GFFReader &reader, std::ostream &writer,
+                   const vector<string> &keys, const string &missing,
+                   const string &empty, bool comments) {
+  GFF::TSVWriter tsv{writer, keys, missing, empty};
+  tsv.setMetrics(metrics);
+  bool header_written = false;
+  int counter = 0;
+
+  while (auto line = reader.getItem()) {
+    if (++counter % 1000000 == 0 && !metrics)
+      std::clog << counter << "\n";
+    if (const auto record = std::get_if<GFF::GFFRecord>(&(*line))) {
+      if (!header_written) {
+        tsv.writeHeader();
+        header_written = true;
+      }
+      tsv.write(*record);
+    } else if (comments)
+      tsv.write(std::get<GFF::GFFComment>(*line));
+  }
+
+  if (!header_written)
+    tsv.writeHeader();
+}
+
+// Temporary file removed when it goes out of scope.
+class TempFile {
+private:
+  string path{};
+
+public:
+  TempFile() {
+    auto pattern = (fs::temp_directory_path() / "gfflatter-XXXXXX").string();
+    const auto fd = mkstemp(pattern.data());
+    if (fd == -1)
+      throw runtime_error{"Cannot create temporary file in " +
+                          fs::temp_directory_path().string()};
+    close(fd);
+    path = pattern;
+  }
+  TempFile(const TempFile &) = delete;
+  TempFile &operator=(const TempFile &) = delete;
+  ~TempFile() { std::remove(path.c_str()); }
+
+  const string &getPath() const { return path; }
+};
+
+// Union of the keys of all inputs, in input order and first-seen order
+// within each input.
+vector<string> merge_keys(const vector<string> &inputs, size_t threads) {
+  vector<vector<string>> keys(inputs.size());
+  Parallel::parallel_for(
+      inputs.size(),
+      [&](size_t index) { keys[index] = GFF::discover_keys(inputs[index]); },
+      threads);
+
+  vector<string> result;
+  std::unordered_set<string> seen;
+  for (const auto &input_keys : keys)
+    for (const auto &key : input_keys)
+      if (seen.insert(key).second)
+        result.push_back(key);
+  return result;
+}
+
+// Formats every input on a worker into its own temporary file, then appends
+// the files to `writer` in input order.
+template <class Format>
+void concat_parallel(const vector<string> &inputs, std::ostream &writer,
+                     size_t threads, Format format) {
+  vector<std::unique_ptr<TempFile>> parts(inputs.size());
+
+  Parallel::parallel_for(
+      inputs.size(),
+      [&](size_t index) {
+        auto part = std::make_unique<TempFile>();
+        std::ofstream output{part->getPath(), std::ios::binary};
+        format(inputs[index], output);
+        output.close();
+        if (!output)
+          throw runtime_error{"Cannot write temporary file " +
+                              part->getPath()};
+        parts[index] = std::move(part);
+      },
+      threads);
+
+  for (auto &part : parts) {
+    if (fs::file_size(part->getPath())) {
+      std::ifstream input{part->getPath(), std::ios::binary};
+      writer << input.rdbuf();
+    }
+    part.reset();
+  }
+}
+
+} // namespace
+
 void GFF::gffile_to_tsv(std::unique_ptr<GFF::GFFReader> &reader,
                         std::unique_ptr<std::ostream> &writer,
                         const string &missing, const string &empty,
-                        bool comments) {
-  string header = "seqid\tsource\ttype\tstart\tend\tscore\tstrand\tphase";
-  std::unordered_set<string> keys_to_print;
+                        bool comments, const vector<string> &keys) {
+  if (!keys.empty()) {
+    stream_to_tsv(*reader, *writer, keys, missing, empty, comments);
+    return;
+  }
+
+  KeyCollector collector{*reader->getPool()};
   vector<GFF::GFFRecord> records;
   int counter = 0;
 
-  while (const auto line = reader->getItem()) {
-    if (++counter % 1000000 == 0)
+  while (auto line = reader->getItem()) {
+    if (++counter % 1000000 == 0 && !metrics)
       std::clog << counter << "\n";
     if ((*line).index() == 1) {
-      auto record = std::get<GFF::GFFRecord>(*line);
-      std::copy(record.keys_begin(), record.keys_end(),
-                std::inserter(keys_to_print, keys_to_print.begin()));
-      records.push_back(record);
+      auto &record = std::get<GFF::GFFRecord>(*line);
+      {
+        const Metrics::Scope scope{metrics, Metrics::Stage::Discover};
+        collector.add(record);
+      }
+      records.push_back(std::move(record));
     } else if (comments)
       std::visit([&writer](auto &&ele) { *writer << ele << "\n"; }, *line);
   }
 
-  *writer << header << "\t"
-          << StringCompose::str_join(keys_to_print.begin(), keys_to_print.end(),
-                                     "\t")
-          << "\n";
+  GFF::TSVWriter tsv{*writer, collector.getKeys(), missing, empty};
+  tsv.setMetrics(metrics);
+  tsv.writeHeader();
   counter = 0;
   for (const auto &record : records) {
-    if (++counter % 1000000 == 0)
+    if (++counter % 1000000 == 0 && !metrics)
+      std::clog << counter << "\n";
+    tsv.write(record);
+  }
+}
+
+vector<string> GFF::discover_keys(const string &file_name,
+                                  std::ostream *comments) {
+  GFF::GFFViewReader views{file_name};
+  views.setMetrics(metrics);
+  KeyCollector collector{*views.getPool()};
+
+  while (auto line = views()) {
+    if (const auto view = std::get_if<GFF::GFFRecordView>(&(*line))) {
+      const Metrics::Scope scope{metrics, Metrics::Stage::Discover};
+      collector.add(*view);
+    }
+    else if (comments)
+      *comments << std::get<GFF::GFFComment>(*line) << "\n";
+  }
+
+  return collector.getKeys();
+}
+
+void GFF::gffstream_to_tsv(std::istream &input,
+                           std::unique_ptr<std::ostream> &writer,
+                           const string &missing, const string &empty,
+                           bool comments, size_t memory,
+                           const optional<string> &file_name) {
+  GFF::GFFViewReader views{input};
+  views.setMetrics(metrics);
+  KeyCollector collector{*views.getPool()};
+  vector<string> lines;
+  size_t held = 0;
+  bool reread{false};
+  std::unique_ptr<TempFile> spill{nullptr};
+  std::ofstream spill_writer;
+
+  while (auto line = views()) {
+    if (const auto view = std::get_if<GFF::GFFRecordView>(&(*line))) {
+      {
+        const Metrics::Scope scope{metrics, Metrics::Stage::Discover};
+        collector.add(*view);
+      }
+      if (reread)
+        continue;
+      const auto raw = view->getLine();
+      if (spill) {
+        spill_writer.write(raw.data(), raw.size()) << '\n';
+        continue;
+      }
+      lines.emplace_back(raw);
+      // The line's slot in `lines` and its buffer.
+      held += sizeof(string) + lines.back().capacity() + 1;
+      if (held > memory) {
+        if (file_name) {
+          reread = true;
+          lines = vector<string>{};
+          continue;
+        }
+        spill = std::make_unique<TempFile>();
+        spill_writer.open(spill->getPath(), std::ios::binary);
+        for (const auto &held_line : lines)
+          spill_writer << held_line << '\n';
+        lines = vector<string>{};
+      }
+    } else if (comments)
+      *writer << std::get<GFF::GFFComment>(*line) << "\n";
+  }
+
+  const auto &keys = collector.getKeys();
+  if (reread) {
+    GFF::GFFReader reader{*file_name};
+    reader.setMetrics(metrics);
+    stream_to_tsv(reader, *writer, keys, missing, empty, false);
+    return;
+  }
+  if (!spill) {
+    GFF::TSVWriter tsv{*writer, keys, missing, empty};
+    tsv.setMetrics(metrics);
+    tsv.writeHeader();
+    for (const auto &held_line : lines) {
+      if (!metrics) {
+        tsv.write(GFF::GFFRecord{held_line, views.getPool()});
+        continue;
+      }
+      const auto start = Metrics::clock::now();
+      const GFF::GFFRecord record{held_line, views.getPool()};
+      metrics->addRecord(Metrics::clock::now() - start);
+      tsv.write(record);
+    }
+    return;
+  }
+
+  spill_writer.close();
+  if (!spill_writer)
+    throw runtime_error{"Cannot write temporary file " + spill->getPath()};
+
+  GFF::GFFReader reader{spill->getPath()};
+  reader.setMetrics(metrics);
+  stream_to_tsv(reader, *writer, keys, missing, empty, false);
+}
+
+void GFF::gffile_to_json(std::unique_ptr<GFF::GFFReader> &reader,
+                         std::unique_ptr<std::ostream> &writer,
+                         bool comments) {
+  GFF::NDJSONWriter json{*writer, comments};
+  json.setMetrics(metrics);
+  int counter = 0;
+
+  while (auto line = reader->getItem()) {
+    if (++counter % 1000000 == 0 && !metrics)
       std::clog << counter << "\n";
-    *writer << record.strFields(missing, "\t")
-            << record.strAttributes(keys_to_print.begin(), keys_to_print.end(),
-                                    missing, "\t", empty)
-            << "\n";
+    json.write(*line);
+  }
+}
+
+void GFF::gffile_to_columnar(std::unique_ptr<GFF::GFFReader> &reader,
+                             std::unique_ptr<std::ostream> &writer,
+                             const vector<string> &keys) {
+  vector<GFF::GFFRecord> records;
+  vector<string> discovered;
+
+  if (keys.empty()) {
+    KeyCollector collector{*reader->getPool()};
+    while (auto line = reader->getItem()) {
+      if (auto record = std::get_if<GFF::GFFRecord>(&(*line))) {
+        const Metrics::Scope scope{metrics, Metrics::Stage::Discover};
+        collector.add(*record);
+        records.push_back(std::move(*record));
+      }
+    }
+    discovered = collector.getKeys();
+  }
+
+  Columnar::ColumnarWriter columnar{*writer, keys.empty() ? discovered : keys};
+  for (const auto &record : records)
+    columnar.write(record);
+  while (auto line = reader->getItem()) {
+    if (const auto record = std::get_if<GFF::GFFRecord>(&(*line)))
+      columnar.write(*record);
   }
+  columnar.finish();
+}
+
+void GFF::gffiles_to_tsv(const vector<string> &inputs,
+                         std::unique_ptr<std::ostream> &writer,
+                         const string &missing, const string &empty,
+                         const vector<string> &keys, size_t threads) {
+  const auto columns = keys.empty() ? merge_keys(inputs, threads) : keys;
+
+  GFF::TSVWriter{*writer, columns, missing, empty}.writeHeader("file\t");
+  concat_parallel(inputs, *writer, threads,
+                  [&](const string &input, std::ostream &output) {
+                    GFF::GFFReader reader{input};
+                    reader.setMetrics(metrics);
+                    GFF::TSVWriter tsv{output, columns, missing, empty};
+                    tsv.setMetrics(metrics);
+                    const auto prefix = input + "\t";
+                    while (auto line = reader.getItem()) {
+                      if (const auto record =
+                              std::get_if<GFF::GFFRecord>(&(*line)))
+                        tsv.write(*record, prefix);
+                    }
+                  });
+}
+
+void GFF::gffiles_to_json(const vector<string> &inputs,
+                          std::unique_ptr<std::ostream> &writer,
+                          size_t threads) {
+  concat_parallel(inputs, *writer, threads,
+                  [](const string &input, std::ostream &output) {
+                    GFF::GFFReader reader{input};
+                    reader.setMetrics(metrics);
+                    GFF::NDJSONWriter json{output};
+                    json.setMetrics(metrics);
+                    json.setFile(input);
+                    while (auto line = reader.getItem())
+                      json.write(*line);
+                  });
+}
+
+void GFF::gffile_to_gtf(std::unique_ptr<GFF::GFFReader> &reader,
+                        std::unique_ptr<std::ostream> &writer, bool comments,
+                        size_t threads) {
+  GFF::GTFConverter converter{threads};
+  converter.setComments(comments);
+  converter.setMetrics(metrics);
+  converter.convert(*reader, *writer);
 }
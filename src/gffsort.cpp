@@ -0,0 +1,116 @@
+#include <hkl/gffmerge.hpp>
+#include <hkl/gffsort.hpp>
+
+#include <iostream>
+#include <stdexcept>
+
+using std::string;
+
+using namespace HKL;
+
+using std::runtime_error;
+
+int main(int argc, char *argv[]) {
+  GFF::SortParameters args{};
+
+  if (args.parse(argc, argv))
+    return 1;
+
+  const auto inputs = args.getInput();
+
+  // An output that is also an input is only replaced once it has been read.
+  std::unique_ptr<GFF::OutputFile> output{nullptr};
+  std::unique_ptr<GFF::DescriptorStream> standard_output{nullptr};
+  if (const auto file_name = args.getOutput())
+    output = std::make_unique<GFF::OutputFile>(*file_name, inputs);
+  else
+    standard_output = std::make_unique<GFF::DescriptorStream>(STDOUT_FILENO);
+  auto &writer = output ? output->get() : *standard_output;
+
+  if (args.isMerge()) {
+    GFF::GFFMerger merger{inputs};
+    if (const auto tag = args.getTag())
+      merger.setTag(*tag);
+    merger.merge(writer);
+    if (output)
+      output->commit();
+    else
+      standard_output->finish();
+    return 0;
+  }
+
+  GFF::GFFSorter sorter{args.getMemory(), args.getThreads(),
+                        args.getDirectory().value_or(
+                            std::filesystem::temp_directory_path().string())};
+
+  std::unique_ptr<std::istream> file{nullptr};
+  if (!inputs.empty()) {
+    file = std::make_unique<std::ifstream>(inputs.front(), std::ios::binary);
+    if (!*file)
+      throw runtime_error{"Cannot open file '" + inputs.front() + "'"};
+  }
+
+  sorter.sort(file ? *file : std::cin, writer);
+  if (output)
+    output->commit();
+  else
+    standard_output->finish();
+  return 0;
+}
+
+bool GFF::SortParameters::parse(int argc, char *argv[]) {
+  Args::Arguments args{"GFFSort"};
+
+  args.addMulti("input",
+                "Input file in GFF format, standard input if not given. "
+                "Several inputs require --merge",
+                'i');
+  args.addArgument("output", "Output file, standard output if not given", 'o');
+  args.addArgument("memory",
+                   "Memory budget in MiB for sorting in memory; larger "
+                   "inputs are sorted in runs spilled to temporary files. 0 "
+                   "keeps everything in memory.",
+                   'b', "1024");
+  args.addArgument("threads", "Number of runs sorted at once, 0 for all cores",
+                   't', "0");
+  args.addArgument("temp", "Directory for temporary runs", 'd');
+  args.addSwitch("merge",
+                 "Merge inputs that are already sorted, holding one line of "
+                 "each. Inputs are read twice, first for the order of their "
+                 "sequences, and may be gzip or BGZF compressed",
+                 'm');
+  args.addArgument("tag",
+                   "With --merge, add this attribute with the input file name "
+                   "to every record",
+                   'g');
+
+  if (args.parse(argc, argv))
+    return 1;
+
+  this->input = args.getIterable("input");
+  this->output = args.getValue("output");
+  this->directory = args.getValue("temp");
+  this->merge = args.isSet("merge");
+  this->tag = args.getValue("tag");
+
+  if (this->merge && this->input.empty())
+    throw runtime_error{"Merging requires input files"};
+  if (!this->merge && this->input.size() > 1)
+    throw runtime_error{"Several inputs are only merged, use --merge"};
+  if (this->tag && !this->merge)
+    throw runtime_error{"Only --merge takes --tag"};
+
+  if (const auto memory = StringFormat::str_to_int(*args.getValue("memory"));
+      memory && *memory >= 0)
+    this->memory = static_cast<size_t>(*memory) << 20;
+  else
+    throw runtime_error{"Memory budget must be a non-negative number of MiB"};
+
+  if (const auto threads = StringFormat::str_to_int(*args.getValue("threads"));
+      threads && *threads >= 0)
+    this->threads = static_cast<size_t>(*threads);
+  else
+    throw runtime_error{"Number of threads must be a non-negative number"};
+
+  return 0;
+}
@@ -2,14 +2,25 @@
 // #include "dogitoys.h"
 
 #include <pybind11/iostream.h>
+#include <pybind11/numpy.h>
 #include <pybind11/operators.h>
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
 // #include <exception>
 
+#include "hkl/annotationstore.hpp"
+#include "hkl/columnar.hpp"
 #include "hkl/gff.hpp"
+#include "hkl/gffgraph.hpp"
+#include "hkl/gffmerge.hpp"
+#include "hkl/gffsort.hpp"
+#include "hkl/gtf.hpp"
+#include "hkl/motif.hpp"
 #include "hkl/region.hpp"
 #include "hkl/regionseq.hpp"
+#include "hkl/snapshot.hpp"
+#include "hkl/tabix.hpp"
+#include "hkl/translate.hpp"
 
 namespace py = pybind11;
 using namespace pybind11::literals;
@@ -19,6 +30,32 @@ using namespace HKL;
 using std::ifstream;
 using std::string;
 
+// Buffers exported by each RegionSeq. A view points into the sequence
+// string, so setSeq() is refused while any view of that object is alive.
+// Only touched with the GIL held.
+static std::unordered_map<const RegionSeq *, size_t> regionseq_exports{};
+
+static int regionseq_getbuffer(PyObject *obj, Py_buffer *view, int flags) {
+  if (flags & PyBUF_WRITABLE) {
+    PyErr_SetString(PyExc_BufferError, "RegionSeq buffers are read-only");
+    return -1;
+  }
+  const auto &self = py::handle(obj).cast<const RegionSeq &>();
+  const auto &seq = self.getSeq();
+  if (PyBuffer_FillInfo(view, obj, const_cast<char *>(seq.data()),
+                        static_cast<Py_ssize_t>(seq.size()), 1, flags))
+    return -1;
+  ++regionseq_exports[&self];
+  return 0;
+}
+
+static void regionseq_releasebuffer(PyObject *obj, Py_buffer *) {
+  const auto &self = py::handle(obj).cast<const RegionSeq &>();
+  if (const auto found = regionseq_exports.find(&self);
+      found != regionseq_exports.end() && !--found->second)
+    regionseq_exports.erase(found);
+}
+
 PYBIND11_MODULE(pyHKL, m) {
   py::register_exception<RegionError>(m, "RegionError");
 
@@ -175,7 +212,8 @@ PYBIND11_MODULE(pyHKL, m) {
       .def("__hash__", [](const Region &a) { return std::hash<Region>{}(a); })
       .def("__len__", [](const Region &a) { return a.getLength(); });
 
-  py::class_<RegionSeq>(m, "RegionSeq")
+  py::class_<RegionSeq> regionseq(m, "RegionSeq", py::buffer_protocol());
+  regionseq
 
       // Constructors
       .def(py::init<>())
@@ -188,7 +226,15 @@ PYBIND11_MODULE(pyHKL, m) {
       .def(py::self < py::self)
 
       .def("setName", &RegionSeq::setName, "name"_a)
-      .def("setSeq", &RegionSeq::setSeq, "seq"_a, "loc"_a = Region())
+      .def(
+          "setSeq",
+          [](RegionSeq &self, string seq, Region loc) {
+            if (regionseq_exports.count(&self))
+              throw py::buffer_error{
+                  "RegionSeq cannot be modified while a buffer is exported"};
+            self.setSeq(std::move(seq), std::move(loc));
+          },
+          "seq"_a, "loc"_a = Region())
       .def("setLoc", &RegionSeq::setLoc, "loc"_a)
       .def("setChrom", &RegionSeq::setChrom, "chrom"_a)
       .def("setRange", py::overload_cast<int, int>(&RegionSeq::setRange),
@@ -224,7 +270,23 @@ PYBIND11_MODULE(pyHKL, m) {
            "loc"_a = false)
 
       .def("countGC", &RegionSeq::countGC)
-      .def("calcGCRatio", &RegionSeq::calcGCRatio);
+      .def("calcGCRatio", &RegionSeq::calcGCRatio)
+
+      .def("getCodes",
+           [](const RegionSeq &self) {
+             py::array_t<uint8_t> result(self.getSeq().size());
+             auto output = result.mutable_data();
+             py::gil_scoped_release release;
+             self.encode(output);
+             return result;
+           })
+      .def_static("encodeBase", &RegionSeq::encodeBase, "base"_a);
+
+  // Read-only, zero-copy view of the sequence bytes. The slots are set by
+  // hand instead of def_buffer() so that releases can be counted.
+  auto regionseq_type = reinterpret_cast<PyHeapTypeObject *>(regionseq.ptr());
+  regionseq_type->as_buffer.bf_getbuffer = regionseq_getbuffer;
+  regionseq_type->as_buffer.bf_releasebuffer = regionseq_releasebuffer;
 
   py::class_<FASTAReader>(m, "FASTAReader")
       // Constructors
@@ -234,8 +296,54 @@ PYBIND11_MODULE(pyHKL, m) {
       .def("close", &FASTAReader::close)
       .def("good", &FASTAReader::good)
       .def("getSeq", &FASTAReader::getSeq)
+      .def("getMasks", &FASTAReader::getMasks)
       .def("readFile", &FASTAReader::readFile, "upper"_a = false)
-      .def("readSeq", &FASTAReader::readSeq, "upper"_a = false);
+      .def("readSeq", &FASTAReader::readSeq, "upper"_a = false,
+           "masks"_a = false);
+
+  py::class_<MaskScanner>(m, "MaskScanner")
+      .def(py::init<>())
+      .def(py::init<string, int>(), "chrom"_a, "offset"_a = 1)
+      .def_static("scanSeq", &MaskScanner::scanSeq, "seq"_a)
+      .def("scan", py::overload_cast<const string &>(&MaskScanner::scan),
+           "seq"_a)
+      .def("finish", &MaskScanner::finish)
+      .def("getChrom", &MaskScanner::getChrom)
+      .def("getSoftMasked", &MaskScanner::getSoftMasked)
+      .def("getGaps", &MaskScanner::getGaps)
+      .def("getTrack", &MaskScanner::getTrack)
+      .def("__len__", &MaskScanner::size);
+
+  py::class_<Motif::MotifHit>(m, "MotifHit")
+      .def_readonly("loc", &Motif::MotifHit::loc)
+      .def_readonly("pattern", &Motif::MotifHit::pattern)
+      .def("__str__", [](const Motif::MotifHit &a) { return a.str(); })
+      .def("__repr__", [](const Motif::MotifHit &a) {
+        return "<HKL.MotifHit " + a.str() + ">";
+      });
+
+  py::class_<Motif::MotifSearch>(m, "MotifSearch")
+      .def(py::init<>())
+      .def(py::init<const vector<string> &, bool, size_t>(), "patterns"_a,
+           "reverse"_a = false, "max_expansion"_a = 4096)
+      .def("addPattern", &Motif::MotifSearch::addPattern, "pattern"_a)
+      .def("build", &Motif::MotifSearch::build)
+      .def("isBuilt", &Motif::MotifSearch::isBuilt)
+      .def("getPattern", &Motif::MotifSearch::getPattern, "id"_a)
+      .def("getPatterns", &Motif::MotifSearch::getPatterns)
+      .def("__len__", &Motif::MotifSearch::size)
+      .def("scan",
+           py::overload_cast<const RegionSeq &>(&Motif::MotifSearch::scan,
+                                                py::const_),
+           "seq"_a)
+      .def("scan",
+           py::overload_cast<const RegionSeq &, const Region &>(
+               &Motif::MotifSearch::scan, py::const_),
+           "seq"_a, "loc"_a)
+      .def("scan",
+           py::overload_cast<const vector<RegionSeq> &, size_t>(
+               &Motif::MotifSearch::scan, py::const_),
+           "seqs"_a, "threads"_a = 0, py::call_guard<py::gil_scoped_release>());
 
   using namespace GFF;
 
@@ -269,13 +377,346 @@ PYBIND11_MODULE(pyHKL, m) {
       .def("getPhase", &GFFRecord::getPhase)
       .def("getKeys", &GFFRecord::getKeys);
 
+  py::class_<Translate::GeneticCode>(m, "GeneticCode")
+      .def(py::init<int>(), "table"_a = 1)
+      .def("getTable", &Translate::GeneticCode::getTable)
+      .def("translate",
+           py::overload_cast<const string &, bool>(
+               &Translate::GeneticCode::translate, py::const_),
+           "seq"_a, "to_stop"_a = false);
+
+  py::class_<Translate::Transcript>(m, "Transcript")
+      .def_readonly("id", &Translate::Transcript::id)
+      .def_readonly("seqid", &Translate::Transcript::seqid)
+      .def_readonly("phase", &Translate::Transcript::phase)
+      .def_readonly("segments", &Translate::Transcript::segments)
+      .def_readonly("cds", &Translate::Transcript::cds)
+      .def_readonly("protein", &Translate::Transcript::protein)
+      .def("getStrand",
+           [](const Translate::Transcript &self) {
+             return self.strand ? string(1, self.strand) : string();
+           })
+      .def("getLoc", &Translate::Transcript::getLoc);
+
+  m.def("translateCDS", &Translate::translate_cds, "records"_a, "seqs"_a,
+        "table"_a = 1, "threads"_a = 0,
+        py::call_guard<py::gil_scoped_release>());
+
   py::class_<GFFComment>(m, "GFFComment")
       .def(py::init<string>(), "line"_a)
       .def("__str__", [](const GFFComment &a) { return a.str(); })
       .def("isComment", &GFFComment::isComment)
       .def("isRecord", &GFFComment::isRecord);
 
+  py::class_<GFFFilter>(m, "GFFFilter")
+      .def(py::init<>())
+      .def_readwrite("seqids", &GFFFilter::seqids)
+      .def_readwrite("types", &GFFFilter::types)
+      .def_readwrite("sources", &GFFFilter::sources)
+      .def_readwrite("first", &GFFFilter::first)
+      .def_readwrite("last", &GFFFilter::last)
+      .def_readwrite("strand", &GFFFilter::strand)
+      .def_readwrite("attributes", &GFFFilter::attributes)
+      .def_readwrite("comments", &GFFFilter::comments)
+      .def("isEmpty", &GFFFilter::isEmpty);
+
   py::class_<GFFReader>(m, "GFFReader")
       .def(py::init<string>(), "file_name"_a)
-      .def("getItem", &GFFReader::getItem, "skip"_a = "");
+      .def(py::init<string, GFFFilter>(), "file_name"_a, "filter"_a)
+      .def("setFilter", &GFFReader::setFilter, "filter"_a)
+      .def("getItem", &GFFReader::getItem, "skip"_a = "")
+      .def("hasFASTA", &GFFReader::hasFASTA)
+      .def("readSeq", &GFFReader::readSeq, "upper"_a = false)
+      .def("readSequences", &GFFReader::readSequences, "upper"_a = false);
+
+  py::class_<GFFParallelReader>(m, "GFFParallelReader")
+      .def(py::init<string, size_t, size_t, size_t, GFFFilter>(),
+           "file_name"_a, "threads"_a = 0,
+           "block"_a = GFFParallelReader::default_block, "depth"_a = 0,
+           "filter"_a = GFFFilter{})
+      .def("getItem", &GFFParallelReader::getItem,
+           py::call_guard<py::gil_scoped_release>())
+      .def("getBatch", &GFFParallelReader::getBatch,
+           py::call_guard<py::gil_scoped_release>());
+
+  py::class_<GFFIndexedReader>(m, "GFFIndexedReader")
+      .def(py::init<string>(), "file_name"_a)
+      .def(py::init<string, string>(), "file_name"_a, "index_name"_a)
+      .def("getSeqIDs", &GFFIndexedReader::getSeqIDs)
+      .def("fetch", &GFFIndexedReader::fetch, "loc"_a)
+      .def("rewind", &GFFIndexedReader::rewind)
+      .def("getItem", &GFFIndexedReader::getItem)
+      .def("query", &GFFIndexedReader::query, "loc"_a,
+           py::call_guard<py::gil_scoped_release>());
+
+  py::class_<GFFSorter>(m, "GFFSorter")
+      .def(py::init([](size_t memory, size_t threads, const string &directory) {
+             return GFFSorter{memory, threads,
+                              directory.empty()
+                                  ? std::filesystem::temp_directory_path()
+                                  : std::filesystem::path{directory}};
+           }),
+           "memory"_a = GFFSorter::default_memory, "threads"_a = 0,
+           "directory"_a = "")
+      .def("sort",
+           py::overload_cast<const string &, const string &>(&GFFSorter::sort),
+           "input"_a, "output"_a, py::call_guard<py::gil_scoped_release>())
+      .def("getRuns", &GFFSorter::getRuns);
+
+  py::class_<GFFMerger>(m, "GFFMerger")
+      .def(py::init<vector<string>>(), "file_names"_a)
+      .def("setTag", &GFFMerger::setTag, "key"_a)
+      .def(
+          "merge",
+          [](GFFMerger &merger, const string &output) {
+            DescriptorStream stream{output};
+            merger.merge(stream);
+            stream.finish();
+          },
+          "output"_a, py::call_guard<py::gil_scoped_release>());
+
+  py::class_<GTFConverter>(m, "GTFConverter")
+      .def(py::init<size_t, size_t, size_t>(), "threads"_a = 0,
+           "batch"_a = GTFConverter::default_batch, "depth"_a = 0)
+      .def("setComments", &GTFConverter::setComments, "comments"_a)
+      .def(
+          "convert",
+          [](const GTFConverter &converter, const string &input,
+             const string &output) {
+            DescriptorStream stream{output};
+            converter.convert(input, stream);
+            stream.finish();
+          },
+          "input"_a, "output"_a, py::call_guard<py::gil_scoped_release>());
+
+  py::class_<GFFFeatureGraph::GeneSummary>(m, "GeneSummary")
+      .def_readonly("gene", &GFFFeatureGraph::GeneSummary::gene)
+      .def_readonly("span", &GFFFeatureGraph::GeneSummary::span)
+      .def_readonly("transcripts", &GFFFeatureGraph::GeneSummary::transcripts)
+      .def_readonly("exons", &GFFFeatureGraph::GeneSummary::exons)
+      .def_readonly("cds_length", &GFFFeatureGraph::GeneSummary::cds_length);
+
+  py::class_<GFFFeatureGraph>(m, "GFFFeatureGraph")
+      .def(py::init<string>(), "file_name"_a)
+      .def(py::init<vector<GFFRecord>>(), "records"_a)
+      .def("size", &GFFFeatureGraph::size)
+      .def("__len__", &GFFFeatureGraph::size)
+      .def("find", &GFFFeatureGraph::find, "id"_a)
+      .def("getRecord", &GFFFeatureGraph::getRecord, "node"_a)
+      .def("getRoots", &GFFFeatureGraph::getRoots)
+      .def("getMissingParents", &GFFFeatureGraph::getMissingParents)
+      .def(
+          "getChildren",
+          [](const GFFFeatureGraph &self, GFFFeatureGraph::node_t node) {
+            const auto nodes = self.getChildren(node);
+            return vector<GFFFeatureGraph::node_t>(nodes.begin(), nodes.end());
+          },
+          "node"_a)
+      .def(
+          "getParents",
+          [](const GFFFeatureGraph &self, GFFFeatureGraph::node_t node) {
+            const auto nodes = self.getParents(node);
+            return vector<GFFFeatureGraph::node_t>(nodes.begin(), nodes.end());
+          },
+          "node"_a)
+      .def("getSubtree", &GFFFeatureGraph::getSubtree, "node"_a)
+      .def("getSubtreeRecords", &GFFFeatureGraph::getSubtreeRecords, "node"_a)
+      .def("summarize",
+           py::overload_cast<GFFFeatureGraph::node_t, const string &,
+                             const string &>(&GFFFeatureGraph::summarize,
+                                             py::const_),
+           "gene"_a, "exon_type"_a = "exon", "cds_type"_a = "CDS")
+      .def("summarizeGenes",
+           py::overload_cast<const vector<string> &, size_t>(
+               &GFFFeatureGraph::summarize, py::const_),
+           "gene_types"_a = vector<string>{"gene", "ncRNA_gene", "pseudogene"},
+           "threads"_a = 0, py::call_guard<py::gil_scoped_release>());
+
+  py::class_<AnnotationFilter>(m, "AnnotationFilter")
+      .def(py::init<vector<string>, vector<string>>(),
+           "types"_a = vector<string>{}, "sources"_a = vector<string>{})
+      .def_readwrite("types", &AnnotationFilter::types)
+      .def_readwrite("sources", &AnnotationFilter::sources);
+
+  py::class_<AnnotationStore>(m, "AnnotationStore")
+      .def(py::init<string>(), "file_name"_a)
+      .def(py::init<vector<GFFRecord>>(), "records"_a)
+      .def("size", &AnnotationStore::size)
+      .def("__len__", &AnnotationStore::size)
+      .def("getRecord", &AnnotationStore::getRecord, "index"_a)
+      .def("getRegion", &AnnotationStore::getRegion, "index"_a)
+      .def("getSeqIDs", &AnnotationStore::getSeqIDs)
+      .def("query",
+           py::overload_cast<const Region &, const AnnotationFilter &>(
+               &AnnotationStore::query, py::const_),
+           "loc"_a, "filter"_a = AnnotationFilter{})
+      .def("query",
+           py::overload_cast<string, const AnnotationFilter &>(
+               &AnnotationStore::query, py::const_),
+           "loc"_a, "filter"_a = AnnotationFilter{})
+      .def("query",
+           py::overload_cast<const vector<Region> &, const AnnotationFilter &,
+                             size_t>(&AnnotationStore::query, py::const_),
+           "locs"_a, "filter"_a = AnnotationFilter{}, "threads"_a = 0,
+           py::call_guard<py::gil_scoped_release>())
+      .def("getRecords",
+           py::overload_cast<const vector<size_t> &>(
+               &AnnotationStore::getRecords, py::const_),
+           "indices"_a);
+
+  py::class_<AnnotationSnapshot> snapshot(m, "AnnotationSnapshot");
+  py::class_<AnnotationSnapshot::Source>(snapshot, "Source")
+      .def_readonly("size", &AnnotationSnapshot::Source::size)
+      .def_readonly("mtime", &AnnotationSnapshot::Source::mtime)
+      .def_readonly("crc", &AnnotationSnapshot::Source::crc)
+      .def_static("of", &AnnotationSnapshot::Source::of, "file_name"_a,
+                  "checksum"_a = true);
+  snapshot.def(py::init<string, bool>(), "image"_a, "verify"_a = false)
+      .def_static("save",
+                  py::overload_cast<const AnnotationStore &, const string &,
+                                    const AnnotationSnapshot::Source &>(
+                      &AnnotationSnapshot::save),
+                  "store"_a, "image"_a, "source"_a)
+      .def_static("save",
+                  py::overload_cast<const AnnotationStore &, const string &>(
+                      &AnnotationSnapshot::save),
+                  "store"_a, "image"_a)
+      .def_static("read_source", &AnnotationSnapshot::read_source, "image"_a)
+      .def_static("is_fresh", &AnnotationSnapshot::is_fresh, "image"_a,
+                  "source"_a, "checksum"_a = true)
+      .def_static("load", &AnnotationSnapshot::load, "source"_a, "image"_a,
+                  "checksum"_a = true)
+      .def("getSource", &AnnotationSnapshot::getSource)
+      .def("size", &AnnotationSnapshot::size)
+      .def("__len__", &AnnotationSnapshot::size)
+      .def("getLine", &AnnotationSnapshot::getLine, "index"_a)
+      .def("getRecord", &AnnotationSnapshot::getRecord, "index"_a)
+      .def("getRegion", &AnnotationSnapshot::getRegion, "index"_a)
+      .def("getSeqIDs", &AnnotationSnapshot::getSeqIDs)
+      .def("query",
+           py::overload_cast<const Region &, const AnnotationFilter &>(
+               &AnnotationSnapshot::query, py::const_),
+           "loc"_a, "filter"_a = AnnotationFilter{})
+      .def("query",
+           py::overload_cast<string, const AnnotationFilter &>(
+               &AnnotationSnapshot::query, py::const_),
+           "loc"_a, "filter"_a = AnnotationFilter{})
+      .def("query",
+           py::overload_cast<const vector<Region> &, const AnnotationFilter &,
+                             size_t>(&AnnotationSnapshot::query, py::const_),
+           "locs"_a, "filter"_a = AnnotationFilter{}, "threads"_a = 0,
+           py::call_guard<py::gil_scoped_release>())
+      .def("getRecords", &AnnotationSnapshot::getRecords, "indices"_a);
+
+  py::enum_<Columnar::ColumnType>(m, "ColumnType")
+      .value("String", Columnar::ColumnType::String)
+      .value("Int32", Columnar::ColumnType::Int32)
+      .value("Float64", Columnar::ColumnType::Float64);
+
+  // Columns are gathered from the mapped chunks into one array each: values
+  // of Int32 and Float64 columns, dictionary codes of String columns. The
+  // file has a dictionary per chunk; they are merged into one, in order of
+  // first appearance, with codes renumbered to match.
+  const auto column_index = [](const Columnar::ColumnarFile &self,
+                               const string &name) {
+    if (const auto column = self.findColumn(name))
+      return *column;
+    throw py::key_error{"Unknown column '" + name + "'"};
+  };
+
+  const auto gather = [](const Columnar::ColumnarFile &self, size_t column,
+                         auto *output) {
+    using value_t = std::remove_pointer_t<decltype(output)>;
+    for (size_t chunk = 0; chunk < self.getChunks(); ++chunk) {
+      const auto size = self.getChunkSize(chunk);
+      std::memcpy(output, self.getChunkValues(chunk, column),
+                  size * sizeof(value_t));
+      output += size;
+    }
+  };
+
+  const auto merge = [](const Columnar::ColumnarFile &self, size_t column,
+                        uint32_t *output) {
+    vector<string> dictionary;
+    std::unordered_map<string_view, uint32_t> codes;
+    vector<uint32_t> renumber;
+    for (size_t chunk = 0; chunk < self.getChunks(); ++chunk) {
+      renumber.clear();
+      for (size_t code = 0; code < self.getDictionarySize(chunk, column);
+           ++code) {
+        const auto value = self.getDictionary(chunk, column, code);
+        const auto next = static_cast<uint32_t>(dictionary.size());
+        const auto [item, inserted] = codes.try_emplace(value, next);
+        if (inserted) dictionary.emplace_back(value);
+        renumber.push_back(item->second);
+      }
+      if (!output) continue;
+      const auto size = self.getChunkSize(chunk);
+      const auto local =
+          static_cast<const uint32_t *>(self.getChunkValues(chunk, column));
+      for (size_t row = 0; row < size; ++row)
+        output[row] = local[row] < renumber.size() ? renumber[local[row]] : 0;
+      output += size;
+    }
+    return dictionary;
+  };
+
+  py::class_<Columnar::ColumnarFile>(m, "ColumnarFile")
+      .def(py::init<string>(), "file_name"_a)
+      .def("getRows", &Columnar::ColumnarFile::getRows)
+      .def("getChunks", &Columnar::ColumnarFile::getChunks)
+      .def("getNames",
+           [](const Columnar::ColumnarFile &self) {
+             vector<string> names;
+             for (const auto &column : self.getColumns())
+               names.push_back(column.name);
+             return names;
+           })
+      .def("getType",
+           [column_index](const Columnar::ColumnarFile &self,
+                          const string &name) {
+             return self.getColumns()[column_index(self, name)].type;
+           },
+           "name"_a)
+      .def("getColumn",
+           [column_index, gather, merge](const Columnar::ColumnarFile &self,
+                                         const string &name) -> py::array {
+             const auto column = column_index(self, name);
+             switch (self.getColumns()[column].type) {
+             case Columnar::ColumnType::Int32: {
+               py::array_t<int32_t> result(self.getRows());
+               gather(self, column, result.mutable_data());
+               return std::move(result);
+             }
+             case Columnar::ColumnType::Float64: {
+               py::array_t<double> result(self.getRows());
+               gather(self, column, result.mutable_data());
+               return std::move(result);
+             }
+             default: {
+               py::array_t<uint32_t> result(self.getRows());
+               merge(self, column, result.mutable_data());
+               return std::move(result);
+             }
+             }
+           },
+           "name"_a)
+      .def("getValid",
+           [column_index](const Columnar::ColumnarFile &self,
+                          const string &name) {
+             const auto column = column_index(self, name);
+             py::array_t<bool> result(self.getRows());
+             auto output = result.mutable_data();
+             for (size_t row = 0; row < self.getRows(); ++row)
+               output[row] = !self.isNull(column, row);
+             return result;
+           },
+           "name"_a)
+      .def("getDictionary",
+           [column_index, merge](const Columnar::ColumnarFile &self,
+                                 const string &name) {
+             const auto column = column_index(self, name);
+             return merge(self, column, nullptr);
+           },
+           "name"_a);
 }
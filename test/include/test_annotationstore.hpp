@@ -0,0 +1,28 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <agizmo/evaluation.hpp>
+
+#include <hkl/annotationstore.hpp>
+#include <hkl/snapshot.hpp>
+
+namespace TestHKL::TestAnnotationStore {
+
+using std::string;
+using std::to_string;
+using std::vector;
+
+using namespace AGizmo;
+using namespace Evaluation;
+
+using HKL::Region;
+using HKL::GFF::AnnotationSnapshot;
+using HKL::GFF::AnnotationStore;
+using HKL::GFF::GFFRecord;
+
+Stats check_annotation_store(bool verbose);
+Stats check_annotation_snapshot(bool verbose);
+
+}  // namespace TestHKL::TestAnnotationStore
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <agizmo/evaluation.hpp>
+
+#include <hkl/columnar.hpp>
+
+namespace TestHKL::TestColumnar {
+
+using std::string;
+using std::to_string;
+using std::vector;
+
+using namespace AGizmo;
+using namespace Evaluation;
+
+using HKL::Columnar::ColumnarFile;
+using HKL::Columnar::ColumnarWriter;
+using HKL::GFF::GFFReader;
+using HKL::GFF::GFFRecord;
+
+Stats check_columnar(bool verbose);
+
+}  // namespace TestHKL::TestColumnar
@@ -8,6 +8,8 @@
 #include <agizmo/evaluation.hpp>
 
 #include <hkl/gff.hpp>
+#include <hkl/gffwriter.hpp>
+#include <hkl/metrics.hpp>
 
 namespace TestHKL::TestGFF {
 
@@ -16,6 +18,8 @@ using std::string;
 using namespace AGizmo;
 using namespace Evaluation;
 using namespace HKL::GFF;
+using HKL::Metrics;
+using HKL::StringPool;
 
 using std::visit;
 
@@ -68,5 +72,14 @@ class GFFTest : public BaseTest<InputGFF, OutputGFF> {
 };
 
 Stats check_gffreader(bool verbose);
+Stats check_gffviewreader(bool verbose);
+Stats check_gffparallelreader(bool verbose);
+Stats check_gffattributes(bool verbose);
+Stats check_gfffilter(bool verbose);
+Stats check_percent(bool verbose);
+Stats check_ndjson(bool verbose);
+Stats check_writers(bool verbose);
+Stats check_metrics(bool verbose);
+Stats check_gfffasta(bool verbose);
 
 }  // namespace TestHKL::TestGFF
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <agizmo/evaluation.hpp>
+
+#include <hkl/gffgraph.hpp>
+
+namespace TestHKL::TestGFFGraph {
+
+using std::string;
+using std::vector;
+
+using namespace AGizmo;
+using namespace Evaluation;
+
+using HKL::GFF::GFFFeatureGraph;
+using HKL::GFF::GFFRecord;
+
+Stats check_feature_graph(bool verbose);
+
+}  // namespace TestHKL::TestGFFGraph
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <agizmo/evaluation.hpp>
+
+#include <hkl/bgzf.hpp>
+#include <hkl/gffmerge.hpp>
+#include <hkl/gffsort.hpp>
+
+namespace TestHKL::TestGFFSort {
+
+using std::string;
+using std::vector;
+
+using namespace AGizmo;
+using namespace Evaluation;
+
+using HKL::GFF::GFFMerger;
+using HKL::GFF::GFFRecord;
+using HKL::GFF::GFFSorter;
+using HKL::GFF::LoserTree;
+
+Stats check_gffsort(bool verbose);
+Stats check_gffmerge(bool verbose);
+
+}  // namespace TestHKL::TestGFFSort
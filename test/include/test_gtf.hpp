@@ -0,0 +1,21 @@
+#pragma once
+
+#include <string>
+
+#include <agizmo/evaluation.hpp>
+
+#include <hkl/gtf.hpp>
+
+namespace TestHKL::TestGTF {
+
+using std::string;
+
+using namespace AGizmo;
+using namespace Evaluation;
+
+using HKL::GFF::GFFReader;
+using HKL::GFF::GTFConverter;
+
+Stats check_gtf(bool verbose);
+
+}  // namespace TestHKL::TestGTF
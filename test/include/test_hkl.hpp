@@ -1,9 +1,17 @@
 #pragma once
 
 #include "agizmo/evaluation.hpp"
+#include "test_annotationstore.hpp"
+#include "test_columnar.hpp"
 #include "test_gff.hpp"
+#include "test_gffgraph.hpp"
+#include "test_gffsort.hpp"
+#include "test_gtf.hpp"
+#include "test_motif.hpp"
 #include "test_region.hpp"
 #include "test_regionseq.hpp"
+#include "test_tabix.hpp"
+#include "test_translate.hpp"
 
 using namespace AGizmo::Evaluation;
 
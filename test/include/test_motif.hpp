@@ -0,0 +1,25 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <agizmo/evaluation.hpp>
+
+#include <hkl/motif.hpp>
+
+namespace TestHKL::TestMotif {
+
+using std::string;
+using std::vector;
+
+using namespace AGizmo;
+using namespace Evaluation;
+
+using HKL::Region;
+using HKL::RegionSeq;
+using HKL::Motif::MotifHit;
+using HKL::Motif::MotifSearch;
+
+Stats check_motif_search(bool verbose);
+
+}  // namespace TestHKL::TestMotif
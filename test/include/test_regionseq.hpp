@@ -20,6 +20,7 @@ using namespace AGizmo;
 using namespace Evaluation;
 
 using HKL::FASTAReader;
+using HKL::MaskScanner;
 using HKL::Region;
 using HKL::RegionSeq;
 
@@ -126,4 +127,6 @@ class RegionSeqGetSeq : public BaseTest<InputRegionSeqGetSeq, string> {
 Stats check_basic(bool verbose);
 Stats check_get_seq(bool verbose);
 Stats check_fasta_reader(bool verbose);
+Stats check_masks(bool verbose);
+Stats check_codes(bool verbose);
 }  // namespace TestHKL::TestRegionSeq
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <agizmo/evaluation.hpp>
+
+#include <hkl/tabix.hpp>
+
+namespace TestHKL::TestTabix {
+
+using std::string;
+using std::to_string;
+using std::vector;
+
+using namespace AGizmo;
+using namespace Evaluation;
+
+using HKL::Region;
+using HKL::GFF::GFFIndexedReader;
+using HKL::GFF::GFFRecord;
+using HKL::Tabix::Index;
+
+Stats check_tabix(bool verbose);
+
+}  // namespace TestHKL::TestTabix
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <agizmo/evaluation.hpp>
+
+#include <hkl/translate.hpp>
+
+namespace TestHKL::TestTranslate {
+
+using std::string;
+using std::vector;
+
+using namespace AGizmo;
+using namespace Evaluation;
+
+using HKL::RegionSeq;
+using HKL::GFF::GFFRecord;
+using HKL::Translate::GeneticCode;
+using HKL::Translate::Transcript;
+
+Stats check_translate(bool verbose);
+
+}  // namespace TestHKL::TestTranslate
@@ -0,0 +1,226 @@
+#include "test_annotationstore.hpp"
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <random>
+
+AGizmo::Evaluation::Stats
+TestHKL::TestAnnotationStore::check_annotation_store(bool verbose) {
+  Stats result;
+
+  sstream message;
+
+  const auto &test_name = "HKL::GFF::AnnotationStore"s;
+
+  message << "\n~~~ Checking " << test_name << "\n";
+
+  // Overlaps found by scanning every record.
+  const auto expected = [](const AnnotationStore &store, const Region &loc,
+                           const AnnotationStore::Filter &filter) {
+    vector<size_t> hits;
+    for (size_t index = 0; index < store.size(); ++index) {
+      const auto &record = store.getRecord(index);
+      const auto type = record.getType().value_or(".");
+      const auto source = record.getSource().value_or(".");
+      if (record.getSeqID().value_or(".") != loc.getChrom() ||
+          record.getStart() > loc.getLast() ||
+          record.getEnd() < loc.getFirst() ||
+          (loc.getStrand() && record.getStrand() != loc.getStrand()) ||
+          (!filter.types.empty() &&
+           std::find(filter.types.begin(), filter.types.end(), type) ==
+               filter.types.end()) ||
+          (!filter.sources.empty() &&
+           std::find(filter.sources.begin(), filter.sources.end(), source) ==
+               filter.sources.end()))
+        continue;
+      hits.push_back(index);
+    }
+    return hits;
+  };
+
+  std::mt19937 generator{7};
+  const auto random = [&](int low, int high) {
+    return std::uniform_int_distribution<int>{low, high}(generator);
+  };
+
+  vector<GFFRecord> records;
+  for (int index = 0; index < 3000; ++index) {
+    const auto start = random(1, 100000);
+    const auto end = start + (index % 50 ? random(0, 300) : random(0, 20000));
+    records.emplace_back("c" + to_string(index % 3) + "\t" +
+                         (index % 2 ? "a" : "b") + "\t" +
+                         (index % 5 ? "exon" : "gene") + "\t" +
+                         to_string(start) + "\t" + to_string(end) + "\t.\t" +
+                         (index % 4 ? "+" : "-") + "\t.\tID=r" +
+                         to_string(index));
+  }
+  const AnnotationStore store{records};
+
+  const vector<AnnotationStore::Filter> filters{
+      {}, {{"exon"}, {}}, {{"gene"}, {"a"}}, {{"none"}, {}}};
+
+  vector<Region> locs;
+  for (int index = 0; index < 200; ++index) {
+    const auto first = random(1, 110000);
+    locs.emplace_back("c" + to_string(index % 4), first,
+                      first + random(0, 2000),
+                      index % 3 ? string{} : string{"-"});
+  }
+
+  for (const auto &filter : filters) {
+    const auto bulk = store.query(locs, filter, 3);
+    for (size_t index = 0; index < locs.size(); ++index) {
+      ++result;
+      const auto hits = store.query(locs[index], filter);
+      const bool failed = hits != expected(store, locs[index], filter) ||
+                          bulk[index] != hits;
+      result.addFailure(failed);
+      if (verbose || failed)
+        message << locs[index] << ": " << hits.size() << " hits\n";
+    }
+  }
+
+  const AnnotationStore annotation{"test/input/annotation.gff"};
+  ++result;
+  const auto exons = annotation.query("1:65,419-69,100", {{"exon"}, {}});
+  result.addFailure(exons.size() != 4 ||
+                    exons != expected(annotation, Region("1", 65419, 69100),
+                                      {{"exon"}, {}}));
+
+  if (verbose || result.hasFailed()) cout << message.str() << "\n";
+
+  cout << "~~~ " << gen_summary(result, "Checking " + test_name) << endl;
+
+  return result;
+}
+
+AGizmo::Evaluation::Stats
+TestHKL::TestAnnotationStore::check_annotation_snapshot(bool verbose) {
+  Stats result;
+
+  sstream message;
+
+  const auto &test_name = "HKL::GFF::AnnotationSnapshot"s;
+
+  message << "\n~~~ Checking " << test_name << "\n";
+
+  const auto check = [&](bool passed, const string &description) {
+    ++result;
+    result.addFailure(!passed);
+    if (verbose || !passed)
+      message << (passed ? "Passed: " : "Failed: ") << description << "\n";
+  };
+
+  const auto directory = std::filesystem::temp_directory_path();
+  const auto source = (directory / "hkl_test_snapshot.gff").string();
+  const auto image = (directory / "hkl_test_snapshot.bin").string();
+  std::filesystem::copy_file("test/input/annotation.gff", source,
+                             std::filesystem::copy_options::overwrite_existing);
+  std::remove(image.c_str());
+
+  const AnnotationStore store{source};
+  check(!AnnotationSnapshot::is_fresh(image, source), "missing image");
+  const auto snapshot = AnnotationSnapshot::load(source, image);
+  check(AnnotationSnapshot::is_fresh(image, source, true), "fresh image");
+  check(snapshot->size() == store.size() &&
+            snapshot->getSeqIDs() == store.getSeqIDs(),
+        "records and sequences");
+
+  bool same_records{true};
+  for (size_t index = 0; index < store.size(); ++index)
+    same_records = same_records &&
+                   snapshot->getRecord(index).str() ==
+                       store.getRecord(index).str() &&
+                   snapshot->getRegion(index).str() ==
+                       store.getRegion(index).str();
+  check(same_records, "records and regions");
+
+  vector<Region> locs;
+  for (const auto &seqid : store.getSeqIDs())
+    for (int first = 1; first < 300000; first += 7919) {
+      locs.emplace_back(seqid, first, first + 5000);
+      locs.emplace_back(seqid, first, first + 500, "-");
+    }
+  const vector<AnnotationStore::Filter> filters{
+      {}, {{"exon"}, {}}, {{"gene"}, {"ensembl_havana"}}, {{"none"}, {}}};
+  bool same_hits{true};
+  size_t hits{0};
+  for (const auto &filter : filters) {
+    const auto bulk = snapshot->query(locs, filter, 3);
+    for (size_t index = 0; index < locs.size(); ++index) {
+      const auto expected = store.query(locs[index], filter);
+      hits += expected.size();
+      same_hits = same_hits && bulk[index] == expected &&
+                  snapshot->query(locs[index], filter) == expected;
+    }
+  }
+  check(same_hits && hits, "same overlaps as AnnotationStore");
+  check(snapshot->query("1:65,419-69,100", {{"exon"}, {}}).size() == 4,
+        "query string");
+
+  {
+    std::ofstream append{source, std::ios::app};
+    append << "1\tsrc\tgene\t1\t10\t.\t+\t.\tID=extra\n";
+  }
+  check(!AnnotationSnapshot::is_fresh(image, source), "stale image");
+  check(AnnotationSnapshot::load(source, image, true)->size() ==
+                store.size() + 1 &&
+            AnnotationSnapshot::is_fresh(image, source, true),
+        "rebuilt image");
+  {
+    // Same size and modification time, different content.
+    const auto mtime = std::filesystem::last_write_time(source);
+    std::fstream edit{source, std::ios::in | std::ios::out};
+    edit.seekp(-3, std::ios::end);
+    edit.put('R');
+    edit.close();
+    std::filesystem::last_write_time(source, mtime);
+  }
+  check(!AnnotationSnapshot::is_fresh(image, source) &&
+            AnnotationSnapshot::is_fresh(image, source, false),
+        "edit found by checksum");
+  AnnotationSnapshot::load(source, image);
+  check(AnnotationSnapshot::is_fresh(image, source), "edit rebuilt");
+  // The first mapping keeps the image it opened.
+  check(snapshot->size() == store.size(), "replaced image stays mapped");
+  check(AnnotationSnapshot{image, true}.size() == store.size() + 1,
+        "checksum verified");
+
+  {
+    std::fstream corrupt{image,
+                         std::ios::in | std::ios::out | std::ios::binary};
+    corrupt.seekp(200);
+    corrupt.put('\x7f');
+  }
+  bool rejected{false};
+  try {
+    AnnotationSnapshot{image, true};
+  } catch (const std::runtime_error &) {
+    rejected = true;
+  }
+  check(rejected, "corrupt image rejected");
+
+  {
+    std::fstream corrupt{image,
+                         std::ios::in | std::ios::out | std::ios::binary};
+    corrupt.put('X');
+  }
+  rejected = false;
+  try {
+    AnnotationSnapshot{image};
+  } catch (const std::runtime_error &) {
+    rejected = true;
+  }
+  check(rejected && !AnnotationSnapshot::is_fresh(image, source),
+        "not a snapshot");
+
+  std::remove(image.c_str());
+  std::remove(source.c_str());
+
+  if (verbose || result.hasFailed()) cout << message.str() << "\n";
+
+  cout << "~~~ " << gen_summary(result, "Checking " + test_name) << endl;
+
+  return result;
+}
@@ -0,0 +1,114 @@
+#include "test_columnar.hpp"
+
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+
+AGizmo::Evaluation::Stats TestHKL::TestColumnar::check_columnar(
+    bool verbose) {
+  Stats result;
+
+  sstream message;
+
+  const auto &test_name = "HKL::Columnar"s;
+
+  message << "\n~~~ Checking " << test_name << "\n";
+
+  GFFReader reader{"test/input/annotation.gff"};
+  vector<GFFRecord> records;
+  while (const auto item = reader()) {
+    if (const auto record = std::get_if<GFFRecord>(&(*item)))
+      records.push_back(*record);
+  }
+
+  const vector<string> keys{"ID", "Parent", "Name", "Alias", "missing"};
+  auto file_name =
+      (std::filesystem::temp_directory_path() / "hkl_test_columnar-XXXXXX")
+          .string();
+  const auto fd = mkstemp(file_name.data());
+  if (fd == -1) throw std::runtime_error{"Cannot create a temporary file"};
+  close(fd);
+  {
+    std::ofstream output{file_name, std::ios::binary};
+    ColumnarWriter writer{output, keys, 7};
+    for (const auto &record : records) writer.write(record);
+    writer.finish();
+  }
+
+  const ColumnarFile table{file_name};
+
+  ++result;
+  result.addFailure(table.getRows() != records.size() ||
+                    table.size() != 8 + keys.size() ||
+                    table.getChunks() != (records.size() + 6) / 7 ||
+                    table.findColumn("Parent") != 9);
+
+  // Dictionaries are per chunk, so none holds more values than its rows.
+  for (size_t chunk = 0; chunk < table.getChunks(); ++chunk) {
+    for (const auto column : {size_t{0}, size_t{2}, size_t{8}}) {
+      ++result;
+      result.addFailure(table.getDictionarySize(chunk, column) >
+                        table.getChunkSize(chunk));
+    }
+  }
+
+  const auto text = [&](size_t column, size_t row) -> string {
+    const auto value = table.getString(column, row);
+    return value ? string(*value) : "<null>";
+  };
+
+  for (size_t row = 0; row < records.size(); ++row) {
+    const auto &record = records[row];
+    sstream expected, outcome;
+
+    expected << record.getSeqID().value_or("<null>") << "|"
+             << record.getType().value_or("<null>") << "|"
+             << record.getStart() << "|" << record.getEnd() << "|"
+             << (record.getScore() ? to_string(*record.getScore()) : "<null>")
+             << "|"
+             << (record.getStrand() ? string(1, *record.getStrand())
+                                    : "<null>")
+             << "|"
+             << (record.getPhase() ? to_string(*record.getPhase()) : "<null>");
+    outcome << text(0, row) << "|" << text(2, row) << "|"
+            << table.getInt(3, row) << "|" << table.getInt(4, row) << "|"
+            << (table.isNull(5, row) ? "<null>"
+                                     : to_string(table.getDouble(5, row)))
+            << "|" << text(6, row) << "|"
+            << (table.isNull(7, row) ? "<null>"
+                                     : to_string(table.getInt(7, row)));
+
+    for (size_t key = 0; key < keys.size(); ++key) {
+      const auto value = record.get(keys[key]);
+      expected << "|" << (value ? (*value).value_or("") : "<null>");
+      outcome << "|" << text(8 + key, row);
+    }
+
+    ++result;
+    const bool failed = outcome.str() != expected.str();
+    result.addFailure(failed);
+    if (verbose || failed)
+      message << "Outcome:  " << outcome.str()
+              << "\nExpected: " << expected.str() << "\n";
+  }
+
+  std::remove(file_name.c_str());
+
+  ++result;
+  bool rejected{false};
+  try {
+    ColumnarFile invalid{"test/input/annotation.gff"};
+  } catch (const std::runtime_error &) {
+    rejected = true;
+  }
+  result.addFailure(!rejected);
+
+  if (verbose || result.hasFailed()) cout << message.str() << "\n";
+
+  cout << "~~~ " << gen_summary(result, "Checking " + test_name) << endl;
+
+  return result;
+}
@@ -1,5 +1,10 @@
 #include "test_gff.hpp"
 
+#include <filesystem>
+#include <iterator>
+#include <random>
+#include <tuple>
+
 AGizmo::Evaluation::Stats TestHKL::TestGFF::check_gffreader(bool verbose) {
   Stats result;
 
@@ -24,6 +29,819 @@ AGizmo::Evaluation::Stats TestHKL::TestGFF::check_gffreader(bool verbose) {
   return result;
 }
 
+AGizmo::Evaluation::Stats TestHKL::TestGFF::check_gffviewreader(
+    bool verbose) {
+  Stats result;
+
+  sstream message;
+
+  const auto &test_name = "HKL::GFF::GFFViewReader"s;
+
+  message << "\n~~~ Checking " << test_name << "\n";
+
+  GFFReader reader{"test/input/annotation.gff"};
+  GFFViewReader views{"test/input/annotation.gff", 64};
+
+  while (auto item = reader()) {
+    ++result;
+    const auto view = views();
+    if (!view || (*view).index() != (*item).index()) {
+      result.addFailure(true);
+      break;
+    }
+
+    string expected, outcome;
+    if (const auto record = std::get_if<GFFRecord>(&(*item))) {
+      const auto &record_view = std::get<GFFRecordView>(*view);
+      expected = record->str() + "|" + record->get("Name", ".", "");
+      const auto name = record_view.get("Name");
+      outcome = record_view.toRecord().str() + "|" +
+                (name ? (*name).value_or("") : ".");
+    } else {
+      expected = std::get<GFFComment>(*item).str();
+      outcome = std::get<GFFComment>(*view).str();
+    }
+
+    result.addFailure(outcome != expected);
+    if (verbose || outcome != expected)
+      message << "Outcome: " << outcome << "\nExpected: " << expected << "\n";
+  }
+
+  ++result;
+  result.addFailure(views().has_value());
+
+  if (verbose || result.hasFailed()) cout << message.str() << "\n";
+
+  cout << "~~~ " << gen_summary(result, "Checking " + test_name) << endl;
+
+  return result;
+}
+
+AGizmo::Evaluation::Stats TestHKL::TestGFF::check_gffparallelreader(
+    bool verbose) {
+  Stats result;
+
+  sstream message;
+
+  const auto &test_name = "HKL::GFF::GFFParallelReader"s;
+
+  message << "\n~~~ Checking " << test_name << "\n";
+
+  for (const size_t block : {size_t{16}, size_t{100}, size_t{1} << 20}) {
+    GFFReader reader{"test/input/annotation.gff"};
+    GFFParallelReader parallel{"test/input/annotation.gff", 3, block, 2};
+
+    while (auto item = reader()) {
+      ++result;
+      const auto other = parallel();
+      if (!other || (*other).index() != (*item).index()) {
+        result.addFailure(true);
+        message << "Block " << block << ": sequence differs\n";
+        break;
+      }
+
+      string expected, outcome;
+      if (const auto record = std::get_if<GFFRecord>(&(*item))) {
+        expected = record->str();
+        outcome = std::get<GFFRecord>(*other).str();
+      } else {
+        expected = std::get<GFFComment>(*item).str();
+        outcome = std::get<GFFComment>(*other).str();
+      }
+
+      result.addFailure(outcome != expected);
+      if (verbose || outcome != expected)
+        message << "Outcome: " << outcome << "\nExpected: " << expected
+                << "\n";
+    }
+
+    ++result;
+    result.addFailure(parallel().has_value());
+  }
+
+  // What the reader yields on each call until the end: "record", "comment"
+  // or "error".
+  const auto outcomes = [](auto &&reader) {
+    vector<string> steps;
+    while (steps.size() < 100) {
+      try {
+        const auto item = reader();
+        if (!item) break;
+        steps.emplace_back(item->index() ? "record" : "comment");
+      } catch (const std::exception &) {
+        steps.emplace_back("error");
+      }
+    }
+    return steps;
+  };
+
+  string broken;
+  for (int index = 1; index <= 5; ++index)
+    broken += "chr1\t.\tgene\t" + to_string(index) + "\t10\t.\t+\t.\t.\n";
+  broken += "chr1\t.\tgene\tx\t10\t.\t+\t.\tID=b\n##note text\n";
+  broken += "chr1\t.\tgene\t1\t10\t.\t+\n";
+  broken += "chr2\t.\tgene\t1\t10\t.\t+\t.\tID=c\n";
+
+  std::istringstream serial_input{broken};
+  const auto expected = outcomes(GFFReader{serial_input});
+  for (const size_t block :
+       {size_t{8}, size_t{64}, GFFParallelReader::default_block}) {
+    ++result;
+    std::istringstream input{broken};
+    const auto outcome = outcomes(GFFParallelReader{input, 2, block});
+    result.addFailure(outcome != expected);
+    if (verbose || outcome != expected) {
+      message << "Block " << block << " with malformed lines:";
+      for (const auto &step : outcome) message << " " << step;
+      message << "\n";
+    }
+  }
+
+  // Records reach the consumer in the reader's pool, whichever worker
+  // parsed them.
+  ++result;
+  {
+    std::istringstream input{broken};
+    GFFParallelReader parallel{input, 3, 64};
+    size_t records{0};
+    bool shared{true};
+    while (true) {
+      try {
+        const auto item = parallel();
+        if (!item) break;
+        if (const auto record = std::get_if<GFFRecord>(&*item)) {
+          ++records;
+          shared = shared && record->getPool() == parallel.getPool() &&
+                   record->getSeqID() ==
+                       (*parallel.getPool())[record->getSeqIDIndex()];
+        }
+      } catch (const std::exception &) {
+      }
+    }
+    result.addFailure(records != 6 || !shared ||
+                      parallel.getPool()->size() != 3);
+  }
+
+  if (verbose || result.hasFailed()) cout << message.str() << "\n";
+
+  cout << "~~~ " << gen_summary(result, "Checking " + test_name) << endl;
+
+  return result;
+}
+
+AGizmo::Evaluation::Stats TestHKL::TestGFF::check_gffattributes(
+    bool verbose) {
+  Stats result;
+
+  sstream message;
+
+  const auto &test_name = "HKL::GFF::GFFRecord attributes"s;
+
+  message << "\n~~~ Checking " << test_name << "\n";
+
+  GFFReader reader{"test/input/annotation.gff"};
+
+  while (const auto item = reader()) {
+    const auto record = std::get_if<GFFRecord>(&(*item));
+    if (!record) continue;
+
+    auto parsed = *record;
+    parsed.materialize();
+
+    for (const auto &key : parsed.getKeys()) {
+      ++result;
+      const bool failed =
+          record->get(key) != parsed.get(key) ||
+          record->get(key, "?", "!") != parsed.get(key, "?", "!");
+      result.addFailure(failed);
+      if (verbose || failed) message << *record << " [" << key << "]\n";
+    }
+
+    ++result;
+    result.addFailure(record->isMaterialized() || record->has("missing") ||
+                      record->get("missing", "?", "!") != "?");
+
+    ++result;
+    const auto &pool = *reader.getPool();
+    result.addFailure(record->getPool() != reader.getPool() ||
+                      pool.find(record->getType().value_or(".")) !=
+                          record->getTypeIndex() ||
+                      record->getSeqID() != pool[record->getSeqIDIndex()]);
+  }
+
+  // A repeated key keeps its first value whether or not the record is
+  // materialized.
+  ++result;
+  const string fields{"1\t.\tgene\t1\t9\t.\t+\t.\t"};
+  const GFFRecord repeated{fields + "ID=a;Name=x;Name=y"};
+  auto repeated_map = repeated;
+  repeated_map.materialize();
+  const bool first_kept = repeated.get("Name", "") == "x" &&
+                          repeated_map.get("Name", "") == "x" &&
+                          repeated_map.str() == fields + "ID=a;Name=x";
+  result.addFailure(!first_kept);
+  if (verbose || !first_kept)
+    message << "Repeated key: " << repeated_map << "\n";
+
+  // Const records are read from several threads, the first of which parses
+  // the attributes for all.
+  ++result;
+  const GFFRecord concurrent{fields + "ID=c;Name=x;Alias=a,b"};
+  vector<string> seen(8);
+  HKL::Parallel::parallel_for(
+      seen.size(),
+      [&](size_t index) {
+        seen[index] = std::to_string(concurrent.size()) +
+                      concurrent.begin()->first + concurrent.str();
+      },
+      seen.size());
+  const auto copied = concurrent;
+  result.addFailure(
+      !concurrent.isMaterialized() || !copied.isMaterialized() ||
+      std::count(seen.begin(), seen.end(), seen.front()) != 8 ||
+      seen.front() != "3Alias" + fields + "ID=c;Name=x;Alias=a,b");
+
+  // Records built outside a reader share the default pool unless given
+  // one; a default-built record has it too.
+  ++result;
+  const auto own = std::make_shared<StringPool>();
+  const GFFRecord shared{fields + "ID=b", own}, default_built{};
+  vector<StringPool::id_t> default_keys;
+  default_built.getKeyIndices(std::back_inserter(default_keys));
+  result.addFailure(repeated.getPool() != GFFRecord::default_pool() ||
+                    GFFRecord{fields}.getPool() != repeated.getPool() ||
+                    default_built.getPool() != repeated.getPool() ||
+                    shared.getPool() != own ||
+                    (*own)[shared.getTypeIndex()] != "gene" ||
+                    !default_keys.empty());
+
+  // Pool values are read without a lock and stay in place as it grows.
+  ++result;
+  StringPool growing;
+  const auto &first_value = growing[growing.intern("v0")];
+  bool stable{true};
+  for (int value = 1; value < 5000; ++value)
+    stable = stable && growing.intern("v" + std::to_string(value)) ==
+                           static_cast<StringPool::id_t>(value);
+  for (int value = 0; value < 5000; value += 97)
+    stable = stable && growing[value] == "v" + std::to_string(value);
+  result.addFailure(!stable || first_value != "v0" || growing.size() != 5000 ||
+                    growing.find("v4999") != 4999);
+
+  for (const string line : {"1\t.\tgene\t1\t9\t.\t+\t.\tID=a\textra",
+                            "1\t.\tgene\t1\t9\t.\t+\t."}) {
+    ++result;
+    bool thrown{false};
+    try {
+      GFFRecord{line};
+    } catch (const std::runtime_error &) {
+      thrown = true;
+    }
+    result.addFailure(!thrown);
+    if (verbose || !thrown) message << "Accepted: " << line << "\n";
+  }
+
+  if (verbose || result.hasFailed()) cout << message.str() << "\n";
+
+  cout << "~~~ " << gen_summary(result, "Checking " + test_name) << endl;
+
+  return result;
+}
+
+AGizmo::Evaluation::Stats TestHKL::TestGFF::check_gfffilter(bool verbose) {
+  Stats result;
+
+  sstream message;
+
+  const auto &test_name = "HKL::GFF::GFFFilter"s;
+
+  message << "\n~~~ Checking " << test_name << "\n";
+
+  const string file_name{"test/input/annotation.gff"};
+
+  vector<GFFRecord> records;
+  size_t comments{0};
+  GFFReader all{file_name};
+  while (auto item = all()) {
+    if (auto record = std::get_if<GFFRecord>(&(*item)))
+      records.push_back(std::move(*record));
+    else
+      ++comments;
+  }
+
+  // What each filter should keep, decided on built records.
+  const auto keeps = [](const GFFFilter &filter, const GFFRecord &record) {
+    const auto in = [](const vector<string> &wanted, const opt_str &value) {
+      return wanted.empty() || std::find(wanted.begin(), wanted.end(),
+                                         value.value_or(".")) != wanted.end();
+    };
+    if (!in(filter.seqids, record.getSeqID()) ||
+        !in(filter.types, record.getType()) ||
+        !in(filter.sources, record.getSource()))
+      return false;
+    if (filter.strand && record.getStrand().value_or('.') != filter.strand)
+      return false;
+    if (filter.first && record.getEnd() < filter.first) return false;
+    if (filter.last && record.getStart() > filter.last) return false;
+    for (const auto &[key, value] : filter.attributes) {
+      const auto found = record.get(key);
+      if (!found) return false;
+      if (!value) continue;
+      if (!*found) return false;
+      const auto raw = GFFRecord::find_raw(record.getRawAttributes(), key);
+      const auto items = StringDecompose::str_split(string(**raw), ",");
+      if (std::none_of(items.begin(), items.end(), [&](const string &item) {
+            return GFFRecord::gff3_str_clean(item) == *value;
+          }))
+        return false;
+    }
+    return true;
+  };
+
+  vector<GFFFilter> filters(7);
+  filters[0].types = {"gene", "pseudogene"};
+  filters[0].comments = false;
+  filters[1].sources = {"havana"};
+  filters[1].strand = '-';
+  filters[2].first = 65000;
+  filters[2].last = 70000;
+  filters[3].attributes = {{"logic_name", "cpg"}};
+  filters[4].attributes = {{"Alias", "chr1"}, {"ID", std::nullopt}};
+  filters[5].attributes = {{"external_name", "oe = 0.79"}};
+  filters[6].seqids = {"none"};
+
+  for (const auto &filter : filters) {
+    vector<string> expected;
+    for (const auto &record : records)
+      if (keeps(filter, record)) expected.push_back(record.str());
+
+    const auto check = [&](const string &reader_name, vector<string> found,
+                           size_t found_comments) {
+      ++result;
+      const bool failed =
+          found != expected ||
+          found_comments != (filter.comments ? comments : 0);
+      result.addFailure(failed);
+      if (verbose || failed)
+        message << reader_name << ": " << found.size() << " records, "
+                << found_comments << " comments; expected " << expected.size()
+                << "\n";
+    };
+
+    {
+      GFFReader reader{file_name, filter};
+      vector<string> found;
+      size_t found_comments{0};
+      while (auto item = reader()) {
+        if (const auto record = std::get_if<GFFRecord>(&(*item)))
+          found.push_back(record->str());
+        else
+          ++found_comments;
+      }
+      check("GFFReader", found, found_comments);
+    }
+    {
+      GFFViewReader reader{file_name, 256};
+      reader.setFilter(filter);
+      vector<string> found;
+      size_t found_comments{0};
+      while (auto item = reader()) {
+        if (const auto view = std::get_if<GFFRecordView>(&(*item)))
+          found.push_back(reader.promote(*view).str());
+        else
+          ++found_comments;
+      }
+      check("GFFViewReader", found, found_comments);
+    }
+    {
+      GFFParallelReader reader{file_name, 2, 512, 0, filter};
+      vector<string> found;
+      size_t found_comments{0};
+      while (auto item = reader()) {
+        if (const auto record = std::get_if<GFFRecord>(&(*item)))
+          found.push_back(record->str());
+        else
+          ++found_comments;
+      }
+      check("GFFParallelReader", found, found_comments);
+    }
+  }
+
+  // Lists are split on raw commas and each item decoded once.
+  const auto accepts = [](const string &attributes, const string &value) {
+    GFFFilter filter;
+    filter.attributes = {{"Name", value}};
+    return filter.accepts(
+        GFFRecord::split_line("1\t.\tgene\t1\t9\t.\t+\t.\t" + attributes));
+  };
+  const vector<std::tuple<string, string, bool>> lists{
+      {"Name=a%2Cb", "a,b", true},     {"Name=a%2Cb", "a", false},
+      {"Name=a%2Cb", "b", false},      {"Name=a%2Cb,c", "a,b", true},
+      {"Name=a%2Cb,c", "c", true},     {"Name=x%2525", "x%25", true},
+      {"Name=x%2525", "x%", false},    {"Name=y,x%2525", "x%25", true},
+      {"Name=y,x%2525", "x%", false}};
+  for (const auto &[attributes, value, expected] : lists) {
+    ++result;
+    const bool failed = accepts(attributes, value) != expected;
+    result.addFailure(failed);
+    if (verbose || failed)
+      message << attributes << " matching '" << value << "': "
+              << (expected ? "rejected" : "accepted") << "\n";
+  }
+
+  if (verbose || result.hasFailed()) cout << message.str() << "\n";
+
+  cout << "~~~ " << gen_summary(result, "Checking " + test_name) << endl;
+
+  return result;
+}
+
+AGizmo::Evaluation::Stats TestHKL::TestGFF::check_percent(bool verbose) {
+  Stats result;
+
+  sstream message;
+
+  const auto &test_name = "HKL::Percent"s;
+
+  message << "\n~~~ Checking " << test_name << "\n";
+
+  // Reference implementations, one byte at a time.
+  const auto encode = [](const string &input) {
+    string output;
+    for (const auto symbol : input) {
+      if (string_view{"\t\n\r%;=&,"}.find(symbol) == string_view::npos) {
+        output.push_back(symbol);
+        continue;
+      }
+      const auto code = static_cast<unsigned char>(symbol);
+      output += '%';
+      output += "0123456789ABCDEF"[code >> 4];
+      output += "0123456789ABCDEF"[code & 0xF];
+    }
+    return output;
+  };
+
+  const vector<std::pair<string, string>> decode_tests{
+      {"a%09b", "a\tb"},
+      {"%3b%3D", ";="},
+      {"100%", "100%"},
+      {"%4", "%4"},
+      {"%zz%41", "%zzA"},
+      {"%%41", "%A"},
+      {"", ""}};
+  for (const auto &[input, expected] : decode_tests) {
+    ++result;
+    const auto output = GFFRecord::gff3_str_clean(input);
+    result.addFailure(output != expected);
+    if (verbose || output != expected)
+      message << "decode '" << input << "' -> '" << output << "'\n";
+  }
+
+  ++result;
+  result.addFailure(GFFRecord::gff3_str_escape("a\tb") != "a%09b");
+
+  // Random strings long enough for the vector path, with reserved bytes at
+  // every position of a block.
+  std::mt19937 generator{3};
+  for (int test = 0; test < 2000; ++test) {
+    string input(std::uniform_int_distribution<size_t>{0, 70}(generator), 'x');
+    for (auto &symbol : input) {
+      const auto choice = generator() % 16;
+      symbol = choice < 8 ? "\t\n\r%;=&,"[choice]
+                          : static_cast<char>(generator() % 256);
+    }
+
+    const auto encoded = GFFRecord::gff3_str_escape(input);
+    const auto decoded = GFFRecord::gff3_str_clean(encoded);
+    ++result;
+    const bool failed = encoded != encode(input) || decoded != input ||
+                        encoded.find_first_of("\t\n\r;=&,") != string::npos;
+    result.addFailure(failed);
+    if (verbose || failed) message << "round trip of '" << input << "'\n";
+  }
+
+  if (verbose || result.hasFailed()) cout << message.str() << "\n";
+
+  cout << "~~~ " << gen_summary(result, "Checking " + test_name) << endl;
+
+  return result;
+}
+
+AGizmo::Evaluation::Stats TestHKL::TestGFF::check_ndjson(bool verbose) {
+  Stats result;
+
+  sstream message;
+
+  const auto &test_name = "HKL::GFF::NDJSONWriter"s;
+
+  message << "\n~~~ Checking " << test_name << "\n";
+
+  const GFFRecord record{
+      "chr%091\t.\tgene\t1\t10\t2.5\t+\t0\t"
+      "ID=g\"1;Alias=a%2Cb,c;Note=x%0Ay;flag;Dbxref=d%2Ce;ID=g2;flag"};
+  const string expected{
+      "{\"seqid\":\"chr\\t1\",\"source\":null,\"type\":\"gene\","
+      "\"start\":1,\"end\":10,\"score\":2.5,\"strand\":\"+\","
+      "\"phase\":0,\"attributes\":{\"ID\":\"g\\\"1\","
+      "\"Alias\":[\"a,b\",\"c\"],\"Note\":\"x\\ny\",\"flag\":true,"
+      "\"Dbxref\":\"d,e\"}}\n"};
+
+  for (const bool materialized : {false, true}) {
+    ++result;
+    auto copy = record;
+    if (materialized) copy.materialize();
+
+    sstream output;
+    {
+      NDJSONWriter writer{output};
+      writer.write(copy);
+      writer.write(GFFComment{"##gff-version 3"});
+    }
+
+    const bool failed = output.str() != expected;
+    result.addFailure(failed);
+    if (verbose || failed)
+      message << "Outcome: " << output.str() << "Expected: " << expected;
+  }
+
+  // A single value holding an encoded comma stays one value when the record
+  // is written back as GFF.
+  ++result;
+  auto parsed = record;
+  parsed.materialize();
+  const auto line = parsed.str();
+  const bool escaped = line.find("Dbxref=d%2Ce") != string::npos &&
+                       line.find("Alias=a%2Cb,c") != string::npos &&
+                       line.find("g2") == string::npos;
+  result.addFailure(!escaped);
+  if (verbose || !escaped) message << "Materialized: " << line << "\n";
+
+  if (verbose || result.hasFailed()) cout << message.str() << "\n";
+
+  cout << "~~~ " << gen_summary(result, "Checking " + test_name) << endl;
+
+  return result;
+}
+
+AGizmo::Evaluation::Stats TestHKL::TestGFF::check_writers(bool verbose) {
+  Stats result;
+
+  sstream message;
+
+  const auto &test_name = "HKL::GFF::TSVWriter/GFFWriter"s;
+
+  message << "\n~~~ Checking " << test_name << "\n";
+
+  const vector<string> keys{"ID", "Parent", "Note", "flag", "Alias", "none"};
+  vector<GFFRecord> records{
+      GFFRecord{"c%3B1\t.\tgene\t1\t10\t1\t+\t0\t"
+                "ID=g1;Note=a%3Bb;flag;Alias=x,y;ID=g2"},
+      GFFRecord{"c1\tsrc\texon\t5\t8\t0.5\t.\t.\tParent=g1;Note="}};
+  GFFReader reader{"test/input/annotation.gff"};
+  while (auto item = reader())
+    if (auto record = std::get_if<GFFRecord>(&(*item)))
+      records.push_back(std::move(*record));
+
+  for (const bool materialized : {false, true}) {
+    string tsv_expected, gff_expected;
+    sstream tsv_output, gff_output;
+    {
+      TSVWriter tsv{tsv_output, keys, "NA", "yes", 64};
+      GFFWriter gff{gff_output, 64};
+      for (auto record : records) {
+        if (materialized) record.materialize();
+        tsv_expected += record.strFields("NA", "\t") +
+                        record.strAttributes(keys.begin(), keys.end(), "NA",
+                                             "\t", "yes") +
+                        "\n";
+        gff_expected += record.str() + "\n";
+        tsv.write(record);
+        gff.write(record);
+      }
+    }
+
+    ++result;
+    result.addFailure(tsv_output.str() != tsv_expected);
+    if (verbose || tsv_output.str() != tsv_expected)
+      message << "TSV outcome:\n"
+              << tsv_output.str() << "Expected:\n"
+              << tsv_expected;
+
+    ++result;
+    result.addFailure(gff_output.str() != gff_expected);
+    if (verbose || gff_output.str() != gff_expected)
+      message << "GFF outcome:\n"
+              << gff_output.str() << "Expected:\n"
+              << gff_expected;
+  }
+
+  const vector<std::pair<GFFRecord, string>> line_tests{
+      {records[0],
+       "c%3B1\t.\tgene\t1\t10\t1\t+\t0\t"
+       "ID=g1;Note=a%3Bb;flag;Alias=x,y;ID=g2"},
+      {records[1], "c1\tsrc\texon\t5\t8\t0.500\t.\t.\tParent=g1;Note="}};
+  for (const auto &[record, expected] : line_tests) {
+    ++result;
+    result.addFailure(record.str() != expected);
+    if (verbose || record.str() != expected)
+      message << "Outcome: " << record.str() << "\nExpected: " << expected
+              << "\n";
+  }
+
+  ++result;
+  const auto fields = records[0].strFields("NA", "\t") +
+                      records[0].strAttributes(keys.begin(), keys.end(), "NA",
+                                               "\t", "yes");
+  const string fields_expected{
+      "c;1\tNA\tgene\t1\t10\t1\t+\t0\tg1\tNA\ta;b\tyes\tx,y\tNA"};
+  result.addFailure(fields != fields_expected);
+  if (verbose || fields != fields_expected)
+    message << "Outcome: " << fields << "\nExpected: " << fields_expected
+            << "\n";
+
+  if (verbose || result.hasFailed()) cout << message.str() << "\n";
+
+  cout << "~~~ " << gen_summary(result, "Checking " + test_name) << endl;
+
+  return result;
+}
+
+AGizmo::Evaluation::Stats TestHKL::TestGFF::check_metrics(bool verbose) {
+  Stats result;
+
+  sstream message;
+
+  const auto &test_name = "HKL::Metrics"s;
+
+  message << "\n~~~ Checking " << test_name << "\n";
+
+  const auto check = [&](bool passed, const string &description) {
+    ++result;
+    result.addFailure(!passed);
+    if (verbose || !passed)
+      message << (passed ? "Passed: " : "Failed: ") << description << "\n";
+  };
+
+  const string file_name{"test/input/annotation.gff"};
+  const auto file_size = std::filesystem::file_size(file_name);
+
+  Metrics metrics{};
+  size_t records{0};
+  sstream output;
+  {
+    GFFReader reader{file_name};
+    reader.setMetrics(&metrics);
+    TSVWriter tsv{output, {"ID"}, ".", "true", 256};
+    tsv.setMetrics(&metrics);
+    while (auto item = reader())
+      if (const auto record = std::get_if<GFFRecord>(&(*item))) {
+        ++records;
+        tsv.write(*record);
+      }
+  }
+
+  check(metrics.getRecords() == records, "records counted");
+  check(metrics.getBytesRead() == file_size, "bytes read");
+  check(metrics.getBytesWritten() == output.str().size(), "bytes written");
+  check(metrics.getCalls(Metrics::Stage::Parse) == records, "parse calls");
+  check(metrics.getCalls(Metrics::Stage::Format) == records, "format calls");
+  check(metrics.getCalls(Metrics::Stage::Write) > 1, "several writes");
+
+  uint64_t histogram{0};
+  for (size_t bucket = 0; bucket < Metrics::latency_buckets; ++bucket)
+    histogram += metrics.getLatencyCount(bucket);
+  check(histogram == records, "histogram total");
+  check(metrics.getLatencyQuantile(0.5) <= metrics.getLatencyQuantile(0.99),
+        "quantiles ordered");
+
+  Metrics views_metrics{};
+  {
+    GFFViewReader views{file_name, 64};
+    views.setMetrics(&views_metrics);
+    while (views()) continue;
+  }
+  check(views_metrics.getBytesRead() == file_size, "view reader bytes");
+  check(views_metrics.getRecords() == 0, "views not counted as records");
+
+  {
+    const Metrics::Scope scope{nullptr, Metrics::Stage::Discover};
+  }
+  {
+    const Metrics::Scope scope{&metrics, Metrics::Stage::Discover};
+  }
+  check(metrics.getCalls(Metrics::Stage::Discover) == 1, "scope");
+  check(Metrics::peak_rss() > 0, "peak RSS");
+
+  sstream json;
+  metrics.writeJSON(json);
+  const auto summary = json.str();
+  check(summary.rfind("{\"event\":\"summary\",", 0) == 0 &&
+            summary.back() == '}',
+        "JSON object");
+  check(summary.find("\"records\":" + std::to_string(records) + ",") !=
+            string::npos,
+        "JSON records");
+  check(summary.find("\"parse\":{\"seconds\":") != string::npos,
+        "JSON stages");
+  const auto line = metrics.toJSON("progress");
+  check(line.rfind("{\"event\":\"progress\",", 0) == 0 &&
+            line.find('\n') == line.size() - 1,
+        "JSON line");
+  if (verbose) message << summary << "\n";
+
+  if (verbose || result.hasFailed()) cout << message.str() << "\n";
+
+  cout << "~~~ " << gen_summary(result, "Checking " + test_name) << endl;
+
+  return result;
+}
+
+AGizmo::Evaluation::Stats TestHKL::TestGFF::check_gfffasta(bool verbose) {
+  Stats result;
+
+  sstream message;
+
+  const auto &test_name = "HKL::GFF::GFFReader ##FASTA"s;
+
+  message << "\n~~~ Checking " << test_name << "\n";
+
+  const auto check = [&](bool passed, const string &description) {
+    ++result;
+    result.addFailure(!passed);
+    if (verbose || !passed)
+      message << (passed ? "Passed: " : "Failed: ") << description << "\n";
+  };
+
+  const string annotation{
+      "##gff-version 3\n"
+      "##sequence-region chr1 1 12\n"
+      "chr1\tsrc\tgene\t1\t9\t.\t+\t.\tID=g1\n"
+      "chr1\tsrc\tCDS\t1\t9\t.\t+\t0\tParent=g1\n"
+      "chr2\tsrc\tgene\t2\t4\t.\t-\t.\tID=g2\n"};
+  const string sequences{
+      ">chr1 plasmid\nACGTAC\nacgtNN\n"
+      ">chr2\nGGCC\n"};
+
+  const auto count_records = [](auto &reader) {
+    size_t records{0};
+    while (const auto item = reader())
+      if (item->index() == 1) ++records;
+    return records;
+  };
+
+  for (const auto &marker : {"##FASTA\n"s, ""s}) {
+    const auto label = marker.empty() ? " without ##FASTA"s : ""s;
+    const auto input = annotation + marker + sequences;
+
+    std::istringstream stream{input};
+    GFFReader reader{stream};
+    check(count_records(reader) == 3, "annotation records" + label);
+    check(reader.hasFASTA(), "FASTA section found" + label);
+    check(!reader(), "no records after the annotation" + label);
+
+    const auto seqs = reader.readSequences(true);
+    check(seqs.size() == 2, "sequences" + label);
+    if (seqs.size() == 2) {
+      check(seqs[0].getName() == "chr1 plasmid" &&
+                seqs[0].getSeq() == "ACGTACACGTNN",
+            "first sequence" + label);
+      check(seqs[1].getName() == "chr2" && seqs[1].getSeq() == "GGCC",
+            "last sequence" + label);
+    }
+
+    std::istringstream skipped{input};
+    GFFReader skipping{skipped};
+    const auto first = skipping.readSeq();
+    check(first && first->getSeq() == "ACGTACacgtNN",
+          "readSeq skips the annotation" + label);
+
+    std::istringstream views_stream{input};
+    GFFViewReader views{views_stream, 16};
+    check(count_records(views) == 3, "view reader stops" + label);
+    const auto next = views.getLine();
+    check(next && next->rfind("chr1", 1) == 1, "view reader leaves FASTA" +
+          label);
+
+    for (const size_t block : {size_t{8}, size_t{64}, size_t{1} << 12}) {
+      std::istringstream parallel_stream{input};
+      GFFParallelReader parallel{parallel_stream, 2, block};
+      check(count_records(parallel) == 3,
+            "parallel reader, block " + std::to_string(block) + label);
+    }
+  }
+
+  std::istringstream plain{annotation};
+  GFFReader reader{plain};
+  check(count_records(reader) == 3 && !reader.hasFASTA() && !reader.readSeq(),
+        "no FASTA section");
+
+  if (verbose || result.hasFailed()) cout << message.str() << "\n";
+
+  cout << "~~~ " << gen_summary(result, "Checking " + test_name) << endl;
+
+  return result;
+}
+
 TestHKL::TestGFF::GFFTest::GFFTest(InputGFF input, OutputGFF expected)
     : BaseTest(input, expected) {
   validate();
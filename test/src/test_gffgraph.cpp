@@ -0,0 +1,69 @@
+#include "test_gffgraph.hpp"
+
+AGizmo::Evaluation::Stats TestHKL::TestGFFGraph::check_feature_graph(
+    bool verbose) {
+  Stats result;
+
+  sstream message;
+
+  const auto &test_name = "HKL::GFF::GFFFeatureGraph"s;
+
+  message << "\n~~~ Checking " << test_name << "\n";
+
+  const auto check = [&](bool failed, const string &what) {
+    ++result;
+    result.addFailure(failed);
+    if (verbose || failed)
+      message << what << (failed ? ": failed" : "") << "\n";
+  };
+
+  // Children before parents, a shared exon and an unknown parent.
+  const GFFFeatureGraph graph{vector<GFFRecord>{
+      GFFRecord{"c\t.\texon\t10\t20\t.\t+\t.\tID=e1;Parent=t1,t2"},
+      GFFRecord{"c\t.\tCDS\t15\t20\t.\t+\t0\tParent=t1"},
+      GFFRecord{"c\t.\tmRNA\t10\t40\t.\t+\t.\tID=t1;Parent=g1"},
+      GFFRecord{"c\t.\tmRNA\t5\t40\t.\t+\t.\tID=t2;Parent=g1"},
+      GFFRecord{"c\t.\texon\t30\t40\t.\t+\t.\tParent=t1"},
+      GFFRecord{"c\t.\texon\t30\t40\t.\t+\t.\tParent=t2"},
+      GFFRecord{"c\t.\tCDS\t18\t35\t.\t+\t0\tParent=t2"},
+      GFFRecord{"c\t.\tgene\t10\t40\t.\t+\t.\tID=g1"},
+      GFFRecord{"c\t.\texon\t1\t2\t.\t+\t.\tParent=t9"},
+  }};
+
+  const auto gene = graph.find("g1").value_or(GFFFeatureGraph::none);
+  check(gene != 7, "find");
+  check(graph.getRoots() != vector<GFFFeatureGraph::node_t>{7, 8}, "roots");
+  check(graph.getMissingParents() != vector<string>{"t9"}, "missing parents");
+  check(graph.getParents(0).size() != 2 || graph.getChildren(2).size() != 3,
+        "multiple parents");
+  check(graph.getSubtree(gene) !=
+            vector<GFFFeatureGraph::node_t>{7, 2, 0, 1, 4, 3, 5, 6},
+        "subtree");
+
+  const auto summary = graph.summarize(gene);
+  message << "Summary: " << summary.span << " " << summary.transcripts << " "
+          << summary.exons << " " << summary.cds_length << "\n";
+  check(summary.span != HKL::Region("c", 5, 40, '+') ||
+            summary.transcripts != 2 || summary.exons != 2 ||
+            summary.cds_length != 21,
+        "summary");
+
+  const GFFFeatureGraph annotation{"test/input/annotation.gff"};
+  const auto genes = annotation.summarize();
+  check(genes.size() != 9 || !annotation.getMissingParents().empty(),
+        "annotation genes");
+  for (const auto &item : genes) {
+    if (annotation.getRecord(item.gene).get("Name", "", "") != "OR4F5")
+      continue;
+    check(item.span != HKL::Region("1", 65419, 71585, '+') ||
+              item.transcripts != 2 || item.exons != 4 ||
+              item.cds_length != 918,
+          "OR4F5 summary");
+  }
+
+  if (verbose || result.hasFailed()) cout << message.str() << "\n";
+
+  cout << "~~~ " << gen_summary(result, "Checking " + test_name) << endl;
+
+  return result;
+}
@@ -0,0 +1,340 @@
+#include "test_gffsort.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <random>
+#include <sstream>
+
+AGizmo::Evaluation::Stats TestHKL::TestGFFSort::check_gffsort(bool verbose) {
+  Stats result;
+
+  sstream message;
+
+  const auto &test_name = "HKL::GFF::GFFSorter"s;
+
+  message << "\n~~~ Checking " << test_name << "\n";
+
+  const auto check = [&](bool passed, const string &description) {
+    ++result;
+    result.addFailure(!passed);
+    if (verbose || !passed)
+      message << (passed ? "Passed: " : "Failed: ") << description << "\n";
+  };
+
+  std::mt19937 generator{7};
+
+  for (size_t sources = 0; sources < 10; ++sources) {
+    vector<vector<int>> runs(sources);
+    vector<int> expected;
+    for (auto &run : runs) {
+      run.resize(std::uniform_int_distribution<size_t>{0, 50}(generator));
+      for (auto &value : run)
+        expected.push_back(value =
+                               std::uniform_int_distribution<>{0, 99}(
+                                   generator));
+      std::sort(run.begin(), run.end());
+    }
+    std::sort(expected.begin(), expected.end());
+
+    vector<const int *> heads;
+    vector<size_t> positions(sources, 0);
+    for (const auto &run : runs)
+      heads.push_back(run.empty() ? nullptr : run.data());
+    LoserTree<int> tree{heads};
+    vector<int> merged;
+    while (!tree.empty()) {
+      const auto source = tree.top();
+      merged.push_back(tree.front());
+      const auto next = ++positions[source];
+      tree.replace(next < runs[source].size() ? &runs[source][next]
+                                              : nullptr);
+    }
+    check(merged == expected,
+          "loser tree of " + std::to_string(sources) + " sources");
+  }
+
+  vector<string> comments, records;
+  {
+    std::ifstream input{"test/input/annotation.gff"};
+    string line;
+    while (std::getline(input, line)) {
+      if (line.empty()) continue;
+      if (line[0] == '#') {
+        if (line != "###") comments.push_back(line);
+      } else
+        records.push_back(line);
+    }
+  }
+  // Other sequences, ordered by their ##sequence-region directives, and a
+  // group with equal coordinates listed children first.
+  for (const auto &extra :
+       {"2\t.\tgene\t5\t9\t.\t+\t.\tID=g2",
+        "10\t.\tgene\t5\t9\t.\t+\t.\tID=g10",
+        "10\t.\tgene\t1\t9\t.\t+\t.\tID=g11",
+        "1\t.\texon\t100\t200\t.\t+\t.\tParent=t1,t2",
+        "1\t.\tCDS\t100\t200\t.\t+\t0\tParent=t1",
+        "1\t.\tmRNA\t100\t200\t.\t+\t.\tID=t1;Parent=g1",
+        "1\t.\tncRNA\t100\t200\t.\t+\t.\tID=t2;Parent=g1",
+        "1\t.\tgene\t100\t200\t.\t+\t.\tID=g1"})
+    records.emplace_back(extra);
+  std::shuffle(records.begin(), records.end(), generator);
+
+  const string fasta{"##FASTA\n>1\nACGT\nACGT\n>2\nGG\n"};
+  string input;
+  for (size_t index = 0; index < comments.size(); ++index)
+    input += comments[index] + "\n";
+  for (size_t index = 0; index < records.size(); ++index) {
+    input += records[index] + "\n";
+    if (index % 50 == 0) input += "###\n";
+  }
+  input += fasta;
+
+  const auto sort = [&](GFFSorter sorter) {
+    sstream in{input}, out;
+    sorter.sort(in, out);
+    return std::make_pair(out.str(), sorter.getRuns());
+  };
+  const auto temp = std::filesystem::temp_directory_path();
+  const auto [sorted, memory_runs] = sort(GFFSorter{0, 1});
+  const auto [external, external_runs] = sort(GFFSorter{2048, 3, temp, 2});
+
+  check(memory_runs == 0, "in memory without runs");
+  check(external_runs > 4, "external sort spilled runs");
+  check(external == sorted, "external sort equals sort in memory");
+  check(sort(GFFSorter{4096, 1, temp}).first == sorted,
+        "single merge equals sort in memory");
+
+  const auto in_place = (temp / "hkl-sort-in-place.gff").string();
+  std::ofstream{in_place, std::ios::binary} << input;
+  GFFSorter{}.sort(in_place, in_place);
+  {
+    std::ifstream stream{in_place, std::ios::binary};
+    const string text{std::istreambuf_iterator<char>{stream}, {}};
+    check(text == sorted, "input sorted into itself");
+  }
+  std::filesystem::remove(in_place);
+
+  vector<string> lines;
+  {
+    sstream stream{sorted};
+    string line;
+    while (std::getline(stream, line)) lines.push_back(line);
+  }
+
+  check(std::equal(comments.begin(), comments.end(), lines.begin()),
+        "directives first, in input order");
+  const auto first = lines.begin() + comments.size();
+  const auto fasta_line = std::find(first, lines.end(), "##FASTA");
+  string tail;
+  for (auto line = fasta_line; line != lines.end(); ++line)
+    tail += *line + "\n";
+  check(tail == fasta, "FASTA copied to the end");
+
+  vector<string> output_records{first, fasta_line};
+  auto expected_records = records;
+  std::sort(expected_records.begin(), expected_records.end());
+  auto sorted_records = output_records;
+  std::sort(sorted_records.begin(), sorted_records.end());
+  check(sorted_records == expected_records, "every record written once");
+
+  std::map<string, int> ranks{{"1", 0}, {"10", 1}, {"2", 11}};
+  bool ordered{true};
+  for (size_t index = 1; index < output_records.size(); ++index) {
+    const auto one = GFFRecord::split_line(output_records[index - 1]),
+               two = GFFRecord::split_line(output_records[index]);
+    const auto key = [&ranks](const GFFRecord::fields_t &fields) {
+      return std::make_tuple(ranks.at(string(fields[0])),
+                             *GFFRecord::parse_int(fields[3]),
+                             *GFFRecord::parse_int(fields[4]));
+    };
+    if (key(two) < key(one)) ordered = false;
+  }
+  check(ordered, "records ordered by seqid, start and end");
+
+  const auto tie = std::find(output_records.begin(), output_records.end(),
+                             "1\t.\tgene\t100\t200\t.\t+\t.\tID=g1");
+  const vector<string> expected_tie{
+      "1\t.\tgene\t100\t200\t.\t+\t.\tID=g1",
+      "1\t.\tmRNA\t100\t200\t.\t+\t.\tID=t1;Parent=g1",
+      "1\t.\tncRNA\t100\t200\t.\t+\t.\tID=t2;Parent=g1",
+      "1\t.\tCDS\t100\t200\t.\t+\t0\tParent=t1",
+      "1\t.\texon\t100\t200\t.\t+\t.\tParent=t1,t2"};
+  check(output_records.end() - tie >= 5 &&
+            std::equal(expected_tie.begin(), expected_tie.end(), tie),
+        "parents before children with equal coordinates");
+
+  if (verbose || result.hasFailed()) cout << message.str() << "\n";
+
+  cout << "~~~ " << gen_summary(result, "Checking " + test_name) << endl;
+
+  return result;
+}
+
+AGizmo::Evaluation::Stats TestHKL::TestGFFSort::check_gffmerge(bool verbose) {
+  Stats result;
+
+  sstream message;
+
+  const auto &test_name = "HKL::GFF::GFFMerger"s;
+
+  message << "\n~~~ Checking " << test_name << "\n";
+
+  const auto check = [&](bool passed, const string &description) {
+    ++result;
+    result.addFailure(!passed);
+    if (verbose || !passed)
+      message << (passed ? "Passed: " : "Failed: ") << description << "\n";
+  };
+
+  const auto split = [](const string &text) {
+    vector<string> lines;
+    sstream stream{text};
+    string line;
+    while (std::getline(stream, line)) lines.push_back(line);
+    return lines;
+  };
+
+  vector<string> header, records;
+  {
+    std::ifstream input{"test/input/annotation.gff"};
+    sstream sorted;
+    GFFSorter{}.sort(input, sorted);
+    for (const auto &line : split(sorted.str()))
+      (line[0] == '#' ? header : records).push_back(line);
+  }
+
+  // Three shards taking every third group of records with equal
+  // coordinates, which merge back in sorted order. The last declares a
+  // longer sequence 1, is gzip compressed and carries a FASTA section; the
+  // second is BGZF compressed.
+  vector<size_t> owners(records.size(), 0);
+  for (size_t index = 1, group = 0; index < records.size(); ++index) {
+    const auto one = GFFRecord::split_line(records[index - 1]),
+               two = GFFRecord::split_line(records[index]);
+    if (one[0] != two[0] || one[3] != two[3] || one[4] != two[4]) ++group;
+    owners[index] = group % 3;
+  }
+  const auto directory = std::filesystem::temp_directory_path();
+  const vector<string> shards{(directory / "hkl-merge-0.gff").string(),
+                              (directory / "hkl-merge-1.gff.gz").string(),
+                              (directory / "hkl-merge-2.gff.gz").string()};
+  const string longer{"##sequence-region 1 1 300000000"};
+  vector<string> texts(shards.size());
+  for (size_t shard = 0; shard < shards.size(); ++shard) {
+    for (const auto &line : header)
+      texts[shard] +=
+          (shard == 2 && line.rfind("##sequence-region   1 ", 0) == 0
+               ? longer
+               : line) +
+          "\n";
+    for (size_t index = 0; index < records.size(); ++index)
+      if (owners[index] == shard) texts[shard] += records[index] + "\n";
+  }
+  texts[2] += "##FASTA\n>1\nACGT\n";
+
+  std::ofstream{shards[0]} << texts[0];
+  {
+    sstream stream{texts[1]};
+    HKL::BGZF::compress(stream, shards[1]);
+  }
+  {
+    const auto file = gzopen(shards[2].c_str(), "wb");
+    gzwrite(file, texts[2].data(), static_cast<unsigned>(texts[2].size()));
+    gzclose(file);
+  }
+
+  sstream merged_stream;
+  GFFMerger{shards}.merge(merged_stream);
+  const auto merged = split(merged_stream.str());
+
+  auto expected_header = header;
+  for (auto &line : expected_header)
+    if (line.rfind("##sequence-region   1 ", 0) == 0) line = longer;
+  check(merged.size() == header.size() + records.size() + 3 &&
+            std::equal(expected_header.begin(), expected_header.end(),
+                       merged.begin()),
+        "directives once, sequence-region ranges merged");
+
+  const auto first = merged.begin() + header.size();
+  const auto last = merged.end() - 3;
+  vector<string> merged_records{first, last};
+  check(merged_records == records, "records merged in sorted order");
+  check(vector<string>(last, merged.end()) ==
+            vector<string>{"##FASTA", ">1", "ACGT"},
+        "FASTA at the end");
+
+  sstream tagged_stream;
+  {
+    GFFMerger merger{shards};
+    merger.setTag("shard");
+    merger.merge(tagged_stream);
+  }
+  const auto tagged = split(tagged_stream.str());
+  bool tags{tagged.size() == merged.size()};
+  for (size_t index = header.size(); tags && index < merged.size() - 3;
+       ++index) {
+    const auto &shard = shards[owners[index - header.size()]];
+    tags = tagged[index] == merged[index] + ";shard=" + shard;
+  }
+  check(tags, "records tagged with their shard");
+
+  std::ofstream{shards[0]} << records[10] << "\n" << records[0] << "\n";
+  bool thrown{false};
+  try {
+    sstream output;
+    GFFMerger{{shards[0]}}.merge(output);
+  } catch (const std::runtime_error &) {
+    thrown = true;
+  }
+  check(thrown, "unsorted input rejected");
+
+  // Sequences ranked from every input whatever their order: the first shard
+  // only has sequence 3, whose rank the second places after sequence 1.
+  const auto order = [&](const vector<string> &texts) {
+    vector<string> files;
+    for (size_t index = 0; index < texts.size(); ++index) {
+      files.push_back(
+          (directory / ("hkl-merge-order-" + std::to_string(index) + ".gff"))
+              .string());
+      std::ofstream{files.back()} << texts[index];
+    }
+    vector<string> lines;
+    try {
+      sstream output;
+      GFFMerger{files}.merge(output);
+      lines = split(output.str());
+    } catch (const std::runtime_error &) {
+      lines = {"<error>"};
+    }
+    for (const auto &file : files) std::filesystem::remove(file);
+    return lines;
+  };
+  const string only_3{"##sequence-region 3 1 100\n"
+                      "3\t.\tgene\t5\t9\t.\t+\t.\tID=a\n"},
+      one_then_3{"##sequence-region 1 1 100\n"
+                 "1\t.\tgene\t5\t9\t.\t+\t.\tID=b\n"
+                 "3\t.\tgene\t1\t9\t.\t+\t.\tID=c\n"},
+      three_then_1{"3\t.\tgene\t1\t9\t.\t+\t.\tID=d\n"
+                   "1\t.\tgene\t1\t9\t.\t+\t.\tID=e\n"};
+  const vector<string> expected_order{
+      "##sequence-region 1 1 100", "##sequence-region 3 1 100",
+      "1\t.\tgene\t5\t9\t.\t+\t.\tID=b",
+      "3\t.\tgene\t1\t9\t.\t+\t.\tID=c",
+      "3\t.\tgene\t5\t9\t.\t+\t.\tID=a"};
+  check(order({only_3, one_then_3}) == expected_order &&
+            order({one_then_3, only_3}) == expected_order,
+        "sequences ranked from all inputs, whatever their order");
+  check(order({one_then_3, three_then_1}) == vector<string>{"<error>"},
+        "inputs ordering sequences differently rejected");
+
+  for (const auto &shard : shards) std::filesystem::remove(shard);
+
+  if (verbose || result.hasFailed()) cout << message.str() << "\n";
+
+  cout << "~~~ " << gen_summary(result, "Checking " + test_name) << endl;
+
+  return result;
+}
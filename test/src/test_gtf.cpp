@@ -0,0 +1,124 @@
+#include "test_gtf.hpp"
+
+#include <sstream>
+
+AGizmo::Evaluation::Stats TestHKL::TestGTF::check_gtf(bool verbose) {
+  Stats result;
+
+  sstream message;
+
+  const auto &test_name = "HKL::GFF::GTFConverter"s;
+
+  message << "\n~~~ Checking " << test_name << "\n";
+
+  const auto check = [&](bool passed, const string &description) {
+    ++result;
+    result.addFailure(!passed);
+    if (verbose || !passed)
+      message << (passed ? "Passed: " : "Failed: ") << description << "\n";
+  };
+
+  const auto convert = [](const string &input, size_t threads, size_t batch,
+                          bool comments = false) {
+    std::istringstream stream{input};
+    GFFReader reader{stream};
+    std::ostringstream output;
+    GTFConverter converter{threads, batch, 2};
+    converter.setComments(comments);
+    converter.convert(reader, output);
+    return output.str();
+  };
+
+  const string input{
+      "##gff-version 3\n"
+      "#!genome-build test\n"
+      "1\tsrc\tgene\t1\t90\t.\t+\t.\tID=gene:G1;gene_id=G1;Name=A\n"
+      "1\tsrc\tmRNA\t1\t90\t.\t+\t.\t"
+      "ID=transcript:T1;Parent=gene:G1;transcript_id=T1\n"
+      "1\tsrc\texon\t1\t40\t.\t+\t.\tParent=transcript:T1;Dbxref=a,b\n"
+      "1\tsrc\tCDS\t10\t40\t1.5\t+\t0\tID=c1;Parent=transcript:T1\n"
+      "1\tsrc\texon\t60\t90\t.\t+\t.\tParent=transcript:T2;Note=x%3B\"y\"\n"
+      "1\tsrc\tmRNA\t1\t90\t.\t+\t.\tID=transcript:T2;Parent=gene:G1\n"
+      "###\n"
+      "1\tsrc\tgene\t50\t70\t.\t-\t.\tID=g2;flag\n"
+      "1\tsrc\tCDS\t50\t70\t.\t-\t0\tParent=g2\n"
+      "2\tsrc\tregion\t1\t5\t.\t.\t.\tID=r1\n"};
+  const string expected{
+      "1\tsrc\tgene\t1\t90\t.\t+\t.\tgene_id \"G1\"; Name \"A\";\n"
+      "1\tsrc\tmRNA\t1\t90\t.\t+\t.\t"
+      "gene_id \"G1\"; transcript_id \"T1\";\n"
+      "1\tsrc\texon\t1\t40\t.\t+\t.\t"
+      "gene_id \"G1\"; transcript_id \"T1\"; Dbxref \"a\"; Dbxref \"b\";\n"
+      "1\tsrc\tCDS\t10\t40\t1.500\t+\t0\t"
+      "gene_id \"G1\"; transcript_id \"T1\";\n"
+      "1\tsrc\texon\t60\t90\t.\t+\t.\t"
+      "gene_id \"G1\"; transcript_id \"transcript:T2\"; "
+      "Note \"x;\\\"y\\\"\";\n"
+      "1\tsrc\tmRNA\t1\t90\t.\t+\t.\t"
+      "gene_id \"G1\"; transcript_id \"transcript:T2\";\n"
+      "1\tsrc\tgene\t50\t70\t.\t-\t.\t"
+      "gene_id \"g2\"; transcript_id \"g2\"; flag \"\";\n"
+      "1\tsrc\tCDS\t50\t70\t.\t-\t0\tgene_id \"g2\"; transcript_id \"g2\";\n"
+      "2\tsrc\tregion\t1\t5\t.\t.\t.\tgene_id \"r1\"; transcript_id \"r1\";\n"};
+
+  const auto output = convert(input, 1, 1);
+  check(output == expected, "GTF lines");
+  if (verbose || output != expected) message << output;
+
+  check(convert(input, 4, 2, true) == "#!genome-build test\n" + expected,
+        "comments");
+  check(convert("", 2, 1).empty(), "empty input");
+
+  bool consistent{true};
+  string reference;
+  for (const auto &[threads, batch] :
+       {std::pair<size_t, size_t>{1, 1 << 20}, {1, 1}, {3, 5}, {8, 64}}) {
+    std::ostringstream output;
+    GTFConverter converter{threads, batch};
+    converter.convert("test/input/annotation.gff", output);
+    if (reference.empty())
+      reference = output.str();
+    else
+      consistent = consistent && output.str() == reference;
+  }
+  check(consistent, "same output for any threads and batch");
+
+  size_t lines{0}, records{0}, exons{0};
+  {
+    GFFReader reader{"test/input/annotation.gff"};
+    while (const auto item = reader())
+      if (item->index() == 1) ++records;
+  }
+  std::istringstream written{reference};
+  for (string line; std::getline(written, line);) {
+    ++lines;
+    if (line.find("\texon\t") != string::npos &&
+        line.find("; transcript_id \"ENST") != string::npos)
+      ++exons;
+  }
+  check(lines >= records, "every record written");
+
+  // An exon shared by transcripts is written once for each of them.
+  const string shared{
+      "1\tsrc\tgene\t1\t90\t.\t+\t.\tID=g\n"
+      "1\tsrc\tmRNA\t1\t90\t.\t+\t.\tID=t1;Parent=g\n"
+      "1\tsrc\tmRNA\t1\t90\t.\t+\t.\tID=t2;Parent=g\n"
+      "1\tsrc\texon\t1\t40\t.\t+\t.\tParent=t1,t2,t1,other\n"};
+  const string expected_shared{
+      "1\tsrc\tgene\t1\t90\t.\t+\t.\tgene_id \"g\";\n"
+      "1\tsrc\tmRNA\t1\t90\t.\t+\t.\tgene_id \"g\"; transcript_id \"t1\";\n"
+      "1\tsrc\tmRNA\t1\t90\t.\t+\t.\tgene_id \"g\"; transcript_id \"t2\";\n"
+      "1\tsrc\texon\t1\t40\t.\t+\t.\tgene_id \"g\"; transcript_id \"t1\";\n"
+      "1\tsrc\texon\t1\t40\t.\t+\t.\tgene_id \"g\"; "
+      "transcript_id \"t2\";\n"};
+  const auto shared_output = convert(shared, 1, 1);
+  check(shared_output == expected_shared, "one line per parent transcript");
+  if (verbose || shared_output != expected_shared) message << shared_output;
+  check(exons == 41, "exons with transcript_id");
+
+  if (verbose || result.hasFailed()) cout << message.str() << "\n";
+
+  cout << "~~~ " << gen_summary(result, "Checking " + test_name) << endl;
+
+  return result;
+}
@@ -14,7 +14,28 @@ int TestHKL::perform_tests(bool verbose) {
   result(TestRegionSeq::check_basic(verbose));
   result(TestRegionSeq::check_get_seq(verbose));
   result(TestRegionSeq::check_fasta_reader(verbose));
+  result(TestRegionSeq::check_masks(verbose));
+  result(TestRegionSeq::check_codes(verbose));
   result(TestGFF::check_gffreader(verbose));
+  result(TestGFF::check_gffviewreader(verbose));
+  result(TestGFF::check_gffparallelreader(verbose));
+  result(TestGFF::check_gffattributes(verbose));
+  result(TestGFF::check_gfffilter(verbose));
+  result(TestGFF::check_percent(verbose));
+  result(TestGFF::check_ndjson(verbose));
+  result(TestGFF::check_writers(verbose));
+  result(TestGFF::check_metrics(verbose));
+  result(TestGFF::check_gfffasta(verbose));
+  result(TestMotif::check_motif_search(verbose));
+  result(TestTranslate::check_translate(verbose));
+  result(TestColumnar::check_columnar(verbose));
+  result(TestGFFGraph::check_feature_graph(verbose));
+  result(TestAnnotationStore::check_annotation_store(verbose));
+  result(TestAnnotationStore::check_annotation_snapshot(verbose));
+  result(TestTabix::check_tabix(verbose));
+  result(TestGFFSort::check_gffsort(verbose));
+  result(TestGFFSort::check_gffmerge(verbose));
+  result(TestGTF::check_gtf(verbose));
 
   cout << "\n" << gen_summary(result, "Evaluation", true) << "\n";
 
@@ -0,0 +1,73 @@
+#include "test_motif.hpp"
+
+#include <algorithm>
+
+AGizmo::Evaluation::Stats TestHKL::TestMotif::check_motif_search(
+    bool verbose) {
+  Stats result;
+
+  sstream message;
+
+  const auto &test_name = "HKL::Motif::MotifSearch"s;
+
+  message << "\n~~~ Checking " << test_name << "\n";
+
+  const RegionSeq seq{"SEQ", "ACGTTGCAnnGGATCCacgt", Region("1:101-120")};
+
+  const auto check = [&](const MotifSearch &search, const RegionSeq &target,
+                         vector<MotifHit> expected) {
+    ++result;
+    auto outcome = search.scan(target);
+    std::sort(outcome.begin(), outcome.end());
+    std::sort(expected.begin(), expected.end());
+    const bool failed = outcome != expected;
+    result.addFailure(failed);
+    if (verbose || failed) {
+      message << "Outcome:";
+      for (const auto &hit : outcome) message << " " << hit;
+      message << "\nExpected:";
+      for (const auto &hit : expected) message << " " << hit;
+      message << "\n";
+    }
+  };
+
+  check(MotifSearch({"ACGT", "GGATCC", "TTG"}), seq,
+        {{Region("1", 101, 104, "+"), 0},
+         {Region("1", 117, 120, "+"), 0},
+         {Region("1", 111, 116, "+"), 1},
+         {Region("1", 104, 106, "+"), 2}});
+
+  check(MotifSearch({"CAA", "GGNTCC"}, true), seq,
+        {{Region("1", 104, 106, "-"), 0}, {Region("1", 111, 116, "+"), 1},
+         {Region("1", 111, 116, "-"), 1}});
+
+  check(MotifSearch({"RCGY"}), seq,
+        {{Region("1", 101, 104, "+"), 0}, {Region("1", 117, 120, "+"), 0}});
+
+  check(MotifSearch({"ACGT"}), seq.getSlice(Region("1:110-120")).value(),
+        {{Region("1", 117, 120, "+"), 0}});
+
+  check(MotifSearch({"AAT"}), RegionSeq("SEQ", "AANAATT"),
+        {{Region("SEQ", 4, 6, "+"), 0}});
+
+  ++result;
+  const auto batch = MotifSearch({"ACGT"}).scan(
+      vector<RegionSeq>{seq, RegionSeq("S2", "TTACGT"), RegionSeq()}, 2);
+  result.addFailure(batch.size() != 3 || batch[0].size() != 2 ||
+                    batch[1] != vector<MotifHit>{{Region("S2", 3, 6, "+"), 0}} ||
+                    !batch[2].empty());
+
+  ++result;
+  try {
+    MotifSearch({"AC\xe9T"});
+    result.addFailure(true);
+    message << "Non-ASCII pattern byte was accepted\n";
+  } catch (const std::runtime_error &) {
+  }
+
+  if (verbose || result.hasFailed()) cout << message.str() << "\n";
+
+  cout << "~~~ " << gen_summary(result, "Checking " + test_name) << endl;
+
+  return result;
+}
@@ -127,6 +127,85 @@ AGizmo::Evaluation::Stats TestHKL::TestRegionSeq::check_fasta_reader(
   return result;
 }
 
+AGizmo::Evaluation::Stats TestHKL::TestRegionSeq::check_masks(bool verbose) {
+  Stats result;
+
+  sstream message;
+
+  const auto &test_name = "HKL::MaskScanner"s;
+
+  message << "\n~~~ Checking " << test_name << "\n";
+
+  const auto seq = RegionSeq("S", "ACNNNtnnA" + string(20, 'a') +
+                                      string(20, 'C') + string(17, 'N') + "G");
+  const auto masks = MaskScanner::scanSeq(seq);
+
+  ++result;
+  result.addFailure(masks.getSoftMasked() !=
+                    vector<Region>{Region("S:6-8"), Region("S:10-29")});
+
+  ++result;
+  result.addFailure(masks.getGaps() != vector<Region>{Region("S:3-5"),
+                                                      Region("S:7-8"),
+                                                      Region("S:50-66")});
+
+  const uint8_t soft = MaskScanner::Soft, gap = MaskScanner::Gap;
+
+  ++result;
+  result.addFailure(masks.getTrack() != MaskScanner::track_t{{0, 2},
+                                                             {gap, 3},
+                                                             {soft, 1},
+                                                             {soft | gap, 2},
+                                                             {0, 1},
+                                                             {soft, 20},
+                                                             {0, 20},
+                                                             {gap, 17},
+                                                             {0, 1}});
+
+  FASTAReader parser{"test/input/sequences.fa"};
+
+  while (const auto read = parser(true, true)) {
+    if ((*read).getName() != "SEQ4") continue;
+    ++result;
+    const auto &read_masks = parser.getMasks();
+    result.addFailure(
+        *read != RegionSeq("SEQ4", "GGGGCCCC") ||
+        read_masks.getSoftMasked() !=
+            vector<Region>{Region("SEQ4:1-2"), Region("SEQ4:7")} ||
+        !read_masks.getGaps().empty());
+  }
+
+  if (verbose || result.hasFailed()) cout << message.str() << "\n";
+
+  cout << "~~~ " << gen_summary(result, "Checking " + test_name) << endl;
+
+  return result;
+}
+
+AGizmo::Evaluation::Stats TestHKL::TestRegionSeq::check_codes(bool verbose) {
+  Stats result;
+
+  sstream message;
+
+  const auto &test_name = "HKL::RegionSeq::getCodes"s;
+
+  message << "\n~~~ Checking " << test_name << "\n";
+
+  ++result;
+  result.addFailure(
+      RegionSeq("S", "ACGTacgtUuNnRY-").getCodes() !=
+      vector<uint8_t>{0, 1, 2, 3, 0, 1, 2, 3, 3, 3, 4, 4, 4, 4, 4});
+
+  ++result;
+  result.addFailure(!RegionSeq().getCodes().empty());
+
+  if (verbose || result.hasFailed()) cout << message.str() << "\n";
+
+  cout << "~~~ " << gen_summary(result, "Checking " + test_name) << endl;
+
+  return result;
+}
+
 TestHKL::TestRegionSeq::RegionSeqConstructors::RegionSeqConstructors(
     InputRegionSeq input, string expected)
     : BaseTest(input, expected) {
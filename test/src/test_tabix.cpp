@@ -0,0 +1,178 @@
+#include "test_tabix.hpp"
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <random>
+#include <sstream>
+
+AGizmo::Evaluation::Stats TestHKL::TestTabix::check_tabix(bool verbose) {
+  Stats result;
+
+  sstream message;
+
+  const auto &test_name = "HKL::Tabix::Index"s;
+
+  message << "\n~~~ Checking " << test_name << "\n";
+
+  std::mt19937 generator{11};
+  const auto random = [&](int low, int high) {
+    return std::uniform_int_distribution<int>{low, high}(generator);
+  };
+
+  struct Line {
+    int seqid, start, end;
+    string text;
+  };
+  vector<Line> lines;
+  for (int index = 0; index < 20000; ++index) {
+    const auto seqid = index % 3;
+    const auto start = random(1, 3000000);
+    const auto end = start + (index % 40 ? random(0, 500) : random(0, 400000));
+    lines.push_back({seqid, start, end,
+                     "c" + to_string(seqid) + "\tsrc\t" +
+                         (index % 5 ? "exon" : "gene") + "\t" +
+                         to_string(start) + "\t" + to_string(end) + "\t.\t" +
+                         (index % 4 ? "+" : "-") + "\t.\tID=r" +
+                         to_string(index)});
+  }
+  std::sort(lines.begin(), lines.end(),
+            [](const Line &left, const Line &right) {
+              return std::tie(left.seqid, left.start) <
+                     std::tie(right.seqid, right.start);
+            });
+
+  string text{"##gff-version 3\n"};
+  for (const auto &line : lines) text += line.text + "\n";
+  text += "##FASTA\n>c0\nACGT\n";
+
+  const auto directory = std::filesystem::temp_directory_path();
+  const auto file_name = (directory / "hkl_test_tabix.gff.gz").string();
+  {
+    std::istringstream input{text};
+    HKL::BGZF::compress(input, file_name);
+  }
+
+  // Any gzip reader decompresses BGZF.
+  string decompressed;
+  if (const auto file = gzopen(file_name.c_str(), "rb")) {
+    char buffer[1 << 16];
+    for (int size; (size = gzread(file, buffer, sizeof(buffer))) > 0;)
+      decompressed.append(buffer, static_cast<size_t>(size));
+    gzclose(file);
+  }
+  ++result;
+  result.addFailure(decompressed != text);
+  if (decompressed != text) message << "BGZF output is not valid gzip\n";
+
+  vector<Region> locs;
+  for (int index = 0; index < 200; ++index) {
+    const auto first = random(1, 3100000);
+    const auto last =
+        first + (index % 10 ? random(0, 5000) : random(0, 300000));
+    const string strand = index % 7 ? "" : index % 2 ? "+" : "-";
+    locs.emplace_back("c" + to_string(index % 4), first, last, strand);
+  }
+
+  const auto expected = [&](const Region &loc) {
+    vector<string> hits;
+    for (const auto &line : lines) {
+      if ("c" + to_string(line.seqid) != loc.getChrom() ||
+          line.start > loc.getLast() || line.end < loc.getFirst())
+        continue;
+      if (loc.getStrand() &&
+          line.text.find(string("\t.\t") + loc.getStrand()) == string::npos)
+        continue;
+      hits.push_back(line.text);
+    }
+    return hits;
+  };
+
+  const vector<std::pair<string, Index>> indices{
+      {file_name + ".tbi", Index::build(file_name)},
+      {file_name + ".csi", Index::build(file_name, 12, 7)}};
+
+  for (const auto &[index_name, built] : indices) {
+    built.save(index_name);
+    const auto loaded = Index::load(index_name);
+    ++result;
+    result.addFailure(loaded.getNames() != vector<string>{"c0", "c1", "c2"} ||
+                      loaded.getMinShift() != built.getMinShift() ||
+                      loaded.getDepth() != built.getDepth());
+
+    GFFIndexedReader reader{file_name, index_name};
+    for (const auto &loc : locs) {
+      vector<string> found;
+      for (const auto &record : reader.query(loc))
+        found.push_back(record.str());
+      const auto wanted = expected(loc);
+      ++result;
+      result.addFailure(found != wanted);
+      if (found != wanted)
+        message << index_name << " " << loc << ": " << found.size()
+                << " records instead of " << wanted.size() << "\n";
+    }
+
+    // Without a region the whole file up to ##FASTA is read.
+    reader.rewind();
+    size_t records{0}, comments{0};
+    while (const auto item = reader()) {
+      if (std::holds_alternative<GFFRecord>(*item))
+        ++records;
+      else
+        ++comments;
+    }
+    ++result;
+    result.addFailure(records != lines.size() || comments != 1);
+  }
+
+  // A FASTA section may open with a bare '>' header instead of ##FASTA.
+  text = "##gff-version 3\n";
+  for (size_t index = 0; index < 100; ++index) text += lines[index].text + "\n";
+  text += ">c0\nACGT\n";
+  {
+    std::istringstream input{text};
+    HKL::BGZF::compress(input, file_name);
+  }
+  {
+    size_t records{0};
+    try {
+      Index::build(file_name).save(file_name + ".tbi");
+      GFFIndexedReader reader{file_name, file_name + ".tbi"};
+      while (const auto item = reader())
+        records += std::holds_alternative<GFFRecord>(*item);
+    } catch (const std::runtime_error &error) {
+      message << "Bare FASTA header: " << error.what() << "\n";
+    }
+    ++result;
+    result.addFailure(records != 100);
+  }
+
+  // Unsorted input cannot be indexed.
+  std::swap(lines[10], lines[5000]);
+  text.clear();
+  for (const auto &line : lines) text += line.text + "\n";
+  {
+    std::istringstream input{text};
+    HKL::BGZF::compress(input, file_name);
+  }
+  ++result;
+  try {
+    Index::build(file_name);
+    result.addFailure(true);
+    message << "Unsorted input was indexed\n";
+  } catch (const std::runtime_error &) {
+  }
+
+  std::remove(file_name.c_str());
+  for (const auto &[index_name, built] : indices)
+    std::remove(index_name.c_str());
+
+  if (verbose || result.hasFailed()) cout << message.str() << "\n";
+
+  cout << "~~~ " << gen_summary(result, "Checking " + test_name) << endl;
+
+  return result;
+}
@@ -0,0 +1,74 @@
+#include "test_translate.hpp"
+
+AGizmo::Evaluation::Stats TestHKL::TestTranslate::check_translate(
+    bool verbose) {
+  Stats result;
+
+  sstream message;
+
+  const auto &test_name = "HKL::Translate"s;
+
+  message << "\n~~~ Checking " << test_name << "\n";
+
+  const vector<RegionSeq> seqs{
+      RegionSeq(">S chromosome S", "CCATGAAATTTTTTGGGTAACC"),
+      RegionSeq("R", RegionSeq::reverseComplement("CCATGTGGAAAATTTTGAC")),
+  };
+
+  const vector<GFFRecord> records{
+      GFFRecord{"S\t.\tCDS\t15\t20\t.\t+\t0\tParent=t1"},
+      GFFRecord{"S\t.\tCDS\t3\t8\t.\t+\t0\tParent=t1"},
+      GFFRecord{"R\t.\tCDS\t2\t7\t.\t-\t0\tParent=t2"},
+      GFFRecord{"R\t.\tCDS\t12\t17\t.\t-\t0\tParent=t2"},
+      GFFRecord{"S\t.\tCDS\t2\t8\t.\t+\t1\tParent=t3,t4"},
+      GFFRecord{"S\t.\tCDS\t15\t20\t.\t+\t0\tParent=t3,t4"},
+      GFFRecord{"S\t.\texon\t1\t22\t.\t+\t.\tParent=t3"},
+  };
+
+  const auto check = [&](const vector<Transcript> &outcome,
+                         const vector<string> &expected) {
+    ++result;
+    vector<string> proteins;
+    for (const auto &transcript : outcome)
+      proteins.push_back(transcript.id + ":" + transcript.protein);
+    const bool failed = proteins != expected;
+    result.addFailure(failed);
+    if (verbose || failed) {
+      for (const auto &protein : proteins) message << protein << " ";
+      message << "\n";
+    }
+  };
+
+  check(HKL::Translate::translate_cds(records, seqs, 1, 2),
+        {"t1:MKG*", "t2:MWF*", "t3:MKG*", "t4:MKG*"});
+  check(HKL::Translate::translate_cds(records, seqs, 2),
+        {"t1:MKG*", "t2:MWFW", "t3:MKG*", "t4:MKG*"});
+
+  ++result;
+  result.addFailure(GeneticCode().translate("ATGNNNTAAGGG", true) != "MX");
+
+  ++result;
+  try {
+    HKL::Translate::translate_cds(
+        {GFFRecord{"S\t.\tCDS\t20\t25\t.\t+\t0\tParent=t5"}}, seqs);
+    result.addFailure(true);
+    message << "CDS past the end of its sequence was clipped\n";
+  } catch (const std::runtime_error &) {
+  }
+
+  ++result;
+  try {
+    HKL::Translate::collect_cds(
+        {GFFRecord{"S\t.\tCDS\t2\t8\t.\t+\t1\tParent=t6"},
+         GFFRecord{"S\t.\tCDS\t15\t20\t.\t+\t2\tParent=t6"}});
+    result.addFailure(true);
+    message << "CDS phase disagreeing with the reading frame was accepted\n";
+  } catch (const std::runtime_error &) {
+  }
+
+  if (verbose || result.hasFailed()) cout << message.str() << "\n";
+
+  cout << "~~~ " << gen_summary(result, "Checking " + test_name) << endl;
+
+  return result;
+}